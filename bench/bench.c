@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cjson/cJSON.h>
+
+#include "bench.h"
+#include "rox/logging.h"
+#include "util.h"
+
+#ifdef ROX_BENCH_COUNT_ALLOCATIONS
+
+static int64_t bench_allocations = 0;
+
+void *__real_malloc(size_t size);
+
+void *__real_calloc(size_t count, size_t size);
+
+void *__real_realloc(void *ptr, size_t size);
+
+char *__real_strdup(const char *str);
+
+void *__wrap_malloc(size_t size) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *str) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __real_strdup(str);
+}
+
+int64_t bench_get_allocations() {
+    return __atomic_load_n(&bench_allocations, __ATOMIC_RELAXED);
+}
+
+#else
+
+int64_t bench_get_allocations() {
+    return -1;
+}
+
+#endif
+
+#define ROX_BENCH_MAX_RESULTS 256
+
+static struct {
+    double scale;
+    const char *filter;
+    BenchResult results[ROX_BENCH_MAX_RESULTS];
+    size_t results_count;
+    volatile intptr_t sink;
+} bench_state = {1.0, NULL};
+
+static double bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static int bench_compare_doubles(const void *a, const void *b) {
+    double d1 = *(const double *) a;
+    double d2 = *(const double *) b;
+    return d1 < d2 ? -1 : d1 > d2 ? 1 : 0;
+}
+
+static double bench_percentile(const double *sorted, size_t count, double percentile) {
+    size_t index = (size_t) (percentile * (double) (count - 1) + 0.5);
+    return sorted[index < count ? index : count - 1];
+}
+
+void bench_consume(intptr_t value) {
+    bench_state.sink += value;
+}
+
+bool bench_is_enabled(const char *name) {
+    assert(name);
+    return !bench_state.filter || strstr(name, bench_state.filter) != NULL;
+}
+
+void bench_run(const char *name, void *target, bench_func func, size_t iterations) {
+    assert(name);
+    assert(func);
+    assert(bench_state.results_count < ROX_BENCH_MAX_RESULTS);
+
+    if (!bench_is_enabled(name)) {
+        return;
+    }
+
+    iterations = (size_t) ((double) iterations * bench_state.scale);
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    size_t samples = iterations < ROX_BENCH_MAX_SAMPLES ? iterations : ROX_BENCH_MAX_SAMPLES;
+    size_t batch = iterations / samples;
+    iterations = batch * samples;
+
+    // fills the caches, compiles the expressions etc.
+    func(target, batch);
+
+    double sample_ns_per_op[ROX_BENCH_MAX_SAMPLES];
+    double total_ns = 0;
+    int64_t allocations = bench_get_allocations();
+    for (size_t i = 0; i < samples; ++i) {
+        double start = bench_now_ns();
+        func(target, batch);
+        double elapsed = bench_now_ns() - start;
+        total_ns += elapsed;
+        sample_ns_per_op[i] = elapsed / (double) batch;
+    }
+    int64_t allocations_after = bench_get_allocations();
+    qsort(sample_ns_per_op, samples, sizeof(double), &bench_compare_doubles);
+
+    BenchResult *result = &bench_state.results[bench_state.results_count++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->iterations = iterations;
+    result->samples = samples;
+    result->ns_per_op = total_ns / (double) iterations;
+    result->p50_ns_per_op = bench_percentile(sample_ns_per_op, samples, 0.50);
+    result->p90_ns_per_op = bench_percentile(sample_ns_per_op, samples, 0.90);
+    result->p99_ns_per_op = bench_percentile(sample_ns_per_op, samples, 0.99);
+    result->min_ns_per_op = sample_ns_per_op[0];
+    result->max_ns_per_op = sample_ns_per_op[samples - 1];
+    result->allocations_per_op = allocations < 0
+                                 ? -1
+                                 : (double) (allocations_after - allocations) / (double) iterations;
+
+    fprintf(stderr, "%-64s %14.1f ns/op (p50 %.1f, p99 %.1f) %10.2f allocs/op\n",
+            result->name, result->ns_per_op, result->p50_ns_per_op, result->p99_ns_per_op,
+            result->allocations_per_op);
+}
+
+static char *bench_results_to_json() {
+    cJSON *benchmarks = cJSON_CreateArray();
+    for (size_t i = 0; i < bench_state.results_count; ++i) {
+        BenchResult *result = &bench_state.results[i];
+        cJSON_AddItemToArray(benchmarks, ROX_JSON_OBJECT(
+                "name", ROX_JSON_STRING(result->name),
+                "iterations", ROX_JSON_INT((double) result->iterations),
+                "samples", ROX_JSON_INT((double) result->samples),
+                "ns_per_op", ROX_JSON_DOUBLE(result->ns_per_op),
+                "p50_ns_per_op", ROX_JSON_DOUBLE(result->p50_ns_per_op),
+                "p90_ns_per_op", ROX_JSON_DOUBLE(result->p90_ns_per_op),
+                "p99_ns_per_op", ROX_JSON_DOUBLE(result->p99_ns_per_op),
+                "min_ns_per_op", ROX_JSON_DOUBLE(result->min_ns_per_op),
+                "max_ns_per_op", ROX_JSON_DOUBLE(result->max_ns_per_op),
+                "allocations_per_op", result->allocations_per_op >= 0
+                                      ? ROX_JSON_DOUBLE(result->allocations_per_op)
+                                      : ROX_JSON_NULL));
+    }
+    cJSON *json = ROX_JSON_OBJECT(
+            "sdk_version", ROX_JSON_STRING(ROX_LIB_VERSION),
+            "scale", ROX_JSON_DOUBLE(bench_state.scale),
+            "allocations_counted", bench_get_allocations() >= 0 ? ROX_JSON_TRUE : ROX_JSON_FALSE,
+            "benchmarks", benchmarks);
+    // the results may not fit into the buffer of ROX_JSON_SERIALIZE_PRETTY()
+    char *str = cJSON_Print(json);
+    cJSON_Delete(json);
+    return str;
+}
+
+static void bench_print_usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--filter <substring>] [--scale <factor>] [--output <file.json>]\n"
+            "  Runs the benchmarks, prints the progress to stderr and the results as JSON\n"
+            "  to stdout, or to the given file.\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            bench_state.filter = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            bench_state.scale = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            bench_print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (bench_state.scale <= 0) {
+        bench_print_usage(argv[0]);
+        return 1;
+    }
+
+    RoxLoggingConfig logging_config = ROX_LOGGING_CONFIG_INITIALIZER(RoxLogLevelError);
+    rox_logging_init(&logging_config);
+
+    bench_collections();
+    bench_parser();
+    bench_flags();
+    bench_configuration();
+    bench_notifications();
+
+    char *json = bench_results_to_json();
+    if (output) {
+        if (!str_to_file(output, json)) {
+            fprintf(stderr, "cannot write %s\n", output);
+            free(json);
+            return 1;
+        }
+    } else {
+        printf("%s\n", json);
+    }
+    free(json);
+    return 0;
+}
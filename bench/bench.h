@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/configuration.h"
+#include "core/entities.h"
+#include "core/repositories.h"
+#include "core/reporting.h"
+#include "core/security.h"
+#include "eval/parser.h"
+
+//
+// Minimal harness for the microbenchmarks. Each benchmark runs its body the given number of times,
+// after a warm-up run, split into samples timed separately, and reports the time and the number
+// of SDK allocations per operation. All the inputs are generated deterministically, so that runs
+// on the same machine are comparable.
+//
+
+typedef void (*bench_func)(void *target, size_t iterations);
+
+#define ROX_BENCH_MAX_SAMPLES 100
+
+typedef struct BenchResult {
+    char name[64];
+    size_t iterations;
+    size_t samples;
+    double ns_per_op;
+    // over the samples
+    double p50_ns_per_op;
+    double p90_ns_per_op;
+    double p99_ns_per_op;
+    double min_ns_per_op;
+    double max_ns_per_op;
+    // negative when the allocations can't be counted on this platform
+    double allocations_per_op;
+} BenchResult;
+
+/**
+ * @return Number of allocations made so far by the code linked into the benchmark,
+ * or <code>-1</code> if they are not counted.
+ */
+int64_t bench_get_allocations();
+
+/**
+ * Runs the benchmark unless it's filtered out, and records its result.
+ *
+ * @param name Not <code>NULL</code>.
+ * @param target May be <code>NULL</code>.
+ * @param func Not <code>NULL</code>.
+ * @param iterations Number of operations, before applying the <code>--scale</code> option.
+ */
+void bench_run(const char *name, void *target, bench_func func, size_t iterations);
+
+/**
+ * @param name Not <code>NULL</code>.
+ * @return Whether the benchmark with the given name is going to run, so that its setup can be skipped otherwise.
+ */
+bool bench_is_enabled(const char *name);
+
+/**
+ * Keeps the compiler from optimizing the benchmarked calls away.
+ */
+void bench_consume(intptr_t value);
+
+//
+// SDK set up the way RoxCore does it, without the network part.
+//
+
+typedef struct BenchSdk {
+    Parser *parser;
+    ConfigurationRepository *configuration_repository;
+    ExperimentRepository *experiment_repository;
+    TargetGroupRepository *target_group_repository;
+    FlagRepository *flag_repository;
+    CustomPropertyRepository *custom_property_repository;
+    DynamicProperties *dynamic_properties;
+    ImpressionInvoker *impression_invoker;
+    FlagSetter *flag_setter;
+    EntitiesProvider *entities_provider;
+} BenchSdk;
+
+BenchSdk *bench_sdk_create();
+
+/**
+ * Applies the configuration the way <code>rox_core_fetch()</code> does.
+ *
+ * @param sdk Not <code>NULL</code>.
+ * @param configuration Not <code>NULL</code>. The ownership is NOT delegated.
+ */
+void bench_sdk_apply(BenchSdk *sdk, Configuration *configuration);
+
+/**
+ * @param sdk Not <code>NULL</code>.
+ */
+void bench_sdk_free(BenchSdk *sdk);
+
+//
+// Configuration parser with the signature and the API key checks stubbed out.
+//
+
+typedef struct BenchConfigurationParser {
+    SignatureVerifier *signature_verifier;
+    ErrorReporter *error_reporter;
+    APIKeyVerifier *api_key_verifier;
+    ConfigurationFetchedInvoker *configuration_fetched_invoker;
+    ConfigurationParser *parser;
+} BenchConfigurationParser;
+
+BenchConfigurationParser *bench_configuration_parser_create();
+
+/**
+ * @param parser Not <code>NULL</code>.
+ * @param json Not <code>NULL</code>. Configuration as returned by the API.
+ * @return Not <code>NULL</code>. Must be freed by the caller with <code>configuration_free()</code>.
+ */
+Configuration *bench_configuration_parser_parse(BenchConfigurationParser *parser, const char *json);
+
+/**
+ * @param parser Not <code>NULL</code>.
+ */
+void bench_configuration_parser_free(BenchConfigurationParser *parser);
+
+/**
+ * Generates a signed configuration, as returned by the API, with the given number of experiments,
+ * each controlling one flag named <code>flag&lt;N&gt;</code>, and a target group per ten experiments.
+ *
+ * @return Not <code>NULL</code>. Must be freed by the caller.
+ */
+char *bench_generate_configuration_json(int experiments_count);
+
+//
+// Suites
+//
+
+void bench_collections();
+
+void bench_parser();
+
+void bench_flags();
+
+void bench_configuration();
+
+void bench_notifications();
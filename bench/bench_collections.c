@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <collectc/hashtable.h>
+#include <collectc/list.h>
+#include "collections.h"
+#include "util.h"
+#include "bench.h"
+
+//
+// RoxMap and RoxList against the collectc hash table and linked list they replaced, on the same
+// string keys. The allocations made by collectc are not counted when it's linked as a shared library.
+//
+
+typedef struct CollectionsBench {
+    char **keys;
+    char **missing_keys;
+    size_t keys_count;
+    RoxMap *map;
+    HashTable *table;
+} CollectionsBench;
+
+static void collections_bench_rox_map_insert(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    RoxMap *map = rox_map_create();
+    for (size_t i = 0, k = 0; i < iterations; ++i, ++k) {
+        if (k == bench->keys_count) {
+            rox_map_free(map);
+            map = rox_map_create();
+            k = 0;
+        }
+        rox_map_add(map, bench->keys[k], bench->keys[k]);
+    }
+    rox_map_free(map);
+}
+
+static void collections_bench_collectc_insert(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    HashTable *table;
+    hashtable_new(&table);
+    for (size_t i = 0, k = 0; i < iterations; ++i, ++k) {
+        if (k == bench->keys_count) {
+            hashtable_destroy(table);
+            hashtable_new(&table);
+            k = 0;
+        }
+        hashtable_add(table, bench->keys[k], bench->keys[k]);
+    }
+    hashtable_destroy(table);
+}
+
+static void collections_bench_rox_map_get(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        void *value = NULL;
+        rox_map_get(bench->map, bench->keys[i % bench->keys_count], &value);
+        bench_consume((intptr_t) value);
+    }
+}
+
+static void collections_bench_collectc_get(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        void *value = NULL;
+        hashtable_get(bench->table, bench->keys[i % bench->keys_count], &value);
+        bench_consume((intptr_t) value);
+    }
+}
+
+static void collections_bench_rox_map_get_missing(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        void *value = NULL;
+        rox_map_get(bench->map, bench->missing_keys[i % bench->keys_count], &value);
+        bench_consume((intptr_t) value);
+    }
+}
+
+static void collections_bench_collectc_get_missing(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        void *value = NULL;
+        hashtable_get(bench->table, bench->missing_keys[i % bench->keys_count], &value);
+        bench_consume((intptr_t) value);
+    }
+}
+
+static void collections_bench_run(size_t keys_count) {
+    CollectionsBench bench;
+    bench.keys_count = keys_count;
+    bench.keys = calloc(keys_count, sizeof(char *));
+    bench.missing_keys = calloc(keys_count, sizeof(char *));
+    for (size_t i = 0; i < keys_count; ++i) {
+        // similar to the flag names
+        bench.keys[i] = mem_str_format("namespace%zu.flag%zu", i % 7, i);
+        bench.missing_keys[i] = mem_str_format("namespace%zu.missing%zu", i % 7, i);
+    }
+    bench.map = rox_map_create();
+    hashtable_new(&bench.table);
+    for (size_t i = 0; i < keys_count; ++i) {
+        rox_map_add(bench.map, bench.keys[i], bench.keys[i]);
+        hashtable_add(bench.table, bench.keys[i], bench.keys[i]);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "collections/map/%zu_keys/insert/rox_map", keys_count);
+    bench_run(name, &bench, &collections_bench_rox_map_insert, 2000000);
+    snprintf(name, sizeof(name), "collections/map/%zu_keys/insert/collectc", keys_count);
+    bench_run(name, &bench, &collections_bench_collectc_insert, 2000000);
+    snprintf(name, sizeof(name), "collections/map/%zu_keys/get/rox_map", keys_count);
+    bench_run(name, &bench, &collections_bench_rox_map_get, 5000000);
+    snprintf(name, sizeof(name), "collections/map/%zu_keys/get/collectc", keys_count);
+    bench_run(name, &bench, &collections_bench_collectc_get, 5000000);
+    snprintf(name, sizeof(name), "collections/map/%zu_keys/get_missing/rox_map", keys_count);
+    bench_run(name, &bench, &collections_bench_rox_map_get_missing, 5000000);
+    snprintf(name, sizeof(name), "collections/map/%zu_keys/get_missing/collectc", keys_count);
+    bench_run(name, &bench, &collections_bench_collectc_get_missing, 5000000);
+
+    hashtable_destroy(bench.table);
+    rox_map_free(bench.map);
+    for (size_t i = 0; i < keys_count; ++i) {
+        free(bench.keys[i]);
+        free(bench.missing_keys[i]);
+    }
+    free(bench.keys);
+    free(bench.missing_keys);
+}
+
+static void collections_bench_rox_list_append_and_iterate(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    for (size_t i = 0; i < iterations; i += bench->keys_count) {
+        size_t count = iterations - i < bench->keys_count ? iterations - i : bench->keys_count;
+        RoxList *list = rox_list_create();
+        for (size_t k = 0; k < count; ++k) {
+            rox_list_add(list, bench->keys[k]);
+        }
+        ROX_LIST_FOREACH(item, list, {
+            bench_consume((intptr_t) item);
+        })
+        rox_list_free(list);
+    }
+}
+
+static void collections_bench_collectc_list_append_and_iterate(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    for (size_t i = 0; i < iterations; i += bench->keys_count) {
+        size_t count = iterations - i < bench->keys_count ? iterations - i : bench->keys_count;
+        List *list;
+        list_new(&list);
+        for (size_t k = 0; k < count; ++k) {
+            list_add(list, bench->keys[k]);
+        }
+        ListIter iter;
+        list_iter_init(&iter, list);
+        void *item;
+        while (list_iter_next(&iter, &item) != CC_ITER_END) {
+            bench_consume((intptr_t) item);
+        }
+        list_destroy(list);
+    }
+}
+
+static void collections_bench_rox_list_get_at(void *target, size_t iterations) {
+    CollectionsBench *bench = target;
+    RoxList *list = rox_list_create();
+    for (size_t k = 0; k < bench->keys_count; ++k) {
+        rox_list_add(list, bench->keys[k]);
+    }
+    for (size_t i = 0; i < iterations; ++i) {
+        void *item = NULL;
+        rox_list_get_at(list, i % bench->keys_count, &item);
+        bench_consume((intptr_t) item);
+    }
+    rox_list_free(list);
+}
+
+static void collections_bench_list_run(size_t keys_count) {
+    CollectionsBench bench = {0};
+    bench.keys_count = keys_count;
+    bench.keys = calloc(keys_count, sizeof(char *));
+    for (size_t i = 0; i < keys_count; ++i) {
+        bench.keys[i] = mem_str_format("token%zu", i);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "collections/list/%zu_items/append_and_iterate/rox_list", keys_count);
+    bench_run(name, &bench, &collections_bench_rox_list_append_and_iterate, 5000000);
+    snprintf(name, sizeof(name), "collections/list/%zu_items/append_and_iterate/collectc", keys_count);
+    bench_run(name, &bench, &collections_bench_collectc_list_append_and_iterate, 5000000);
+    snprintf(name, sizeof(name), "collections/list/%zu_items/get_at/rox_list", keys_count);
+    bench_run(name, &bench, &collections_bench_rox_list_get_at, 5000000);
+
+    for (size_t i = 0; i < keys_count; ++i) {
+        free(bench.keys[i]);
+    }
+    free(bench.keys);
+}
+
+void bench_collections() {
+    collections_bench_list_run(8);
+    collections_bench_list_run(1000);
+    collections_bench_run(8);
+    collections_bench_run(1000);
+    collections_bench_run(100000);
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+//
+// Parsing a configuration as returned by the API, and applying it to the flags.
+//
+
+typedef struct ConfigurationBench {
+    BenchConfigurationParser *parser;
+    BenchSdk *sdk;
+    char *json;
+    Configuration *configuration;
+} ConfigurationBench;
+
+static void configuration_bench_parse(void *target, size_t iterations) {
+    ConfigurationBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        Configuration *configuration = bench_configuration_parser_parse(bench->parser, bench->json);
+        bench_consume((intptr_t) configuration);
+        configuration_free(configuration);
+    }
+}
+
+static void configuration_bench_apply(void *target, size_t iterations) {
+    ConfigurationBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_sdk_apply(bench->sdk, bench->configuration);
+    }
+}
+
+static void configuration_bench_parse_and_apply(void *target, size_t iterations) {
+    ConfigurationBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        Configuration *configuration = bench_configuration_parser_parse(bench->parser, bench->json);
+        bench_sdk_apply(bench->sdk, configuration);
+        configuration_free(configuration);
+    }
+}
+
+static void configuration_bench_run(int experiments_count, size_t iterations) {
+    char parse_name[64], apply_name[64], parse_and_apply_name[64];
+    snprintf(parse_name, sizeof(parse_name), "configuration/%d_experiments/parse", experiments_count);
+    snprintf(apply_name, sizeof(apply_name), "configuration/%d_experiments/apply", experiments_count);
+    snprintf(parse_and_apply_name, sizeof(parse_and_apply_name),
+             "configuration/%d_experiments/parse_and_apply", experiments_count);
+    if (!bench_is_enabled(parse_name) && !bench_is_enabled(apply_name) && !bench_is_enabled(parse_and_apply_name)) {
+        return;
+    }
+
+    ConfigurationBench bench;
+    bench.parser = bench_configuration_parser_create();
+    bench.sdk = bench_sdk_create();
+    bench.json = bench_generate_configuration_json(experiments_count);
+    bench.configuration = bench_configuration_parser_parse(bench.parser, bench.json);
+
+    // every experiment controls a registered flag, as in an application using all of them
+    for (int i = 0; i < experiments_count; ++i) {
+        char flag_name[32];
+        snprintf(flag_name, sizeof(flag_name), "flag%d", i);
+        RoxStringBase *flag = variant_create_flag();
+        // the repository doesn't copy the name
+        variant_set_name(flag, flag_name);
+        flag_repository_add_flag(bench.sdk->flag_repository, flag, variant_get_name(flag));
+    }
+
+    bench_run(parse_name, &bench, &configuration_bench_parse, iterations);
+    bench_run(apply_name, &bench, &configuration_bench_apply, iterations);
+    bench_run(parse_and_apply_name, &bench, &configuration_bench_parse_and_apply, iterations);
+
+    configuration_free(bench.configuration);
+    free(bench.json);
+    bench_sdk_free(bench.sdk);
+    bench_configuration_parser_free(bench.parser);
+}
+
+void bench_configuration() {
+    configuration_bench_run(1000, 100);
+    configuration_bench_run(10000, 10);
+}
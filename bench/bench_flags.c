@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "rox/server.h"
+#include "core/client.h"
+#include "core/impression.h"
+#include "collections.h"
+#include "bench.h"
+
+//
+// Flag evaluation through the public and the dynamic API, with the flags of a generated
+// configuration applied the way RoxCore does it.
+//
+
+#define FLAGS_BENCH_EXPERIMENTS_COUNT 1000
+
+typedef struct FlagsBenchFlag {
+    const char *name;
+    const char *suffix;
+} FlagsBenchFlag;
+
+// one flag per generated condition kind, see bench_generate_configuration_json()
+static const FlagsBenchFlag flags_bench_flags[] = {
+        {"flag0", "target_group"},
+        {"flag1", "percentage"},
+        {"flag2", "in_array_semver"},
+        {"flag3", "context_or_target_group"}
+};
+
+#define FLAGS_BENCH_FLAGS_COUNT (sizeof(flags_bench_flags) / sizeof(flags_bench_flags[0]))
+
+typedef struct FlagsBench {
+    BenchSdk *sdk;
+    RoxDynamicApi *dynamic_api;
+    RoxStringBase *flags[FLAGS_BENCH_FLAGS_COUNT];
+    RoxStringBase *flag;
+    const char *flag_name;
+    RoxStringBase *string_variant;
+    RoxStringBase *int_variant;
+    RoxStringBase *double_variant;
+    RoxContext *context;
+} FlagsBench;
+
+static void flags_bench_impression_handler(void *target, RoxReportingValue *value, RoxContext *context) {
+    bench_consume((intptr_t) value);
+}
+
+static void flags_bench_is_enabled(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume(rox_is_enabled(bench->flag));
+    }
+}
+
+static void flags_bench_is_enabled_ctx(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume(rox_is_enabled_ctx(bench->flag, bench->context));
+    }
+}
+
+static void flags_bench_get_string(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        char *value = rox_get_string(bench->string_variant);
+        bench_consume((intptr_t) value);
+        free(value);
+    }
+}
+
+static void flags_bench_get_int(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume(rox_get_int(bench->int_variant));
+    }
+}
+
+static void flags_bench_get_double(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume((intptr_t) rox_get_double(bench->double_variant));
+    }
+}
+
+static void flags_bench_dynamic_is_enabled(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume(rox_dynamic_api_is_enabled(bench->dynamic_api, bench->flag_name, false));
+    }
+}
+
+static void flags_bench_dynamic_is_enabled_ctx(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume(rox_dynamic_api_is_enabled_ctx(bench->dynamic_api, bench->flag_name, false, bench->context));
+    }
+}
+
+static void flags_bench_dynamic_get_int(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        bench_consume(rox_dynamic_api_get_int(bench->dynamic_api, "bench.dynamic.int", 3));
+    }
+}
+
+static void flags_bench_dynamic_get_string(void *target, size_t iterations) {
+    FlagsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        char *value = rox_dynamic_api_get_string(bench->dynamic_api, "bench.dynamic.string", "red");
+        bench_consume((intptr_t) value);
+        free(value);
+    }
+}
+
+static void flags_bench_run(FlagsBench *bench, const char *mode) {
+    char name[64];
+
+    for (size_t i = 0; i < FLAGS_BENCH_FLAGS_COUNT; ++i) {
+        bench->flag = bench->flags[i];
+        bench->flag_name = flags_bench_flags[i].name;
+
+        snprintf(name, sizeof(name), "flags/rox_is_enabled/%s/%s", flags_bench_flags[i].suffix, mode);
+        bench_run(name, bench, &flags_bench_is_enabled, 1000000);
+
+        snprintf(name, sizeof(name), "flags/rox_is_enabled_ctx/%s/%s", flags_bench_flags[i].suffix, mode);
+        bench_run(name, bench, &flags_bench_is_enabled_ctx, 1000000);
+
+        snprintf(name, sizeof(name), "dynamic/is_enabled/%s/%s", flags_bench_flags[i].suffix, mode);
+        bench_run(name, bench, &flags_bench_dynamic_is_enabled, 1000000);
+
+        snprintf(name, sizeof(name), "dynamic/is_enabled_ctx/%s/%s", flags_bench_flags[i].suffix, mode);
+        bench_run(name, bench, &flags_bench_dynamic_is_enabled_ctx, 1000000);
+    }
+
+    snprintf(name, sizeof(name), "flags/rox_get_string/default/%s", mode);
+    bench_run(name, bench, &flags_bench_get_string, 1000000);
+
+    snprintf(name, sizeof(name), "flags/rox_get_int/condition/%s", mode);
+    bench_run(name, bench, &flags_bench_get_int, 1000000);
+
+    snprintf(name, sizeof(name), "flags/rox_get_double/condition/%s", mode);
+    bench_run(name, bench, &flags_bench_get_double, 1000000);
+
+    snprintf(name, sizeof(name), "dynamic/get_int/default/%s", mode);
+    bench_run(name, bench, &flags_bench_dynamic_get_int, 1000000);
+
+    snprintf(name, sizeof(name), "dynamic/get_string/default/%s", mode);
+    bench_run(name, bench, &flags_bench_dynamic_get_string, 1000000);
+}
+
+void bench_flags() {
+    FlagsBench bench = {0};
+    bench.sdk = bench_sdk_create();
+    bench.dynamic_api = dynamic_api_create(bench.sdk->flag_repository, bench.sdk->entities_provider);
+    for (size_t i = 0; i < FLAGS_BENCH_FLAGS_COUNT; ++i) {
+        bench.flags[i] = variant_create_flag();
+        flag_repository_add_flag(bench.sdk->flag_repository, bench.flags[i], flags_bench_flags[i].name);
+    }
+    bench.string_variant = variant_create_string("red", NULL);
+    flag_repository_add_flag(bench.sdk->flag_repository, bench.string_variant, "bench.string");
+    bench.context = rox_context_create_from_map(ROX_MAP(
+            ROX_COPY("userId"), rox_dynamic_value_create_string_copy("user-12345"),
+            ROX_COPY("plan"), rox_dynamic_value_create_string_copy("free")));
+
+    BenchConfigurationParser *configuration_parser = bench_configuration_parser_create();
+    char *json = bench_generate_configuration_json(FLAGS_BENCH_EXPERIMENTS_COUNT);
+    Configuration *configuration = bench_configuration_parser_parse(configuration_parser, json);
+    bench_sdk_apply(bench.sdk, configuration);
+    configuration_free(configuration);
+    free(json);
+    bench_configuration_parser_free(configuration_parser);
+
+    // typed flags aren't controlled by the generated experiments, their conditions are set directly
+    bench.int_variant = variant_create_int(3, NULL);
+    variant_set_for_evaluation(bench.int_variant, bench.sdk->parser, NULL, bench.sdk->impression_invoker);
+    variant_set_condition(bench.int_variant, "ifThen(eq(property(\"country\"), \"US\"), 7, 3)");
+    bench.double_variant = variant_create_double(1.5, NULL);
+    variant_set_for_evaluation(bench.double_variant, bench.sdk->parser, NULL, bench.sdk->impression_invoker);
+    variant_set_condition(bench.double_variant, "ifThen(eq(property(\"country\"), \"US\"), 2.5, 1.5)");
+
+    flags_bench_run(&bench, "no_impression");
+
+    // reporting the impressions needs the value as a string, so it takes the generic path
+    impression_invoker_register(bench.sdk->impression_invoker, &bench, &flags_bench_impression_handler);
+    flags_bench_run(&bench, "impression");
+
+    variant_free(bench.int_variant);
+    variant_free(bench.double_variant);
+    rox_context_free(bench.context);
+    rox_dynamic_api_free(bench.dynamic_api);
+    bench_sdk_free(bench.sdk);
+}
+
+#undef FLAGS_BENCH_FLAGS_COUNT
+#undef FLAGS_BENCH_EXPERIMENTS_COUNT
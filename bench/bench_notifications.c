@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xpack/notifications.h"
+#include "bench.h"
+
+//
+// Parsing of the push notifications stream, fed at once and one message per write,
+// the way the server flushes them.
+//
+
+typedef struct NotificationsBench {
+    NotificationListener *listener;
+    char *stream;
+    // start of each message in the stream, and the end of the stream
+    size_t *offsets;
+    size_t messages_count;
+} NotificationsBench;
+
+static void notifications_bench_handler(void *target, NotificationListenerEvent *event) {
+    bench_consume((intptr_t) event->data);
+}
+
+static void notifications_bench_single_write(void *target, size_t iterations) {
+    NotificationsBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        notification_listener_test(bench->listener, bench->stream);
+    }
+}
+
+static void notifications_bench_per_message(void *target, size_t iterations) {
+    NotificationsBench *bench = target;
+    char message[256];
+    for (size_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0; j < bench->messages_count; ++j) {
+            size_t length = bench->offsets[j + 1] - bench->offsets[j];
+            memcpy(message, bench->stream + bench->offsets[j], length);
+            message[length] = '\0';
+            notification_listener_test(bench->listener, message);
+        }
+    }
+}
+
+static void notifications_bench_generate_stream(NotificationsBench *bench, size_t events_count) {
+    // besides the events, one keep-alive comment and two other events per ten
+    size_t messages_capacity = events_count + events_count / 10 * 3 + 3;
+    size_t capacity = messages_capacity * 160 + 1;
+    bench->stream = malloc(capacity);
+    bench->offsets = calloc(messages_capacity + 1, sizeof(size_t));
+    size_t offset = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < events_count; ++i) {
+        bench->offsets[count++] = offset;
+        offset += snprintf(bench->stream + offset, capacity - offset,
+                           "id: %zu\nevent: changed\ndata: {\"changed\": true, \"appKey\": \"5e579ecfc45c395c43b42893\", "
+                           "\"updatedAt\": 1580000000%03zu}\n\n", i, i % 1000);
+        // comments and the other events are skipped by the listener, but still parsed
+        if (i % 5 == 4) {
+            bench->offsets[count++] = offset;
+            offset += snprintf(bench->stream + offset, capacity - offset,
+                               "event: other\ndata: {\"ignored\": %zu}\n\n", i);
+        }
+        if (i % 10 == 9) {
+            bench->offsets[count++] = offset;
+            offset += snprintf(bench->stream + offset, capacity - offset, ":keep-alive\n\n");
+        }
+    }
+    bench->offsets[count] = offset;
+    bench->messages_count = count;
+}
+
+static void notifications_bench_run(size_t events_count, size_t iterations) {
+    char single_write_name[64], per_message_name[64];
+    snprintf(single_write_name, sizeof(single_write_name), "notifications/sse/%zu_events/single_write", events_count);
+    snprintf(per_message_name, sizeof(per_message_name), "notifications/sse/%zu_events/per_message", events_count);
+    if (!bench_is_enabled(single_write_name) && !bench_is_enabled(per_message_name)) {
+        return;
+    }
+
+    NotificationListenerConfig config = {"test", "test", true, 0};
+    NotificationsBench bench;
+    bench.listener = notification_listener_create(&config);
+    notification_listener_on(bench.listener, "changed", &bench, &notifications_bench_handler);
+    notifications_bench_generate_stream(&bench, events_count);
+
+    bench_run(single_write_name, &bench, &notifications_bench_single_write, iterations);
+    bench_run(per_message_name, &bench, &notifications_bench_per_message, iterations);
+
+    free(bench.offsets);
+    free(bench.stream);
+    notification_listener_free(bench.listener);
+}
+
+void bench_notifications() {
+    notifications_bench_run(100, 2000);
+    notifications_bench_run(10000, 20);
+}
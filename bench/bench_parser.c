@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rox/context.h"
+#include "core/epoch.h"
+#include "collections.h"
+#include "bench.h"
+
+//
+// Tokenizing, compiling and evaluating the conditions the way the flags do,
+// on the properties and target groups of a generated configuration.
+//
+
+typedef struct ParserBenchCondition {
+    const char *name;
+    const char *expression;
+} ParserBenchCondition;
+
+static const ParserBenchCondition parser_bench_conditions[] = {
+        {"constant",     "and(eq(1, 1), or(false, true))"},
+        {"target_group", "ifThen(isInTargetGroup(\"tg0\"), \"red\", \"blue\")"},
+        {"percentage",   "isInPercentageRange(0.0, 0.5, mergeSeed(\"exp1\", property(\"userId\")))"},
+        {"in_array",     "inArray(property(\"country\"), [\"US\", \"GB\", \"DE\", \"FR\"])"},
+        {"semver",       "semverGte(property(\"version\"), \"1.2.3\")"},
+        {"regex",        "match(property(\"userId\"), \"^user-[0-9]+$\", \"\")"},
+        {"nested",       "ifThen(and(inArray(property(\"country\"), [\"US\", \"GB\"]), "
+                         "or(eq(property(\"plan\"), \"enterprise\"), isInTargetGroup(\"tg1\"))), "
+                         "\"true\", \"false\")"}
+};
+
+static const char *const parser_bench_operators[] = {
+        "and", "or", "eq", "ne", "ifThen", "isInTargetGroup", "isInPercentageRange",
+        "mergeSeed", "property", "inArray", "semverGte", "match"
+};
+
+typedef struct ParserBench {
+    BenchSdk *sdk;
+    RoxMap *operators;
+    RoxContext *context;
+    const char *expression;
+} ParserBench;
+
+static void parser_bench_tokenize(void *target, size_t iterations) {
+    ParserBench *bench = target;
+    for (size_t i = 0; i < iterations; ++i) {
+        RoxList *tokens = tokenized_expression_get_tokens(bench->expression, bench->operators);
+        bench_consume(rox_list_size(tokens));
+        rox_list_free_cb(tokens, (void (*)(void *)) &node_free);
+    }
+}
+
+static void parser_bench_compile_and_evaluate(void *target, size_t iterations) {
+    ParserBench *bench = target;
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, NULL, bench->context);
+    for (size_t i = 0; i < iterations; ++i) {
+        parser_clear_compiled_expressions(bench->sdk->parser);
+        EvaluationResult *result = parser_evaluate_expression(bench->sdk->parser, bench->expression, &eval_context);
+        bench_consume((intptr_t) result);
+        result_free(result);
+    }
+}
+
+static void parser_bench_evaluate(void *target, size_t iterations) {
+    ParserBench *bench = target;
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, NULL, bench->context);
+    for (size_t i = 0; i < iterations; ++i) {
+        EvaluationResult *result = parser_evaluate_expression(bench->sdk->parser, bench->expression, &eval_context);
+        bench_consume((intptr_t) result);
+        result_free(result);
+    }
+}
+
+static void parser_bench_evaluate_value(void *target, size_t iterations) {
+    ParserBench *bench = target;
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, NULL, bench->context);
+    for (size_t i = 0; i < iterations; ++i) {
+        VmValue value;
+        int epoch_token = epoch_read_begin();
+        parser_evaluate_expression_value(bench->sdk->parser, bench->expression, &eval_context, &value);
+        bench_consume(value.type);
+        vm_value_release(&value);
+        epoch_read_end(epoch_token);
+    }
+}
+
+void bench_parser() {
+    ParserBench bench;
+    bench.sdk = bench_sdk_create();
+    bench.operators = rox_map_create();
+    for (size_t i = 0; i < sizeof(parser_bench_operators) / sizeof(parser_bench_operators[0]); ++i) {
+        rox_map_add(bench.operators, (void *) parser_bench_operators[i], "true");
+    }
+    bench.context = rox_context_create_from_map(ROX_MAP(
+            ROX_COPY("userId"), rox_dynamic_value_create_string_copy("user-12345"),
+            ROX_COPY("plan"), rox_dynamic_value_create_string_copy("free")));
+
+    BenchConfigurationParser *configuration_parser = bench_configuration_parser_create();
+    char *json = bench_generate_configuration_json(100);
+    Configuration *configuration = bench_configuration_parser_parse(configuration_parser, json);
+    bench_sdk_apply(bench.sdk, configuration);
+    configuration_free(configuration);
+    free(json);
+    bench_configuration_parser_free(configuration_parser);
+
+    char name[64];
+    for (size_t i = 0; i < sizeof(parser_bench_conditions) / sizeof(parser_bench_conditions[0]); ++i) {
+        bench.expression = parser_bench_conditions[i].expression;
+
+        snprintf(name, sizeof(name), "parser/tokenize/%s", parser_bench_conditions[i].name);
+        bench_run(name, &bench, &parser_bench_tokenize, 100000);
+
+        snprintf(name, sizeof(name), "parser/compile_evaluate/%s", parser_bench_conditions[i].name);
+        bench_run(name, &bench, &parser_bench_compile_and_evaluate, 50000);
+
+        snprintf(name, sizeof(name), "parser/evaluate/%s", parser_bench_conditions[i].name);
+        bench_run(name, &bench, &parser_bench_evaluate, 500000);
+
+        snprintf(name, sizeof(name), "parser/evaluate_value/%s", parser_bench_conditions[i].name);
+        bench_run(name, &bench, &parser_bench_evaluate_value, 500000);
+    }
+
+    rox_context_free(bench.context);
+    rox_map_free(bench.operators);
+    bench_sdk_free(bench.sdk);
+}
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cjson/cJSON.h>
+
+#include "core/configuration/models.h"
+#include "core/impression.h"
+#include "core/properties.h"
+#include "eval/extensions.h"
+#include "collections.h"
+#include "util.h"
+#include "bench.h"
+
+static RoxDynamicValue *bench_sdk_context_property(void *target, RoxContext *context) {
+    return context ? rox_context_get(context, (const char *) target) : NULL;
+}
+
+BenchSdk *bench_sdk_create() {
+    BenchSdk *sdk = calloc(1, sizeof(BenchSdk));
+    sdk->parser = parser_create();
+    sdk->configuration_repository = configuration_repository_create();
+    sdk->experiment_repository = experiment_repository_create_with_configuration(sdk->configuration_repository);
+    sdk->target_group_repository = target_group_repository_create_with_configuration(sdk->configuration_repository);
+    sdk->flag_repository = flag_repository_create();
+    sdk->custom_property_repository = custom_property_repository_create();
+    sdk->dynamic_properties = dynamic_properties_create();
+    sdk->impression_invoker = impression_invoker_create();
+    sdk->flag_setter = flag_setter_create(
+            sdk->flag_repository,
+            sdk->parser,
+            sdk->experiment_repository,
+            sdk->impression_invoker);
+    sdk->entities_provider = entities_provider_create();
+
+    parser_add_properties_extensions(sdk->parser, sdk->custom_property_repository, sdk->dynamic_properties);
+    parser_add_experiments_extensions(sdk->parser, sdk->target_group_repository, sdk->flag_repository,
+                                      sdk->experiment_repository);
+
+    // the properties used by the generated conditions, two of them only known from the context
+    custom_property_repository_add_custom_property(
+            sdk->custom_property_repository,
+            custom_property_create_using_value(
+                    "country", &ROX_CUSTOM_PROPERTY_TYPE_STRING,
+                    rox_dynamic_value_create_string_copy("US")));
+    custom_property_repository_add_custom_property(
+            sdk->custom_property_repository,
+            custom_property_create_using_value(
+                    "version", &ROX_CUSTOM_PROPERTY_TYPE_SEMVER,
+                    rox_dynamic_value_create_string_copy("1.4.0")));
+    custom_property_repository_add_custom_property(
+            sdk->custom_property_repository,
+            custom_property_create(
+                    "userId", &ROX_CUSTOM_PROPERTY_TYPE_STRING,
+                    "userId", &bench_sdk_context_property));
+    custom_property_repository_add_custom_property(
+            sdk->custom_property_repository,
+            custom_property_create(
+                    "plan", &ROX_CUSTOM_PROPERTY_TYPE_STRING,
+                    "plan", &bench_sdk_context_property));
+    return sdk;
+}
+
+void bench_sdk_apply(BenchSdk *sdk, Configuration *configuration) {
+    assert(sdk);
+    assert(configuration);
+
+    RoxList *conditions = rox_list_create();
+    ROX_LIST_FOREACH(item, configuration->experiments, {
+        rox_list_add(conditions, ((ExperimentModel *) item)->condition);
+    })
+    ROX_LIST_FOREACH(item, configuration->target_groups, {
+        rox_list_add(conditions, ((TargetGroupModel *) item)->condition);
+    })
+    parser_set_compiled_expressions(sdk->parser, conditions);
+    rox_list_free(conditions);
+
+    configuration_repository_set_configuration(
+            sdk->configuration_repository,
+            mem_deep_copy_list(configuration->experiments,
+                               (void *(*)(void *)) &experiment_model_copy),
+            mem_deep_copy_list(configuration->target_groups,
+                               (void *(*)(void *)) &target_group_model_copy));
+
+    flag_setter_set_experiments(sdk->flag_setter);
+}
+
+void bench_sdk_free(BenchSdk *sdk) {
+    assert(sdk);
+    entities_provider_free(sdk->entities_provider);
+    flag_setter_free(sdk->flag_setter);
+    flag_repository_free(sdk->flag_repository);
+    parser_free(sdk->parser);
+    target_group_repository_free(sdk->target_group_repository);
+    experiment_repository_free(sdk->experiment_repository);
+    configuration_repository_free(sdk->configuration_repository);
+    custom_property_repository_free(sdk->custom_property_repository);
+    impression_invoker_free(sdk->impression_invoker);
+    dynamic_properties_free(sdk->dynamic_properties);
+    free(sdk);
+}
+
+BenchConfigurationParser *bench_configuration_parser_create() {
+    BenchConfigurationParser *parser = calloc(1, sizeof(BenchConfigurationParser));
+    parser->signature_verifier = signature_verifier_create_dummy();
+    parser->error_reporter = error_reporter_create(NULL);
+    parser->api_key_verifier = api_key_verifier_create_dummy();
+    parser->configuration_fetched_invoker = configuration_fetched_invoker_create();
+    parser->parser = configuration_parser_create(
+            parser->signature_verifier,
+            parser->error_reporter,
+            parser->api_key_verifier,
+            parser->configuration_fetched_invoker,
+            false);
+    return parser;
+}
+
+Configuration *bench_configuration_parser_parse(BenchConfigurationParser *parser, const char *json) {
+    assert(parser);
+    assert(json);
+    ConfigurationFetchResult *fetch_result = configuration_fetch_result_create(
+            cJSON_Parse(json), CONFIGURATION_SOURCE_API);
+    Configuration *configuration = configuration_parser_parse(parser->parser, fetch_result);
+    configuration_fetch_result_free(fetch_result);
+    assert(configuration);
+    return configuration;
+}
+
+void bench_configuration_parser_free(BenchConfigurationParser *parser) {
+    assert(parser);
+    configuration_parser_free(parser->parser);
+    configuration_fetched_invoker_free(parser->configuration_fetched_invoker);
+    api_key_verifier_free(parser->api_key_verifier);
+    error_reporter_free(parser->error_reporter);
+    signature_verifier_free(parser->signature_verifier);
+    free(parser);
+}
+
+//
+// Experiment N uses the condition N % 4 and the target group N / 10.
+//
+
+static const char *const bench_experiment_conditions[] = {
+        "ifThen(isInTargetGroup(\"tg%d\"), \"true\", \"false\")",
+        "ifThen(isInPercentageRange(0.0, 0.5, mergeSeed(\"exp%d\", property(\"userId\"))), \"true\", \"false\")",
+        "ifThen(and(inArray(property(\"country\"), [\"US\", \"GB\", \"DE\", \"FR\"]), "
+        "semverGte(property(\"version\"), \"1.2.3\")), \"true\", \"false\")",
+        "ifThen(or(eq(property(\"plan\"), \"enterprise\"), isInTargetGroup(\"tg%d\")), \"true\", \"false\")"
+};
+
+#define ROX_BENCH_CONDITIONS_COUNT (sizeof(bench_experiment_conditions) / sizeof(bench_experiment_conditions[0]))
+
+char *bench_generate_configuration_json(int experiments_count) {
+    assert(experiments_count > 0);
+    char buffer[512];
+
+    cJSON *experiments = cJSON_CreateArray();
+    for (int i = 0; i < experiments_count; ++i) {
+        char id[32], name[32], flag[32];
+        snprintf(id, sizeof(id), "exp%d", i);
+        snprintf(name, sizeof(name), "experiment%d", i);
+        snprintf(flag, sizeof(flag), "flag%d", i);
+        int group = (i % ROX_BENCH_CONDITIONS_COUNT == 1) ? i : i / 10;
+        snprintf(buffer, sizeof(buffer), bench_experiment_conditions[i % ROX_BENCH_CONDITIONS_COUNT], group);
+        cJSON_AddItemToArray(experiments, ROX_JSON_OBJECT(
+                "_id", ROX_JSON_STRING(id),
+                "name", ROX_JSON_STRING(name),
+                "deploymentConfiguration", ROX_JSON_OBJECT("condition", ROX_JSON_STRING(buffer)),
+                "featureFlags", ROX_JSON_ARRAY(ROX_JSON_OBJECT("name", ROX_JSON_STRING(flag))),
+                "archived", ROX_JSON_FALSE,
+                "labels", ROX_JSON_ARRAY(ROX_JSON_STRING("bench")),
+                "stickinessProperty", ROX_JSON_STRING("rox.distinct_id")));
+    }
+
+    cJSON *target_groups = cJSON_CreateArray();
+    for (int i = 0; i <= experiments_count / 10; ++i) {
+        char id[32];
+        snprintf(id, sizeof(id), "tg%d", i);
+        snprintf(buffer, sizeof(buffer),
+                 i % 2 == 0
+                 ? "eq(property(\"country\"), \"US\")"
+                 : "and(semverGte(property(\"version\"), \"1.%d.0\"), ne(property(\"country\"), \"GB\"))",
+                 i % 10);
+        cJSON_AddItemToArray(target_groups, ROX_JSON_OBJECT(
+                "_id", ROX_JSON_STRING(id),
+                "condition", ROX_JSON_STRING(buffer)));
+    }
+
+    cJSON *data = ROX_JSON_OBJECT(
+            "application", ROX_JSON_STRING("bench"),
+            "experiments", experiments,
+            "targetGroups", target_groups);
+    char *data_str = cJSON_PrintUnformatted(data);
+    cJSON_Delete(data);
+
+    cJSON *json = ROX_JSON_OBJECT(
+            "data", ROX_JSON_STRING(data_str),
+            "signed_date", ROX_JSON_STRING("2020-01-01T00:00:00.000Z"),
+            "signature_v0", ROX_JSON_STRING("bench"));
+    free(data_str);
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    return str;
+}
+
+#undef ROX_BENCH_CONDITIONS_COUNT
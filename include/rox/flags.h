@@ -145,3 +145,57 @@ ROX_API double rox_get_double(RoxStringBase *variant);
  * @return Current value or <code>default_value</code> passed to <code>rox_add_double()</code>, if the value is not defined.
  */
 ROX_API double rox_get_double_ctx(RoxStringBase *variant, RoxContext *context);
+
+/**
+ * Evaluation session: a number of flags evaluated for the same request, e.g. while handling it.
+ * The flags read through the session give the same values as <code>rox_get_*_ctx()</code> with
+ * the session context, but the merged context and the values of the computed properties, target
+ * groups and dependent flags are shared by all of them, and the impressions are reported together
+ * when the session ends.
+ *
+ * A session must be used by a single thread at a time.
+ */
+typedef struct RoxEvalSession RoxEvalSession;
+
+/**
+ * @param context May be <code>NULL</code>. The caller keeps the ownership; it must outlive the session.
+ * @return Not <code>NULL</code>. Must be ended by <code>rox_eval_session_end()</code>.
+ */
+ROX_API RoxEvalSession *rox_eval_session_begin(RoxContext *context);
+
+/**
+ * The returned value must be freed after use by the caller, if not <code>NULL</code>.
+ *
+ * @param session Not <code>NULL</code>.
+ * @param variant Not <code>NULL</code>.
+ * @return Same as <code>rox_get_string_ctx()</code>.
+ */
+ROX_API char *rox_eval_session_get_string(RoxEvalSession *session, RoxStringBase *variant);
+
+/**
+ * @param session Not <code>NULL</code>.
+ * @param variant Not <code>NULL</code>.
+ * @return Same as <code>rox_is_enabled_ctx()</code>.
+ */
+ROX_API bool rox_eval_session_is_enabled(RoxEvalSession *session, RoxStringBase *variant);
+
+/**
+ * @param session Not <code>NULL</code>.
+ * @param variant Not <code>NULL</code>.
+ * @return Same as <code>rox_get_int_ctx()</code>.
+ */
+ROX_API int rox_eval_session_get_int(RoxEvalSession *session, RoxStringBase *variant);
+
+/**
+ * @param session Not <code>NULL</code>.
+ * @param variant Not <code>NULL</code>.
+ * @return Same as <code>rox_get_double_ctx()</code>.
+ */
+ROX_API double rox_eval_session_get_double(RoxEvalSession *session, RoxStringBase *variant);
+
+/**
+ * Reports the impressions of the flags read through the session, and frees it.
+ *
+ * @param session Not <code>NULL</code>.
+ */
+ROX_API void rox_eval_session_end(RoxEvalSession *session);
@@ -84,4 +84,14 @@ ROX_API void rox_options_set_dynamic_properties_rule(
  * @param options Not <code>NULL</code>.
  * @param verification_disabled if the system skips checking the signature verification. true, yes (platform preferred); false no
  */
-ROX_API void rox_options_set_disable_signature_verification(RoxOptions *options, bool verification_disabled);
\ No newline at end of file
+ROX_API void rox_options_set_disable_signature_verification(RoxOptions *options, bool verification_disabled);
+
+/**
+ * When enabled, <code>rox_setup()</code> returns without waiting for the initial configuration fetch,
+ * which is performed in background. Until it's applied, the flags have their default values (or the cached
+ * configuration ones in the client mode). Use <code>rox_wait_until_ready()</code> to wait for it with a deadline.
+ *
+ * @param options Not <code>NULL</code>.
+ * @param async_setup Whether the initial fetch is performed in background. <code>false</code> by default.
+ */
+ROX_API void rox_options_set_async_setup(RoxOptions *options, bool async_setup);
\ No newline at end of file
@@ -20,6 +20,16 @@ ROX_API void rox_set_context(RoxContext *context);
 
 ROX_API void rox_fetch();
 
+/**
+ * Waits for the initial configuration fetch started by <code>rox_setup()</code>, which is done
+ * in background when <code>rox_options_set_async_setup()</code> is enabled. Returns immediately otherwise.
+ *
+ * @param timeout_ms Maximum time to wait, in milliseconds. <code>0</code> just checks.
+ * @return Whether the initial fetch is done, successfully or not, before the timeout.
+ * The configuration fetched handler tells its outcome.
+ */
+ROX_API bool rox_wait_until_ready(int timeout_ms);
+
 /**
  * Should be called to free all the rox memory. After this,
  * no <code>rox_xxx</code> method can be called anymore.
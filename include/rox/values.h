@@ -8,6 +8,10 @@
 //
 // DynamicValue
 //
+// Values are immutable once created, and may be shared by the SDK instead of copied. So the strings,
+// lists and maps returned by the getters must not be modified; use <code>rox_dynamic_value_create_copy()</code>
+// to get a value of your own.
+//
 
 typedef struct RoxDynamicValue RoxDynamicValue;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <ctime>
 
 extern "C" {
@@ -11,13 +12,53 @@ namespace Rox {
 
     typedef struct RoxContext Context;
 
+    /**
+     * Builds a context which keys and values are stored in a single block of memory owned by the context.
+     * The built context is freed with <code>rox_context_free()</code>.
+     *
+     * A worker that builds a context per request can reuse one of them, along with its memory:
+     *
+     * <pre>
+     * context = builder.Reset(context).AddStringValue("userId", userId).Build();
+     * </pre>
+     *
+     * The values returned by <code>rox_context_get()</code> are copies, as usual, but the ones passed
+     * to the custom properties and the impression handlers are valid until the context is reset or freed.
+     */
     class ROX_API ContextBuilder {
     private:
-        RoxMap *_map;
+        Context *_context;
+        size_t _reserveCount;
+        size_t _reserveBytes;
+
+        Context *GetContext();
 
     public:
         ContextBuilder();
 
+        ~ContextBuilder();
+
+        ContextBuilder(const ContextBuilder &) = delete;
+
+        ContextBuilder &operator=(const ContextBuilder &) = delete;
+
+        /**
+         * Reserves the room for the given number of entries, so that adding them doesn't allocate.
+         *
+         * @param count Number of the entries to be added.
+         * @param bytes Total length of their names and string values.
+         */
+        ContextBuilder &Reserve(size_t count, size_t bytes = 0);
+
+        /**
+         * Removes all the entries of a previously built context and continues building it, so that
+         * <code>Build()</code> returns the same context again.
+         *
+         * @param context May be <code>NULL</code>, which starts a new context. Otherwise it must be
+         * built by a <code>ContextBuilder</code>, and not used by an ongoing evaluation.
+         */
+        ContextBuilder &Reset(Context *context);
+
         ContextBuilder &AddBoolValue(const char *name, bool value);
 
         ContextBuilder &AddIntValue(const char *name, int value);
@@ -34,4 +75,4 @@ namespace Rox {
 
         Context *Build();
     };
-}
\ No newline at end of file
+}
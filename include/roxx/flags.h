@@ -15,6 +15,8 @@ namespace Rox {
     class ROX_API BaseFlag {
         friend void Shutdown();
 
+        friend class EvalSession;
+
     protected:
         RoxStringBase *_variant;
 
@@ -85,4 +87,30 @@ namespace Rox {
 
         static Double *Create(const char *name, double defaultValue, const std::vector<double> &options);
     };
+
+    /**
+     * Evaluation session, see <code>rox_eval_session_begin()</code>. The impressions are reported
+     * when the session is destroyed.
+     */
+    class ROX_API EvalSession {
+    private:
+        RoxEvalSession *_session;
+
+    public:
+        explicit EvalSession(Context *context = nullptr);
+
+        ~EvalSession();
+
+        EvalSession(const EvalSession &) = delete;
+
+        EvalSession &operator=(const EvalSession &) = delete;
+
+        char *GetValue(String *flag);
+
+        bool IsEnabled(Flag *flag);
+
+        int GetValue(Int *flag);
+
+        double GetValue(Double *flag);
+    };
 }
\ No newline at end of file
@@ -34,6 +34,8 @@ namespace Rox {
 
         OptionsBuilder &SetDisableSignatureVerification(bool verificationDisabled);
 
+        OptionsBuilder &SetAsyncSetup(bool asyncSetup);
+
         Options *Build();
 
     protected:
@@ -18,6 +18,8 @@ namespace Rox {
 
     ROX_API void Fetch();
 
+    ROX_API bool WaitUntilReady(int timeoutMs);
+
     ROX_API void Shutdown();
 
     class ROX_API SetupException : public std::exception {
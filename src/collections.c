@@ -1,73 +1,231 @@
 #include "collections.h"
 #include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <math.h>
-#include <collectc/list.h>
-#include <collectc/hashset.h>
-#include <collectc/hashtable.h>
 #include "util.h"
 
+//
+// RoxMap and RoxSet are open addressing hash tables of string keys with robin hood probing:
+// an inserted entry takes the slot of any entry closer to its home slot, which keeps the probe
+// sequences short, and a lookup stops at the first entry closer to its home than the looked up
+// key would be. The hash is stored in the slot next to the key, so that the keys are only
+// compared when the hashes match and never rehashed when the table grows.
+//
+
+typedef struct RoxHashSlot {
+    size_t hash; // 0 when the slot is empty
+    void *key;
+    void *value;
+} RoxHashSlot;
+
+typedef struct RoxHashTable {
+    RoxHashSlot *slots;
+    size_t capacity; // 0 or a power of two
+    size_t size;
+} RoxHashTable;
+
+#define ROX_HASH_TABLE_MIN_CAPACITY 8
+
 struct RoxMap {
-    HashTable *map;
+    RoxHashTable table;
 };
 
+//
+// RoxList is a growable array of pointers: appending is amortized O(1), indexed access is O(1),
+// and the items are iterated, reversed and sorted in place.
+//
+
+#define ROX_LIST_MIN_CAPACITY 4
+
 struct RoxList {
-    List *list;
+    void **items;
+    size_t size;
+    size_t capacity;
 };
 
 struct RoxSet {
-    HashSet *set;
+    RoxHashTable table;
 };
 
-struct RoxListIter {
-    ListIter iter;
-};
+static size_t hash_table_hash(const char *key) {
+    // FNV-1a, with the high bits folded in as the table index is taken from the low ones
+#if SIZE_MAX > 0xFFFFFFFFu
+    size_t hash = (size_t) 14695981039346656037u;
+    const size_t prime = (size_t) 1099511628211u;
+#else
+    size_t hash = (size_t) 2166136261u;
+    const size_t prime = (size_t) 16777619u;
+#endif
+    for (const unsigned char *c = (const unsigned char *) key; *c; ++c) {
+        hash ^= *c;
+        hash *= prime;
+    }
+    hash ^= hash >> (sizeof(size_t) * 4);
+    return hash ? hash : 1;
+}
 
-struct RoxSetIter {
-    HashSetIter iter;
-};
+static size_t hash_table_distance(RoxHashTable *table, size_t index, size_t hash) {
+    return (index - hash) & (table->capacity - 1);
+}
 
-struct RoxMapIter {
-    HashTableIter iter;
-};
+static RoxHashSlot *hash_table_find(RoxHashTable *table, const char *key, size_t hash) {
+    if (table->size == 0) {
+        return NULL;
+    }
+    size_t mask = table->capacity - 1;
+    for (size_t index = hash & mask, distance = 0;; index = (index + 1) & mask, ++distance) {
+        RoxHashSlot *slot = &table->slots[index];
+        if (!slot->hash || hash_table_distance(table, index, slot->hash) < distance) {
+            return NULL;
+        }
+        if (slot->hash == hash && strcmp(slot->key, key) == 0) {
+            return slot;
+        }
+    }
+}
+
+/**
+ * The key must not be in the table yet, and there must be a free slot.
+ */
+static void hash_table_insert_new(RoxHashTable *table, size_t hash, void *key, void *value) {
+    RoxHashSlot entry = {hash, key, value};
+    size_t mask = table->capacity - 1;
+    for (size_t index = hash & mask, distance = 0;; index = (index + 1) & mask, ++distance) {
+        RoxHashSlot *slot = &table->slots[index];
+        if (!slot->hash) {
+            *slot = entry;
+            ++table->size;
+            return;
+        }
+        size_t slot_distance = hash_table_distance(table, index, slot->hash);
+        if (slot_distance < distance) {
+            RoxHashSlot displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+            distance = slot_distance;
+        }
+    }
+}
+
+static void hash_table_grow(RoxHashTable *table) {
+    RoxHashSlot *slots = table->slots;
+    size_t capacity = table->capacity;
+    table->capacity = capacity ? capacity * 2 : ROX_HASH_TABLE_MIN_CAPACITY;
+    table->slots = calloc(table->capacity, sizeof(RoxHashSlot));
+    table->size = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (slots[i].hash) {
+            hash_table_insert_new(table, slots[i].hash, slots[i].key, slots[i].value);
+        }
+    }
+    free(slots);
+}
+
+static void hash_table_reserve(RoxHashTable *table, size_t size) {
+    while (size * 5 > table->capacity * 4) {
+        hash_table_grow(table);
+    }
+}
+
+/**
+ * Same as the collectc hash table did, the value of an existing key is replaced, but the key is kept.
+ */
+static void hash_table_put(RoxHashTable *table, void *key, void *value) {
+    size_t hash = hash_table_hash(key);
+    RoxHashSlot *slot = hash_table_find(table, key, hash);
+    if (slot) {
+        slot->value = value;
+        return;
+    }
+    // keeps the load factor under 80%
+    if ((table->size + 1) * 5 > table->capacity * 4) {
+        hash_table_grow(table);
+    }
+    hash_table_insert_new(table, hash, key, value);
+}
+
+static void hash_table_remove_slot(RoxHashTable *table, RoxHashSlot *slot) {
+    // shifts the following entries back, so that no tombstones are needed
+    size_t mask = table->capacity - 1;
+    size_t index = slot - table->slots;
+    while (true) {
+        size_t next = (index + 1) & mask;
+        RoxHashSlot *next_slot = &table->slots[next];
+        if (!next_slot->hash || hash_table_distance(table, next, next_slot->hash) == 0) {
+            break;
+        }
+        table->slots[index] = *next_slot;
+        index = next;
+    }
+    memset(&table->slots[index], 0, sizeof(RoxHashSlot));
+    --table->size;
+}
+
+static void hash_table_copy(RoxHashTable *dest, RoxHashTable *src) {
+    dest->capacity = src->capacity;
+    dest->size = src->size;
+    dest->slots = src->capacity ? mem_copy(src->slots, src->capacity * sizeof(RoxHashSlot)) : NULL;
+}
+
+static bool hash_table_iter_next(RoxHashTable *table, size_t *index, RoxHashSlot **out) {
+    while (*index < table->capacity) {
+        RoxHashSlot *slot = &table->slots[(*index)++];
+        if (slot->hash) {
+            *out = slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+#undef ROX_HASH_TABLE_MIN_CAPACITY
 
 ROX_INTERNAL RoxMap *rox_map_create() {
-    RoxMap *map = calloc(1, sizeof(RoxMap));
-    hashtable_new(&map->map);
-    return map;
+    return calloc(1, sizeof(RoxMap));
 }
 
 ROX_INTERNAL void rox_map_free(RoxMap *map) {
     assert(map);
-    hashtable_destroy(map->map);
+    free(map->table.slots);
     free(map);
 }
 
 ROX_INTERNAL RoxSet *rox_set_create() {
-    RoxSet *set = calloc(1, sizeof(RoxSet));
-    hashset_new(&set->set);
-    return set;
+    return calloc(1, sizeof(RoxSet));
 }
 
 ROX_INTERNAL void rox_set_free(RoxSet *set) {
     assert(set);
-    hashset_destroy(set->set);
+    free(set->table.slots);
     free(set);
 }
 
 ROX_INTERNAL RoxList *rox_list_create() {
-    RoxList *list = calloc(1, sizeof(RoxList));
-    list_new(&list->list);
-    return list;
+    return calloc(1, sizeof(RoxList));
 }
 
 ROX_INTERNAL void rox_list_free(RoxList *list) {
     assert(list);
-    list_destroy(list->list);
+    free(list->items);
     free(list);
 }
 
+static void list_reserve(RoxList *list, size_t capacity) {
+    assert(list);
+    if (capacity <= list->capacity) {
+        return;
+    }
+    size_t new_capacity = list->capacity ? list->capacity : ROX_LIST_MIN_CAPACITY;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+    list->items = realloc(list->items, new_capacity * sizeof(void *));
+    list->capacity = new_capacity;
+}
+
 ROX_INTERNAL RoxMapIter *rox_map_iter_create() {
     return calloc(1, sizeof(RoxMapIter));
 }
@@ -97,26 +255,36 @@ ROX_INTERNAL void rox_list_iter_free(RoxListIter *iter) {
 
 ROX_INTERNAL void rox_list_free_cb(RoxList *list, void (*cb)(void *)) {
     assert(list);
-    list_destroy_cb(list->list, cb);
-    free(list);
+    assert(cb);
+    for (size_t i = 0; i < list->size; ++i) {
+        cb(list->items[i]);
+    }
+    rox_list_free(list);
 }
 
 ROX_INTERNAL bool rox_map_add(RoxMap *map, void *key, void *val) {
     assert(map);
     assert(key);
-    return hashtable_add(map->map, key, val) == CC_OK;
+    hash_table_put(&map->table, key, val);
+    return true;
 }
 
 ROX_INTERNAL bool rox_map_remove(RoxMap *map, void *key, void **out) {
     assert(map);
     assert(key);
     assert(out);
-    return hashtable_remove(map->map, key, out) == CC_OK;
+    RoxHashSlot *slot = hash_table_find(&map->table, key, hash_table_hash(key));
+    if (!slot) {
+        return false;
+    }
+    *out = slot->value;
+    hash_table_remove_slot(&map->table, slot);
+    return true;
 }
 
 ROX_INTERNAL bool rox_map_remove_cb(RoxMap *map, void *key, void (*cb)(void *)) {
     void *value;
-    if (rox_map_get(map, key, &value)) {
+    if (rox_map_remove(map, key, &value)) {
         cb(value);
         return true;
     }
@@ -128,130 +296,187 @@ ROX_INTERNAL bool rox_map_remove_key_value_cb(
         void *key,
         void (*f_key)(void *),
         void (*f_value)(void *)) {
-    bool removed = false;
-    void *key_to_remove = NULL;
-    void *value_to_remove = NULL;
-    ROX_MAP_FOREACH(k, v, map, {
-        if (str_equals(k, key)) {
-            removed = hashtable_remove(map->map, k, NULL) == CC_OK;
-            key_to_remove = k;
-            value_to_remove = v;
-            break;
-        }
-    })
-    if (key_to_remove) {
-        f_key(key_to_remove);
+    assert(map);
+    assert(key);
+    RoxHashSlot *slot = hash_table_find(&map->table, key, hash_table_hash(key));
+    if (!slot) {
+        return false;
     }
+    void *key_to_remove = slot->key;
+    void *value_to_remove = slot->value;
+    hash_table_remove_slot(&map->table, slot);
+    f_key(key_to_remove);
     if (value_to_remove) {
         f_value(value_to_remove);
     }
-    return removed;
+    return true;
 }
 
 ROX_INTERNAL bool rox_map_contains_key(RoxMap *map, void *key) {
     assert(map);
     assert(key);
-    return hashtable_contains_key(map->map, key);
+    return hash_table_find(&map->table, key, hash_table_hash(key)) != NULL;
 }
 
 ROX_INTERNAL bool rox_map_get(RoxMap *map, void *key, void **out) {
+    assert(map);
+    assert(key);
+    return rox_map_get_hashed(map, key, hash_table_hash(key), out);
+}
+
+ROX_INTERNAL size_t rox_map_hash_key(const char *key) {
+    assert(key);
+    return hash_table_hash(key);
+}
+
+ROX_INTERNAL bool rox_map_get_hashed(RoxMap *map, const char *key, size_t hash, void **out) {
     assert(map);
     assert(key);
     assert(out);
-    return hashtable_get(map->map, key, out) == CC_OK;
+    RoxHashSlot *slot = hash_table_find(&map->table, key, hash);
+    if (!slot) {
+        return false;
+    }
+    *out = slot->value;
+    return true;
+}
+
+ROX_INTERNAL void rox_map_reserve(RoxMap *map, size_t size) {
+    assert(map);
+    hash_table_reserve(&map->table, size);
+}
+
+ROX_INTERNAL void rox_map_clear(RoxMap *map) {
+    assert(map);
+    if (map->table.size > 0) {
+        memset(map->table.slots, 0, map->table.capacity * sizeof(RoxHashSlot));
+        map->table.size = 0;
+    }
 }
 
 ROX_INTERNAL bool rox_list_add(RoxList *list, void *element) {
     assert(list);
-    return list_add(list->list, element) == CC_OK;
+    list_reserve(list, list->size + 1);
+    list->items[list->size++] = element;
+    return true;
 }
 
 ROX_INTERNAL bool rox_set_add(RoxSet *set, void *element) {
     assert(set);
-    return hashset_add(set->set, element) == CC_OK;
+    assert(element);
+    hash_table_put(&set->table, element, NULL);
+    return true;
 }
 
 ROX_INTERNAL size_t rox_list_size(RoxList *list) {
     assert(list);
-    return list_size(list->list);
+    return list->size;
 }
 
 ROX_INTERNAL size_t rox_set_size(RoxSet *set) {
     assert(set);
-    return hashset_size(set->set);
+    return set->table.size;
 }
 
 ROX_INTERNAL size_t rox_map_size(RoxMap *map) {
     assert(map);
-    return hashtable_size(map->map);
+    return map->table.size;
 }
 
 ROX_INTERNAL bool rox_list_sort(RoxList *list, int (*cmp)(void const *, void const *)) {
     assert(list);
-    return list_sort(list->list, cmp) == CC_OK;
+    assert(cmp);
+    if (list->size > 1) {
+        qsort(list->items, list->size, sizeof(void *), cmp);
+    }
+    return true;
 }
 
 ROX_INTERNAL void rox_list_reverse(RoxList *list) {
     assert(list);
-    list_reverse(list->list);
+    for (size_t i = 0, j = list->size; i + 1 < j; ++i, --j) {
+        void *item = list->items[i];
+        list->items[i] = list->items[j - 1];
+        list->items[j - 1] = item;
+    }
 }
 
 ROX_INTERNAL bool rox_list_get_at(RoxList *list, size_t index, void **out) {
     assert(list);
-    assert(index >= 0);
     assert(out);
-    return list_get_at(list->list, index, out) == CC_OK;
+    if (index >= list->size) {
+        return false;
+    }
+    *out = list->items[index];
+    return true;
 }
 
 ROX_INTERNAL bool rox_list_get_first(RoxList *list, void **out) {
     assert(list);
     assert(out);
-    return list_get_first(list->list, out) == CC_OK;
+    return rox_list_get_at(list, 0, out);
 }
 
 ROX_INTERNAL bool rox_list_remove(RoxList *list, void *element) {
     assert(list);
     assert(element);
-    return list_remove(list->list, element, NULL) == CC_OK;
+    for (size_t i = 0; i < list->size; ++i) {
+        if (list->items[i] == element) {
+            memmove(list->items + i, list->items + i + 1, (list->size - i - 1) * sizeof(void *));
+            --list->size;
+            return true;
+        }
+    }
+    return false;
 }
 
 ROX_INTERNAL bool rox_list_remove_all(RoxList *list) {
     assert(list);
-    return list_remove_all(list->list) == CC_OK;
+    if (list->size == 0) {
+        return false;
+    }
+    list->size = 0;
+    return true;
 }
 
 ROX_INTERNAL bool rox_set_contains(RoxSet *set, void *element) {
     assert(set);
     assert(element);
-    return hashset_contains(set->set, element);
+    return hash_table_find(&set->table, element, hash_table_hash(element)) != NULL;
 }
 
 ROX_INTERNAL void rox_list_iter_init(RoxListIter *iter, RoxList *list) {
     assert(iter);
     assert(list);
-    list_iter_init(&iter->iter, list->list);
+    iter->list = list;
+    iter->index = 0;
 }
 
 ROX_INTERNAL bool rox_list_iter_next(RoxListIter *iter, void **out) {
     assert(iter);
     assert(out);
-    return list_iter_next(&iter->iter, out) != CC_ITER_END;
+    if (iter->index >= iter->list->size) {
+        return false;
+    }
+    *out = iter->list->items[iter->index++];
+    return true;
 }
 
 ROX_INTERNAL void rox_map_iter_init(RoxMapIter *iter, RoxMap *map) {
     assert(iter);
     assert(map);
-    hashtable_iter_init(&iter->iter, map->map);
+    iter->table = &map->table;
+    iter->index = 0;
 }
 
 ROX_INTERNAL bool rox_map_iter_next(RoxMapIter *iter, void **key, void **value) {
     assert(iter);
     assert(key);
     assert(value);
-    TableEntry *entry;
-    if (hashtable_iter_next(&iter->iter, &entry) != CC_ITER_END) {
-        *key = entry->key;
-        *value = entry->value;
+    RoxHashSlot *slot;
+    if (hash_table_iter_next(iter->table, &iter->index, &slot)) {
+        *key = slot->key;
+        *value = slot->value;
         return true;
     }
     return false;
@@ -260,45 +485,55 @@ ROX_INTERNAL bool rox_map_iter_next(RoxMapIter *iter, void **key, void **value)
 ROX_INTERNAL void rox_set_iter_init(RoxSetIter *iter, RoxSet *set) {
     assert(iter);
     assert(set);
-    hashset_iter_init(&iter->iter, set->set);
+    iter->table = &set->table;
+    iter->index = 0;
 }
 
 ROX_INTERNAL bool rox_set_iter_next(RoxSetIter *iter, void **out) {
     assert(iter);
     assert(out);
-    return hashset_iter_next(&iter->iter, out) != CC_ITER_END;
+    RoxHashSlot *slot;
+    if (hash_table_iter_next(iter->table, &iter->index, &slot)) {
+        *out = slot->key;
+        return true;
+    }
+    return false;
 }
 
 ROX_INTERNAL RoxMap *mem_copy_map(RoxMap *map) {
     assert(map);
-    RoxMap *params = rox_map_create();
-    ROX_MAP_FOREACH(key, value, map, {
-        hashtable_add(params->map, key, value);
-    })
-    return params;
+    RoxMap *copy = rox_map_create();
+    hash_table_copy(&copy->table, &map->table);
+    return copy;
 }
 
 ROX_INTERNAL RoxList *mem_copy_list(RoxList *list) {
     assert(list);
-    RoxList *copy = calloc(1, sizeof(RoxList));
-    list_copy_shallow(list->list, &copy->list);
+    RoxList *copy = rox_list_create();
+    list_reserve(copy, list->size);
+    if (list->size) {
+        memcpy(copy->items, list->items, list->size * sizeof(void *));
+    }
+    copy->size = list->size;
     return copy;
 }
 
 ROX_INTERNAL RoxList *mem_deep_copy_list(RoxList *list, void *(*copy_func)(void *)) {
     assert(list);
     assert(copy_func);
-    RoxList *copy = calloc(1, sizeof(RoxList));
-    list_copy_deep(list->list, copy_func, &copy->list);
+    RoxList *copy = rox_list_create();
+    list_reserve(copy, list->size);
+    for (size_t i = 0; i < list->size; ++i) {
+        copy->items[i] = copy_func(list->items[i]);
+    }
+    copy->size = list->size;
     return copy;
 }
 
 ROX_INTERNAL RoxSet *mem_copy_set(RoxSet *set) {
     assert(set);
     RoxSet *copy = rox_set_create();
-    ROX_SET_FOREACH(item, set, {
-        hashset_add(copy->set, item);
-    })
+    hash_table_copy(&copy->table, &set->table);
     return copy;
 }
 
@@ -306,17 +541,20 @@ ROX_INTERNAL RoxSet *mem_deep_copy_set(RoxSet *set, void *(*copy_func)(void *))
     assert(set);
     RoxSet *copy = rox_set_create();
     ROX_SET_FOREACH(item, set, {
-        hashset_add(copy->set, copy_func(item));
+        rox_set_add(copy, copy_func(item));
     })
     return copy;
 }
 
 ROX_INTERNAL RoxMap *mem_deep_copy_str_value_map(RoxMap *map) {
     assert(map);
-    RoxMap *copy = rox_map_create();
-    ROX_MAP_FOREACH(key, value, map, {
-        hashtable_add(copy->map, key, mem_copy_str(value));
-    })
+    RoxMap *copy = mem_copy_map(map);
+    for (size_t i = 0; i < copy->table.capacity; ++i) {
+        RoxHashSlot *slot = &copy->table.slots[i];
+        if (slot->hash) {
+            slot->value = mem_copy_str(slot->value);
+        }
+    }
     return copy;
 }
 
@@ -441,12 +679,10 @@ ROX_INTERNAL void rox_map_free_with_keys_and_values(RoxMap *map) {
 
 ROX_INTERNAL void rox_map_free_with_values_cb(RoxMap *map, void (*f)(void *)) {
     assert(map);
-    TableEntry *entry;
     ROX_MAP_FOREACH(key, value, map, {
         f(value);
     })
-    hashtable_destroy(map->map);
-    free(map);
+    rox_map_free(map);
 }
 
 ROX_INTERNAL void rox_map_free_with_keys_and_values_cb(
@@ -458,16 +694,18 @@ ROX_INTERNAL void rox_map_free_with_keys_and_values_cb(
             f_value(value);
         }
     })
-    hashtable_destroy(map->map);
-    free(map);
+    rox_map_free(map);
 }
 
 ROX_INTERNAL bool str_in_list(const char *str, RoxList *list_of_strings) {
     assert(str);
     assert(list_of_strings);
-    return list_contains_value(list_of_strings->list,
-                               (void *) str,
-                               (int (*)(const void *, const void *)) &strcmp);
+    for (size_t i = 0; i < list_of_strings->size; ++i) {
+        if (strcmp(str, list_of_strings->items[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 ROX_INTERNAL char *mem_str_join(const char *separator, RoxList *strings) {
@@ -5,11 +5,29 @@
 #include <stdbool.h>
 #include <stddef.h>
 
-typedef struct RoxListIter RoxListIter;
-
-typedef struct RoxSetIter RoxSetIter;
-
-typedef struct RoxMapIter RoxMapIter;
+//
+// Iterators are defined here so that they can live on the caller's stack:
+//
+//     RoxListIter iter;
+//     rox_list_iter_init(&iter, list);
+//
+// They need no cleanup, so it's safe to leave the loops early.
+//
+
+typedef struct RoxListIter {
+    RoxList *list;
+    size_t index;
+} RoxListIter;
+
+typedef struct RoxSetIter {
+    struct RoxHashTable *table;
+    size_t index;
+} RoxSetIter;
+
+typedef struct RoxMapIter {
+    struct RoxHashTable *table;
+    size_t index;
+} RoxMapIter;
 
 ROX_INTERNAL RoxMap *rox_map_create();
 
@@ -32,6 +50,10 @@ ROX_INTERNAL RoxList *rox_list_create();
 
 ROX_INTERNAL void rox_list_free(RoxList *list);
 
+/**
+ * Heap allocated iterators, for the callers that need them to outlive the current scope.
+ * Otherwise declare the iterator on the stack and pass its address to <code>rox_*_iter_init()</code>.
+ */
 ROX_INTERNAL RoxMapIter *rox_map_iter_create();
 
 ROX_INTERNAL void rox_map_iter_free(RoxMapIter *iter);
@@ -62,6 +84,33 @@ ROX_INTERNAL bool rox_map_contains_key(RoxMap *map, void *key);
 
 ROX_INTERNAL bool rox_map_get(RoxMap *map, void *key, void **out);
 
+/**
+ * @param key Not <code>NULL</code>.
+ * @return Hash of the key, as used by <code>RoxMap</code> and <code>RoxSet</code>. Never 0.
+ */
+ROX_INTERNAL size_t rox_map_hash_key(const char *key);
+
+/**
+ * Same as <code>rox_map_get()</code>, for a key which hash was computed upfront.
+ *
+ * @param hash Result of <code>rox_map_hash_key(key)</code>.
+ */
+ROX_INTERNAL bool rox_map_get_hashed(RoxMap *map, const char *key, size_t hash, void **out);
+
+/**
+ * Grows the map so that it holds <code>size</code> entries without growing again.
+ *
+ * @param map Not <code>NULL</code>.
+ */
+ROX_INTERNAL void rox_map_reserve(RoxMap *map, size_t size);
+
+/**
+ * Removes all the entries, keeping the allocated capacity. The keys and values aren't freed.
+ *
+ * @param map Not <code>NULL</code>.
+ */
+ROX_INTERNAL void rox_map_clear(RoxMap *map);
+
 ROX_INTERNAL bool rox_list_add(RoxList *list, void *element);
 
 ROX_INTERNAL bool rox_set_add(RoxSet *set, void *element);
@@ -126,39 +175,28 @@ ROX_INTERNAL char *mem_str_join(const char *separator, RoxList *strings);
 
 #define ROX_SET_FOREACH(val, set, body)                                \
     {                                                                  \
-        RoxSetIter* set_iter_53d46d2a04458e7b = rox_set_iter_create(); \
-        rox_set_iter_init(set_iter_53d46d2a04458e7b, set);             \
+        RoxSetIter set_iter_53d46d2a04458e7b;                          \
+        rox_set_iter_init(&set_iter_53d46d2a04458e7b, set);            \
         void *val;                                                     \
-        while (rox_set_iter_next(set_iter_53d46d2a04458e7b, &val))     \
+        while (rox_set_iter_next(&set_iter_53d46d2a04458e7b, &val))    \
             body                                                       \
-        rox_set_iter_free(set_iter_53d46d2a04458e7b);                  \
     }
 
 #define ROX_MAP_FOREACH(key, value, map, body)                         \
     {                                                                  \
-        RoxMapIter* map_iter_53d46d2a04458e7b = rox_map_iter_create(); \
-        rox_map_iter_init(map_iter_53d46d2a04458e7b, map);             \
+        RoxMapIter map_iter_53d46d2a04458e7b;                          \
+        rox_map_iter_init(&map_iter_53d46d2a04458e7b, map);            \
         void *key;                                                     \
         void *value;                                                   \
-        while (rox_map_iter_next(map_iter_53d46d2a04458e7b, &key, &value))  \
+        while (rox_map_iter_next(&map_iter_53d46d2a04458e7b, &key, &value)) \
             body                                                       \
-        rox_map_iter_free(map_iter_53d46d2a04458e7b);                  \
     }
 
 #define ROX_LIST_FOREACH(val, list, body)                               \
     {                                                                   \
-        RoxListIter* list_iter_53d46d2a04458e7b = rox_list_iter_create(); \
-        rox_list_iter_init(list_iter_53d46d2a04458e7b, list);           \
+        RoxListIter list_iter_53d46d2a04458e7b;                         \
+        rox_list_iter_init(&list_iter_53d46d2a04458e7b, list);          \
         void *val;                                                      \
-        while (rox_list_iter_next(list_iter_53d46d2a04458e7b, &val))    \
+        while (rox_list_iter_next(&list_iter_53d46d2a04458e7b, &val))   \
             body                                                        \
-        rox_list_iter_free(list_iter_53d46d2a04458e7b);                 \
     }
-
-#define ROX_LIST_FOREACH_RETURN_VALUE(val) \
-    rox_list_iter_free(list_iter_53d46d2a04458e7b);                 \
-    return val
-
-#define ROX_LIST_FOREACH_RETURN \
-    rox_list_iter_free(list_iter_53d46d2a04458e7b);                 \
-    return
\ No newline at end of file
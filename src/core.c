@@ -2,9 +2,11 @@
 #include <pthread.h>
 #include <pcre2.h>
 #include <errno.h>
+#include <string.h>
 #include <xpack/network.h>
 #include "core.h"
 #include "core/consts.h"
+#include "core/epoch.h"
 #include "core/logging.h"
 #include "eval/extensions.h"
 #include "xpack/reporting.h"
@@ -85,6 +87,7 @@ struct RoxCore {
     bool initialized;
     FlagRepository *flag_repository;
     CustomPropertyRepository *custom_property_repository;
+    ConfigurationRepository *configuration_repository;
     ExperimentRepository *experiment_repository;
     TargetGroupRepository *target_group_repository;
     FlagSetter *flag_setter;
@@ -111,9 +114,20 @@ struct RoxCore {
     Request *report_request;
     BUID *buid;
     double last_fetch_time;
-    ConfigurationFetchResult *last_configuration;
+    // digest of the last fetched configuration, so that the previous data doesn't have to be kept for comparison
+    bool has_last_digest;
+    unsigned char last_digest[ROX_CONFIGURATION_DIGEST_SIZE];
+    // signature date of the last applied configuration, reported again when it's not modified
+    char *last_signature_date;
     pthread_mutex_t fetch_lock;
     bool stopped;
+    // the initial fetch, performed in background when the setup is asynchronous
+    pthread_t setup_thread;
+    bool setup_thread_started;
+    // set once the initial fetch is done, whatever its outcome
+    bool ready;
+    pthread_mutex_t ready_lock;
+    pthread_cond_t ready_cond;
     RoxContext *global_context;
 };
 
@@ -129,13 +143,17 @@ static void core_repository_callback(void *target, RoxStringBase *variant) {
 ROX_INTERNAL RoxCore *rox_core_create(RequestConfig *request_config) {
 
     RoxCore *core = calloc(1, sizeof(RoxCore));
+    core->ready_lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+    core->ready_cond = (pthread_cond_t) PTHREAD_COND_INITIALIZER;
 
     core->flag_repository = flag_repository_create();
     flag_repository_add_flag_added_callback(core->flag_repository, core, core_repository_callback);
 
     core->custom_property_repository = custom_property_repository_create();
-    core->experiment_repository = experiment_repository_create();
-    core->target_group_repository = target_group_repository_create();
+    core->configuration_repository = configuration_repository_create();
+    core->experiment_repository = experiment_repository_create_with_configuration(core->configuration_repository);
+    core->target_group_repository = target_group_repository_create_with_configuration(
+            core->configuration_repository);
     core->parser = parser_create();
     core->impression_invoker = impression_invoker_create();
     core->configuration_fetched_invoker = configuration_fetched_invoker_create();
@@ -202,27 +220,60 @@ ROX_INTERNAL void rox_core_fetch(RoxCore *core, bool is_source_pushing) {
         return;
     }
 
-    bool has_changes = true;
-    if (core->last_configuration) {
-        has_changes = !cJSON_Compare(result->parsed_data, core->last_configuration->parsed_data, true);
-        configuration_fetch_result_free(core->last_configuration);
+    if (result->not_modified) {
+        // nothing to parse, verify or apply
+        if (core->last_signature_date) {
+            configuration_fetched_invoker_invoke(
+                    core->configuration_fetched_invoker,
+                    AppliedFromNetwork,
+                    core->last_signature_date,
+                    false);
+        }
+        configuration_fetch_result_free(result);
+        ROX_DEBUG("No changes in configuration (not modified)");
+        pthread_mutex_unlock(&core->fetch_lock);
+        return;
     }
-    core->last_configuration = result;
+
+    bool has_changes = !core->has_last_digest || !result->has_digest ||
+                       memcmp(core->last_digest, result->digest, ROX_CONFIGURATION_DIGEST_SIZE) != 0;
 
     Configuration *configuration = configuration_parser_parse(core->configuration_parser, result);
     if (configuration) {
 
-        experiment_repository_set_experiments(
-                core->experiment_repository,
-                mem_deep_copy_list(configuration->experiments,
-                                   (void *(*)(void *)) &experiment_model_copy));
-
-        target_group_repository_set_target_groups(
-                core->target_group_repository,
-                mem_deep_copy_list(configuration->target_groups,
-                                   (void *(*)(void *)) &target_group_model_copy));
-
-        flag_setter_set_experiments(core->flag_setter);
+        // compile the new conditions before the configuration is published,
+        // so that the evaluations never wait for them
+        RoxList *conditions = rox_list_create();
+        ROX_LIST_FOREACH(item, configuration->experiments, {
+            rox_list_add(conditions, ((ExperimentModel *) item)->condition);
+        })
+        ROX_LIST_FOREACH(item, configuration->target_groups, {
+            rox_list_add(conditions, ((TargetGroupModel *) item)->condition);
+        })
+        parser_set_compiled_expressions(core->parser, conditions);
+        rox_list_free(conditions);
+
+        // the replaced snapshot stays readable until the end of the section, so that only the flags
+        // whose experiments changed are set again
+        int epoch_token = epoch_read_begin();
+        ConfigurationSnapshot *previous = configuration_repository_get_snapshot(core->configuration_repository);
+
+        // experiments and target groups are swapped together, an evaluation sees either the old or the new ones;
+        // the parsed models are handed over to the repository rather than copied
+        configuration_repository_set_configuration(
+                core->configuration_repository,
+                configuration->experiments,
+                configuration->target_groups);
+        configuration->experiments = rox_list_create();
+        configuration->target_groups = rox_list_create();
+
+        flag_setter_set_changed_experiments(core->flag_setter, previous);
+        epoch_read_end(epoch_token);
+
+        // only the digest of an applied payload, so that a payload failing to parse or verify
+        // is reported as changed once it's applied
+        core->has_last_digest = result->has_digest;
+        memcpy(core->last_digest, result->digest, ROX_CONFIGURATION_DIGEST_SIZE);
 
         configuration_fetched_invoker_invoke(
                 core->configuration_fetched_invoker,
@@ -232,15 +283,40 @@ ROX_INTERNAL void rox_core_fetch(RoxCore *core, bool is_source_pushing) {
                 configuration->signature_date,
                 has_changes);
 
+        if (core->last_signature_date) {
+            free(core->last_signature_date);
+        }
+        core->last_signature_date = mem_copy_str(configuration->signature_date);
+
         configuration_free(configuration);
         ROX_DEBUG(has_changes
                   ? "Configuration updated"
                   : "No changes in configuration");
+    } else {
+        // not applied, so it must be downloaded again rather than reported as not modified
+        configuration_fetcher_reset_validators(core->configuration_fetcher);
     }
 
+    configuration_fetch_result_free(result);
+
     pthread_mutex_unlock(&core->fetch_lock);
 }
 
+static void core_set_ready(RoxCore *core) {
+    assert(core);
+    pthread_mutex_lock(&core->ready_lock);
+    core->ready = true;
+    pthread_cond_broadcast(&core->ready_cond);
+    pthread_mutex_unlock(&core->ready_lock);
+}
+
+static void *core_setup_thread_func(void *ptr) {
+    RoxCore *core = (RoxCore *) ptr;
+    rox_core_fetch(core, false);
+    core_set_ready(core);
+    return NULL;
+}
+
 static void core_x_configuration_fetch_func(void *target) {
     assert(target);
     RoxCore *core = (RoxCore *) target;
@@ -276,11 +352,13 @@ ROX_INTERNAL RoxStateCode rox_core_setup(
             char *api_key = sdk_settings_get_api_key(sdk_settings);
             char *mongoIdPattern = "^[a-f\\d]{24}$";
             char *uuidIdPattern = "^[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$";
-            bool platformMatch = str_matches(api_key, uuidIdPattern, PCRE2_CASELESS);
             if (!api_key || !api_key[0]) {
                 ROX_ERROR("Invalid rollout apikey - must be specified");
                 return RoxErrorEmptyApiKey;
-            } else if (!str_matches(api_key, mongoIdPattern, PCRE2_CASELESS) && !platformMatch) {
+            }
+            // the patterns are compiled once and shared with the evaluator through the str_matches() cache
+            bool platformMatch = str_matches(api_key, uuidIdPattern, PCRE2_CASELESS);
+            if (!str_matches(api_key, mongoIdPattern, PCRE2_CASELESS) && !platformMatch) {
                 ROX_ERROR("Illegal rollout apikey");
                 return RoxErrorInvalidApiKey;
             }
@@ -382,7 +460,11 @@ ROX_INTERNAL RoxStateCode rox_core_setup(
             core->configuration_fetched_invoker,
             disableSignature);
 
-    rox_core_fetch(core, false);
+    bool async_setup = rox_options && rox_options_is_async_setup(rox_options);
+    if (!async_setup) {
+        rox_core_fetch(core, false);
+        core_set_ready(core);
+    }
 
     if (rox_options) {
 
@@ -411,11 +493,38 @@ ROX_INTERNAL RoxStateCode rox_core_setup(
         state_sender_send_debounce(core->state_sender);
     }
 
+    if (async_setup) {
+        // started last, so that the setup doesn't race with the fetch
+        core->setup_thread_started = (pthread_create(
+                &core->setup_thread, NULL, core_setup_thread_func, (void *) core) == 0);
+        if (!core->setup_thread_started) {
+            ROX_WARN("Failed to start the initial fetch in background, fetching now");
+            rox_core_fetch(core, false);
+            core_set_ready(core);
+        }
+    }
+
     return RoxInitialized;
 }
 
+ROX_INTERNAL bool rox_core_wait_until_ready(RoxCore *core, int timeout_ms) {
+    assert(core);
+    struct timespec deadline = get_future_timespec(timeout_ms > 0 ? timeout_ms : 0);
+    pthread_mutex_lock(&core->ready_lock);
+    int result = 0;
+    while (!core->ready && result != ETIMEDOUT) {
+        result = pthread_cond_timedwait(&core->ready_cond, &core->ready_lock, &deadline);
+    }
+    bool ready = core->ready;
+    pthread_mutex_unlock(&core->ready_lock);
+    return ready;
+}
+
 ROX_INTERNAL void rox_core_set_context(RoxCore *core, RoxContext *context) {
     assert(core);
+    if (context) {
+        rox_context_flatten(context);
+    }
     core->global_context = context;
     RoxMap *flags = flag_repository_get_all_flags(core->flag_repository);
     ROX_MAP_FOREACH(key, value, flags, {
@@ -457,6 +566,14 @@ ROX_INTERNAL void rox_core_free(RoxCore *core) {
     assert(core);
 
     core->stopped = true;
+    request_stop(core->configuration_fetcher_request);
+    request_stop(core->state_sender_request);
+    request_stop(core->report_request);
+
+    if (core->setup_thread_started) {
+        // waits for the initial fetch, if still running, since it uses everything below
+        pthread_join(core->setup_thread, NULL);
+    }
 
     if (core->x_configuration_fetched_invoker) {
         x_configuration_fetched_invoker_free(core->x_configuration_fetched_invoker);
@@ -468,6 +585,7 @@ ROX_INTERNAL void rox_core_free(RoxCore *core) {
     parser_free(core->parser);
     target_group_repository_free(core->target_group_repository);
     experiment_repository_free(core->experiment_repository);
+    configuration_repository_free(core->configuration_repository);
     custom_property_repository_free(core->custom_property_repository);
     impression_invoker_free(core->impression_invoker);
     dynamic_properties_free(core->dynamic_properties);
@@ -523,14 +641,20 @@ ROX_INTERNAL void rox_core_free(RoxCore *core) {
         periodic_task_free(core->periodic_task);
     }
 
-    if (core->last_configuration) {
-        configuration_fetch_result_free(core->last_configuration);
+    if (core->last_signature_date) {
+        free(core->last_signature_date);
     }
 
     if (core->initialized) {
         pthread_mutex_destroy(&core->fetch_lock);
     }
 
+    pthread_mutex_destroy(&core->ready_lock);
+    pthread_cond_destroy(&core->ready_cond);
+
+    // frees whatever the evaluations running during the last update were holding back
+    epoch_synchronize();
+
     free(core);
 }
 
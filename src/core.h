@@ -30,6 +30,15 @@ ROX_INTERNAL RoxStateCode rox_core_setup(
  */
 ROX_INTERNAL void rox_core_fetch(RoxCore *core, bool is_source_pushing);
 
+/**
+ * Waits for the initial fetch to be done, see <code>rox_options_set_async_setup()</code>.
+ *
+ * @param core Not <code>NULL</code>.
+ * @param timeout_ms Maximum time to wait, in milliseconds. <code>0</code> just checks.
+ * @return Whether the initial fetch is done.
+ */
+ROX_INTERNAL bool rox_core_wait_until_ready(RoxCore *core, int timeout_ms);
+
 /**
  * @param core Not <code>NULL</code>.
  * @param context May be <code>NULL</code>.
@@ -6,6 +6,7 @@
 #include "device.h"
 #include "options.h"
 #include "collections.h"
+#include "epoch.h"
 
 //
 // SdkSettings
@@ -102,6 +103,7 @@ struct RoxOptions {
     rox_dynamic_properties_rule dynamic_properties_rule;
     bool cxx;
     bool disable_signature_verification;
+    bool async_setup;
     RoxMap *extra;
 };
 
@@ -206,6 +208,11 @@ ROX_API void rox_options_set_disable_signature_verification(RoxOptions *options,
     options->disable_signature_verification = verification_disabled;
 }
 
+ROX_API void rox_options_set_async_setup(RoxOptions *options, bool async_setup) {
+    assert(options);
+    options->async_setup = async_setup;
+}
+
 ROX_INTERNAL void rox_options_set_cxx(RoxOptions *options) {
     assert(options);
     options->cxx = true;
@@ -266,6 +273,11 @@ ROX_INTERNAL void *rox_options_get_dynamic_properties_rule_target(RoxOptions *op
     return options->dynamic_properties_rule_target;
 }
 
+ROX_INTERNAL bool rox_options_is_async_setup(RoxOptions *options) {
+    assert(options);
+    return options->async_setup;
+}
+
 ROX_INTERNAL bool rox_options_is_disable_signature_verification(RoxOptions *options) {
     assert(options);
     return options->disable_signature_verification;
@@ -552,14 +564,17 @@ ROX_INTERNAL InternalFlags *internal_flags_create(
 ROX_INTERNAL bool internal_flags_is_enabled(InternalFlags *flags, const char *flag_name) {
     assert(flags);
     assert(flag_name);
+    int epoch_token = epoch_read_begin();
     ExperimentModel *internal_experiment = experiment_repository_get_experiment_by_flag(
             flags->experiment_repository, flag_name);
     if (!internal_experiment) {
+        epoch_read_end(epoch_token);
         return false;
     }
     EvaluationContext *eval_context = eval_context_create(NULL, NULL);
     EvaluationResult *value = parser_evaluate_expression(flags->parser, internal_experiment->condition, eval_context);
     eval_context_free(eval_context);
+    epoch_read_end(epoch_token);
     char *str_result = result_get_string(value);
     bool enabled = str_result && str_equals(FLAG_TRUE_VALUE, str_result);
     result_free(value);
@@ -569,14 +584,17 @@ ROX_INTERNAL bool internal_flags_is_enabled(InternalFlags *flags, const char *fl
 ROX_INTERNAL int *internal_flags_get_int_value(InternalFlags *flags, const char *flag_name) {
     assert(flags);
     assert(flag_name);
+    int epoch_token = epoch_read_begin();
     ExperimentModel *internal_experiment = experiment_repository_get_experiment_by_flag(
             flags->experiment_repository, flag_name);
     if (!internal_experiment) {
+        epoch_read_end(epoch_token);
         return NULL;
     }
     EvaluationContext *eval_context = eval_context_create(NULL, NULL);
     EvaluationResult *value = parser_evaluate_expression(flags->parser, internal_experiment->condition, eval_context);
     eval_context_free(eval_context);
+    epoch_read_end(epoch_token);
     int *result = result_get_int(value);
     if (!result) {
         result_free(value);
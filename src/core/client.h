@@ -140,6 +140,12 @@ ROX_INTERNAL void *rox_options_get_dynamic_properties_rule_target(RoxOptions *op
  */
 ROX_INTERNAL bool rox_options_is_disable_signature_verification(RoxOptions *options);
 
+/**
+ * @param options Not <code>NULL</code>.
+ * @return Whether the initial fetch is performed in background.
+ */
+ROX_INTERNAL bool rox_options_is_async_setup(RoxOptions *options);
+
 /**
  * @param options Not <code>NULL</code>.
  */
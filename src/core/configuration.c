@@ -71,6 +71,21 @@ ROX_INTERNAL ConfigurationFetchResult *configuration_fetch_result_create(cJSON *
     return result;
 }
 
+ROX_INTERNAL ConfigurationFetchResult *configuration_fetch_result_create_not_modified(ConfigurationSource source) {
+    assert(source);
+    ConfigurationFetchResult *result = calloc(1, sizeof(ConfigurationFetchResult));
+    result->source = source;
+    result->not_modified = true;
+    return result;
+}
+
+ROX_INTERNAL void configuration_fetch_result_set_digest(ConfigurationFetchResult *result, const char *payload) {
+    assert(result);
+    assert(payload);
+    md5_str_b(payload, result->digest);
+    result->has_digest = true;
+}
+
 ROX_INTERNAL void configuration_fetch_result_free(ConfigurationFetchResult *result) {
     assert(result);
     if (result->parsed_data) {
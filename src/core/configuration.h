@@ -55,9 +55,16 @@ typedef enum ConfigurationSource {
 
 ROX_INTERNAL const char *configuration_source_to_str(ConfigurationSource source);
 
+#define ROX_CONFIGURATION_DIGEST_SIZE 16
+
 typedef struct ConfigurationFetchResult {
     ConfigurationSource source;
     cJSON *parsed_data;
+    // the configuration didn't change since the previous fetch, parsed_data is NULL
+    bool not_modified;
+    // md5 of the payload the data was parsed from, to detect changes without keeping the previous data
+    bool has_digest;
+    unsigned char digest[ROX_CONFIGURATION_DIGEST_SIZE];
 } ConfigurationFetchResult;
 
 /**
@@ -66,6 +73,17 @@ typedef struct ConfigurationFetchResult {
  */
 ROX_INTERNAL ConfigurationFetchResult *configuration_fetch_result_create(cJSON *data, ConfigurationSource source);
 
+/**
+ * @return Not <code>NULL</code>. Result without data, telling the configuration didn't change.
+ */
+ROX_INTERNAL ConfigurationFetchResult *configuration_fetch_result_create_not_modified(ConfigurationSource source);
+
+/**
+ * @param result Not <code>NULL</code>.
+ * @param payload Not <code>NULL</code>. Raw JSON the result's data was parsed from.
+ */
+ROX_INTERNAL void configuration_fetch_result_set_digest(ConfigurationFetchResult *result, const char *payload);
+
 /**
  * @param result Not <code>NULL</code>.
  */
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "models.h"
 #include "collections.h"
+#include "util.h"
 
 //
 // ExperimentModel
@@ -44,6 +45,42 @@ ROX_INTERNAL ExperimentModel *experiment_model_copy(ExperimentModel *model) {
                                    model->stickiness_property);
 }
 
+static bool _experiment_model_nullable_str_equals(const char *str, const char *another) {
+    return str && another ? str_equals(str, another) : str == another;
+}
+
+ROX_INTERNAL bool experiment_model_equals(ExperimentModel *model, ExperimentModel *another) {
+    assert(model);
+    assert(another);
+    if (model == another) {
+        return true;
+    }
+    if (model->archived != another->archived ||
+        !str_equals(model->id, another->id) ||
+        !str_equals(model->condition, another->condition) ||
+        !str_equals(model->name, another->name) ||
+        !_experiment_model_nullable_str_equals(model->stickiness_property, another->stickiness_property)) {
+        return false;
+    }
+    if (model->flags && another->flags
+        ? !str_list_equals(model->flags, another->flags)
+        : model->flags != another->flags) {
+        return false;
+    }
+    if (!model->labels || !another->labels) {
+        return model->labels == another->labels;
+    }
+    if (rox_set_size(model->labels) != rox_set_size(another->labels)) {
+        return false;
+    }
+    ROX_SET_FOREACH(label, model->labels, {
+        if (!rox_set_contains(another->labels, label)) {
+            return false;
+        }
+    })
+    return true;
+}
+
 ROX_INTERNAL void experiment_model_free(ExperimentModel *model) {
     assert(model);
     free(model->id);
@@ -56,13 +93,12 @@ ROX_INTERNAL void experiment_model_free(ExperimentModel *model) {
         rox_list_free_cb(model->flags, &free);
     }
     if (model->labels) {
-        RoxSetIter *iter = rox_set_iter_create();
-        rox_set_iter_init(iter, model->labels);
+        RoxSetIter iter;
+        rox_set_iter_init(&iter, model->labels);
         void *val;
-        while (rox_set_iter_next(iter, &val)) {
+        while (rox_set_iter_next(&iter, &val)) {
             free(val);
         }
-        rox_set_iter_free(iter);
         rox_set_free(model->labels);
     }
     free(model);
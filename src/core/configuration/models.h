@@ -45,6 +45,13 @@ ROX_INTERNAL ExperimentModel *experiment_model_create(
  */
 ROX_INTERNAL ExperimentModel *experiment_model_copy(ExperimentModel *model);
 
+/**
+ * @param model Not <code>NULL</code>.
+ * @param another Not <code>NULL</code>.
+ * @return Whether both models have the same id, condition and all the other fields.
+ */
+ROX_INTERNAL bool experiment_model_equals(ExperimentModel *model, ExperimentModel *another);
+
 /**
  * @param model Not <code>NULL</code>.
  */
@@ -1,14 +1,8 @@
 #include <assert.h>
 #include <stdlib.h>
-#include "rox/context.h"
-#include "collections.h"
-
-struct RoxContext {
-    RoxMap *map;
-    void *target;
-    rox_context_get_value_func get_value;
-    rox_context_free_target_func free_target;
-};
+#include <string.h>
+#include "context.h"
+#include "values.h"
 
 ROX_API RoxDynamicValue *rox_context_get(RoxContext *context, const char *key) {
     assert(context);
@@ -18,7 +12,8 @@ ROX_API RoxDynamicValue *rox_context_get(RoxContext *context, const char *key) {
     }
     void *ptr;
     if (rox_map_get(context->map, (void *) key, &ptr) && ptr) {
-        return rox_dynamic_value_create_copy(ptr);
+        // the values in an arena don't outlive a reset, while the callers own the value they get
+        return context->arena ? rox_dynamic_value_create_copy(ptr) : dynamic_value_retain(ptr);
     }
     return NULL;
 }
@@ -36,11 +31,6 @@ ROX_API RoxContext *rox_context_create_from_map(RoxMap *map) {
     return context;
 }
 
-typedef struct MergedContext {
-    RoxContext *global_context;
-    RoxContext *local_context;
-} MergedContext;
-
 static RoxDynamicValue *_merged_context_get_value(void *target, const char *key) {
     assert(target);
     assert(key);
@@ -60,6 +50,174 @@ static RoxDynamicValue *_merged_context_get_value(void *target, const char *key)
     return NULL;
 }
 
+ROX_INTERNAL RoxDynamicValue *rox_context_get_symbol(RoxContext *context, const RoxSymbol *symbol) {
+    assert(context);
+    assert(symbol);
+    if (context->get_value == &_merged_context_get_value) {
+        MergedContext *merged = (MergedContext *) context->target;
+        RoxDynamicValue *value = merged->local_context
+                                 ? rox_context_get_symbol(merged->local_context, symbol)
+                                 : NULL;
+        if (!value && merged->global_context) {
+            value = rox_context_get_symbol(merged->global_context, symbol);
+        }
+        return value;
+    }
+    if (context->get_value) {
+        return context->get_value(context->target, symbol->name);
+    }
+    if (context->flattened) {
+        // all the keys were interned when flattening, so the symbols created later aren't among them
+        RoxDynamicValue *value = symbol->id < context->flat_size ? context->flat_values[symbol->id] : NULL;
+        return value ? dynamic_value_retain(value) : NULL;
+    }
+    void *ptr;
+    if (rox_map_get_hashed(context->map, symbol->name, symbol->hash, &ptr) && ptr) {
+        return dynamic_value_retain(ptr);
+    }
+    return NULL;
+}
+
+// keeps the values, and the datetimes in them, aligned
+#define ROX_CONTEXT_ARENA_ALIGNMENT sizeof(double)
+
+static size_t _context_arena_align(size_t bytes) {
+    return (bytes + ROX_CONTEXT_ARENA_ALIGNMENT - 1) / ROX_CONTEXT_ARENA_ALIGNMENT * ROX_CONTEXT_ARENA_ALIGNMENT;
+}
+
+static size_t _context_arena_bytes(size_t count, size_t bytes) {
+    return count * _context_arena_align(sizeof(RoxDynamicValue)) + bytes;
+}
+
+static void *_context_arena_alloc(ContextArena *arena, size_t bytes) {
+    assert(arena);
+    bytes = _context_arena_align(bytes);
+    if (arena->used + bytes <= arena->capacity) {
+        void *ptr = arena->block + arena->used;
+        arena->used += bytes;
+        return ptr;
+    }
+    void *ptr = malloc(bytes);
+    rox_list_add(arena->overflow, ptr);
+    arena->overflow_used += bytes;
+    return ptr;
+}
+
+static char *_context_arena_copy_str(ContextArena *arena, const char *str) {
+    size_t size = strlen(str) + 1;
+    char *copy = _context_arena_alloc(arena, size);
+    memcpy(copy, str, size);
+    return copy;
+}
+
+static void _context_flat_values_free(RoxContext *context) {
+    if (context->flat_values) {
+        free(context->flat_values);
+        context->flat_values = NULL;
+    }
+    context->flat_size = 0;
+    context->flattened = false;
+}
+
+ROX_INTERNAL RoxContext *rox_context_create_arena(size_t count, size_t bytes) {
+    RoxContext *context = calloc(1, sizeof(RoxContext));
+    context->map = rox_map_create();
+    context->arena = calloc(1, sizeof(ContextArena));
+    context->arena->overflow = rox_list_create();
+    rox_context_arena_reserve(context, count, bytes);
+    return context;
+}
+
+ROX_INTERNAL void rox_context_arena_reserve(RoxContext *context, size_t count, size_t bytes) {
+    assert(context);
+    assert(context->arena);
+    ContextArena *arena = context->arena;
+    rox_map_reserve(context->map, rox_map_size(context->map) + count);
+    size_t capacity = arena->used + arena->overflow_used + _context_arena_bytes(count, bytes);
+    if (capacity <= arena->capacity) {
+        return;
+    }
+    if (arena->used > 0) {
+        // the entries point into the block, so it can't move until the reset
+        if (capacity > arena->reserved) {
+            arena->reserved = capacity;
+        }
+        return;
+    }
+    free(arena->block);
+    arena->block = malloc(capacity);
+    arena->capacity = capacity;
+}
+
+ROX_INTERNAL void rox_context_arena_add(RoxContext *context, const char *key, const RoxDynamicValue *value) {
+    assert(context);
+    assert(context->arena);
+    assert(key);
+    assert(value);
+    assert(value->type != RoxDynamicValueTypeList && value->type != RoxDynamicValueTypeMap);
+    ContextArena *arena = context->arena;
+    RoxDynamicValue *copy = _context_arena_alloc(arena, sizeof(RoxDynamicValue));
+    *copy = *value;
+    copy->owned = false;
+    copy->is_static = true;
+    copy->ref_count = 0;
+    if (value->type == RoxDynamicValueTypeString) {
+        copy->data.str_value = _context_arena_copy_str(arena, value->data.str_value);
+    } else if (value->type == RoxDynamicValueTypeDateTime) {
+        copy->data.datetime_value = _context_arena_alloc(arena, sizeof(struct tm));
+        memcpy(copy->data.datetime_value, value->data.datetime_value, sizeof(struct tm));
+    }
+    void *existing;
+    rox_map_add(context->map, rox_map_get(context->map, (void *) key, &existing)
+                              ? (void *) key // the map keeps the existing key
+                              : _context_arena_copy_str(arena, key), copy);
+}
+
+ROX_INTERNAL void rox_context_arena_reset(RoxContext *context) {
+    assert(context);
+    assert(context->arena);
+    ContextArena *arena = context->arena;
+    rox_map_clear(context->map);
+    _context_flat_values_free(context);
+    size_t capacity = arena->used + arena->overflow_used;
+    if (capacity < arena->reserved) {
+        capacity = arena->reserved;
+    }
+    if (capacity > arena->capacity) {
+        free(arena->block);
+        arena->block = malloc(capacity);
+        arena->capacity = capacity;
+    }
+    ROX_LIST_FOREACH(ptr, arena->overflow, {
+        free(ptr);
+    })
+    rox_list_remove_all(arena->overflow);
+    arena->used = 0;
+    arena->overflow_used = 0;
+    arena->reserved = 0;
+}
+
+#undef ROX_CONTEXT_ARENA_ALIGNMENT
+
+ROX_INTERNAL void rox_context_flatten(RoxContext *context) {
+    assert(context);
+    if (!context->map || context->flattened) {
+        return;
+    }
+    ROX_MAP_FOREACH(key, value, context->map, {
+        symbol_intern(key);
+    })
+    // every key has an id below the current count now
+    int size = symbol_count();
+    RoxDynamicValue **values = size > 0 ? calloc(size, sizeof(RoxDynamicValue *)) : NULL;
+    ROX_MAP_FOREACH(key, value, context->map, {
+        values[symbol_intern(key)->id] = value;
+    })
+    context->flat_values = values;
+    context->flat_size = size;
+    context->flattened = true;
+}
+
 ROX_API RoxContext *rox_context_create_merged(RoxContext *global_context, RoxContext *local_context) {
     MergedContext *merged = calloc(1, sizeof(MergedContext));
     merged->global_context = global_context;
@@ -68,6 +226,24 @@ ROX_API RoxContext *rox_context_create_merged(RoxContext *global_context, RoxCon
     return rox_context_create_custom(&config);
 }
 
+ROX_INTERNAL RoxContext *rox_context_init_merged(
+        InlineMergedContext *inline_context,
+        RoxContext *global_context,
+        RoxContext *local_context) {
+    assert(inline_context);
+    inline_context->merged.global_context = global_context;
+    inline_context->merged.local_context = local_context;
+    inline_context->context.map = NULL;
+    inline_context->context.arena = NULL;
+    inline_context->context.target = &inline_context->merged;
+    inline_context->context.get_value = &_merged_context_get_value;
+    inline_context->context.free_target = NULL;
+    inline_context->context.flattened = false;
+    inline_context->context.flat_values = NULL;
+    inline_context->context.flat_size = 0;
+    return &inline_context->context;
+}
+
 ROX_API RoxContext *rox_context_create_custom(RoxContextConfig *config) {
     assert(config);
     RoxContext *context = calloc(1, sizeof(RoxContext));
@@ -79,7 +255,12 @@ ROX_API RoxContext *rox_context_create_custom(RoxContextConfig *config) {
 
 ROX_API void rox_context_free(RoxContext *context) {
     assert(context);
-    if (context->map) {
+    if (context->arena) {
+        rox_list_free_cb(context->arena->overflow, &free);
+        free(context->arena->block);
+        free(context->arena);
+        rox_map_free(context->map);
+    } else if (context->map) {
         rox_map_free_with_keys_and_values_cb(
                 context->map,
                 &free,
@@ -88,5 +269,6 @@ ROX_API void rox_context_free(RoxContext *context) {
     if (context->target && context->free_target) {
         context->free_target(context->target);
     }
+    _context_flat_values_free(context);
     free(context);
 }
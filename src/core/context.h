@@ -0,0 +1,116 @@
+#pragma once
+
+#include "rox/context.h"
+#include "collections.h"
+#include "symbols.h"
+
+/**
+ * Memory of a context built in place: the keys, values and their strings are bump allocated
+ * from a single block, and all of them are released at once.
+ */
+typedef struct ContextArena {
+    char *block;
+    size_t capacity;
+    size_t used;
+    // allocations that didn't fit in the block, folded into it on the next reset
+    RoxList *overflow;
+    size_t overflow_used;
+    // capacity requested for the block while it was in use
+    size_t reserved;
+} ContextArena;
+
+struct RoxContext {
+    RoxMap *map;
+    // when set, the keys and values of the map live in the arena
+    ContextArena *arena;
+    void *target;
+    rox_context_get_value_func get_value;
+    rox_context_free_target_func free_target;
+    // values of the map indexed by the symbol ids of their keys, set by rox_context_flatten()
+    bool flattened;
+    RoxDynamicValue **flat_values;
+    int flat_size;
+};
+
+typedef struct MergedContext {
+    RoxContext *global_context;
+    RoxContext *local_context;
+} MergedContext;
+
+/**
+ * Storage for a merged context that lives on the stack, or inside another structure.
+ */
+typedef struct InlineMergedContext {
+    RoxContext context;
+    MergedContext merged;
+} InlineMergedContext;
+
+/**
+ * Same as <code>rox_context_get()</code>, but the map lookups use the hash of the symbol.
+ *
+ * @param context Not <code>NULL</code>.
+ * @param symbol Not <code>NULL</code>.
+ */
+ROX_INTERNAL RoxDynamicValue *rox_context_get_symbol(RoxContext *context, const RoxSymbol *symbol);
+
+/**
+ * Creates an empty context which entries are stored in an arena, see <code>rox_context_arena_add()</code>.
+ * It's freed with <code>rox_context_free()</code>, like any other context.
+ *
+ * @param count Number of entries to reserve the room for.
+ * @param bytes Number of bytes to reserve for the keys and the string values.
+ * @return Not <code>NULL</code>.
+ */
+ROX_INTERNAL RoxContext *rox_context_create_arena(size_t count, size_t bytes);
+
+/**
+ * Makes room for more entries. If the arena is in use, its block grows on the next reset.
+ *
+ * @param context Not <code>NULL</code>. Created by <code>rox_context_create_arena()</code>.
+ * @param count Number of entries to reserve the room for.
+ * @param bytes Number of bytes to reserve for the keys and the string values.
+ */
+ROX_INTERNAL void rox_context_arena_reserve(RoxContext *context, size_t count, size_t bytes);
+
+/**
+ * Copies the key and the value, including its string or datetime, into the arena of the context.
+ * An existing value of the same key is replaced. The values stored in the arena are never freed
+ * individually, so the ones returned by the lookups are valid until the context is reset or freed.
+ *
+ * @param context Not <code>NULL</code>. Created by <code>rox_context_create_arena()</code>.
+ * @param key Not <code>NULL</code>.
+ * @param value Not <code>NULL</code>. A scalar, a string or a datetime.
+ */
+ROX_INTERNAL void rox_context_arena_add(RoxContext *context, const char *key, const RoxDynamicValue *value);
+
+/**
+ * Removes all the entries, keeping the memory of the arena for the next ones. Any allocation that
+ * overflowed the arena block makes it grow, so that the same entries fit in it next time.
+ *
+ * @param context Not <code>NULL</code>. Created by <code>rox_context_create_arena()</code>.
+ */
+ROX_INTERNAL void rox_context_arena_reset(RoxContext *context);
+
+/**
+ * Interns all the keys of a context created from a map and indexes its values by their symbol ids,
+ * so that <code>rox_context_get_symbol()</code> on it is a single array access. Custom and merged
+ * contexts are left as is. Since the contexts are never modified after they're created, it's done
+ * once, when the context is set as the global one.
+ *
+ * @param context Not <code>NULL</code>.
+ */
+ROX_INTERNAL void rox_context_flatten(RoxContext *context);
+
+/**
+ * Same as <code>rox_context_create_merged()</code>, but nothing is allocated. The returned context
+ * points into <code>inline_context</code> and must <em>NOT</em> be passed to <code>rox_context_free()</code>.
+ *
+ * @param inline_context Not <code>NULL</code>. Must outlive the returned context.
+ * @param global_context May be <code>NULL</code>.
+ * @param local_context May be <code>NULL</code>.
+ * @return Not <code>NULL</code>.
+ */
+ROX_INTERNAL RoxContext *rox_context_init_merged(
+        InlineMergedContext *inline_context,
+        RoxContext *global_context,
+        RoxContext *local_context);
@@ -1,11 +1,13 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "core/configuration/models.h"
+#include "core/epoch.h"
 #include "eval/parser.h"
 #include "entities.h"
 #include "repositories.h"
 #include "util.h"
 #include "collections.h"
+#include "values.h"
 
 //
 // RoxStringBase
@@ -19,14 +21,19 @@ typedef struct FlagExtraData {
     variant_free_data_func free_data_func;
 } FlagExtraData;
 
-struct RoxStringBase {
-    char *default_value;
-    RoxList *options;
+// never modified after being published, so that the flag can be evaluated while being updated
+typedef struct VariantState {
     char *condition;
     Parser *parser;
-    RoxContext *global_context;
     ImpressionInvoker *impression_invoker;
     ExperimentModel *experiment;
+} VariantState;
+
+struct RoxStringBase {
+    char *default_value;
+    RoxList *options;
+    VariantState *state;
+    RoxContext *global_context;
     char *name;
     bool is_flag;
     bool is_string;
@@ -112,24 +119,32 @@ ROX_INTERNAL const char *variant_get_default_value(RoxStringBase *variant) {
     return variant->default_value;
 }
 
+static VariantState *variant_get_state(RoxStringBase *variant) {
+    return epoch_load((void **) &variant->state);
+}
+
 ROX_INTERNAL const char *variant_get_condition(RoxStringBase *variant) {
     assert(variant);
-    return variant->condition;
+    VariantState *state = variant_get_state(variant);
+    return state ? state->condition : NULL;
 }
 
 ROX_INTERNAL ExperimentModel *variant_get_experiment(RoxStringBase *variant) {
     assert(variant);
-    return variant->experiment;
+    VariantState *state = variant_get_state(variant);
+    return state ? state->experiment : NULL;
 }
 
 ROX_INTERNAL Parser *variant_get_parser(RoxStringBase *variant) {
     assert(variant);
-    return variant->parser;
+    VariantState *state = variant_get_state(variant);
+    return state ? state->parser : NULL;
 }
 
 ROX_INTERNAL ImpressionInvoker *variant_get_impression_invoker(RoxStringBase *variant) {
     assert(variant);
-    return variant->impression_invoker;
+    VariantState *state = variant_get_state(variant);
+    return state ? state->impression_invoker : NULL;
 }
 
 ROX_INTERNAL RoxList *variant_get_options(RoxStringBase *variant) {
@@ -137,22 +152,22 @@ ROX_INTERNAL RoxList *variant_get_options(RoxStringBase *variant) {
     return variant->options;
 }
 
-static void variant_reset_evaluation_context(RoxStringBase *variant) {
-    assert(variant);
-    if (variant->condition) {
-        free(variant->condition);
-        variant->condition = NULL;
-    }
-    if (variant->parser) {
-        variant->parser = NULL;
-    }
-    if (variant->experiment) {
-        experiment_model_free(variant->experiment);
-        variant->experiment = NULL;
+static void variant_state_free(VariantState *state) {
+    assert(state);
+    if (state->condition) {
+        free(state->condition);
     }
-    if (variant->impression_invoker) {
-        variant->impression_invoker = NULL;
+    if (state->experiment) {
+        experiment_model_free(state->experiment);
     }
+    free(state);
+}
+
+static void variant_publish_state(RoxStringBase *variant, VariantState *state) {
+    assert(variant);
+    VariantState *previous = variant_get_state(variant);
+    epoch_publish((void **) &variant->state, state);
+    epoch_retire(previous, (epoch_free_func) &variant_state_free);
 }
 
 ROX_INTERNAL void variant_set_for_evaluation(
@@ -161,16 +176,16 @@ ROX_INTERNAL void variant_set_for_evaluation(
         ExperimentModel *experiment,
         ImpressionInvoker *impression_invoker) {
     assert(variant);
-    variant_reset_evaluation_context(variant);
+    VariantState *state = calloc(1, sizeof(VariantState));
     if (experiment) {
-        variant->experiment = experiment_model_copy(experiment);
-        variant->condition = mem_copy_str(experiment->condition);
+        state->experiment = experiment_model_copy(experiment);
+        state->condition = mem_copy_str(experiment->condition);
     } else {
-        variant->experiment = NULL;
-        variant->condition = mem_copy_str("");
+        state->condition = mem_copy_str("");
     }
-    variant->parser = parser;
-    variant->impression_invoker = impression_invoker;
+    state->parser = parser;
+    state->impression_invoker = impression_invoker;
+    variant_publish_state(variant, state);
 }
 
 ROX_INTERNAL void variant_set_context(RoxStringBase *variant, RoxContext *context) {
@@ -190,10 +205,17 @@ ROX_INTERNAL void variant_set_name(RoxStringBase *variant, const char *name) {
 ROX_INTERNAL void variant_set_condition(RoxStringBase *variant, const char *condition) {
     assert(variant);
     assert(condition);
-    if (variant->condition) {
-        free(variant->condition);
+    VariantState *previous = variant_get_state(variant);
+    VariantState *state = calloc(1, sizeof(VariantState));
+    if (previous) {
+        state->parser = previous->parser;
+        state->impression_invoker = previous->impression_invoker;
+        if (previous->experiment) {
+            state->experiment = experiment_model_copy(previous->experiment);
+        }
     }
-    variant->condition = mem_copy_str(condition);
+    state->condition = mem_copy_str(condition);
+    variant_publish_state(variant, state);
 }
 
 ROX_INTERNAL void variant_free(RoxStringBase *variant) {
@@ -205,7 +227,9 @@ ROX_INTERNAL void variant_free(RoxStringBase *variant) {
         }
     })
     rox_map_free_with_values_cb(variant->extra, free);
-    variant_reset_evaluation_context(variant);
+    if (variant->state) {
+        variant_state_free(variant->state);
+    }
     if (variant->name) {
         free(variant->name);
     }
@@ -215,9 +239,6 @@ ROX_INTERNAL void variant_free(RoxStringBase *variant) {
     if (variant->options) {
         rox_list_free_cb(variant->options, &free);
     }
-    if (variant->experiment) {
-        experiment_model_free(variant->experiment);
-    }
     free(variant);
 }
 
@@ -243,9 +264,9 @@ static char *string_value_to_string(RoxDynamicValue *value) {
 }
 
 static RoxDynamicValue *string_to_int_value(const char *str) {
-    int *parsed = mem_str_to_int(str);
-    if (parsed) {
-        return rox_dynamic_value_create_int_ptr(parsed);
+    int parsed;
+    if (str && str_parse_int(str, &parsed)) {
+        return rox_dynamic_value_create_int(parsed);
     }
     return NULL;
 }
@@ -264,19 +285,17 @@ static RoxDynamicValue *result_to_int_value(EvaluationResult *result) {
         return rox_dynamic_value_create_int(*int_ptr);
     }
     char *str = result_get_string(result);
-    if (str) {
-        int *parsed = mem_str_to_int(str);
-        if (parsed) {
-            return rox_dynamic_value_create_int_ptr(parsed);
-        }
+    int parsed;
+    if (str && str_parse_int(str, &parsed)) {
+        return rox_dynamic_value_create_int(parsed);
     }
     return NULL;
 }
 
 static RoxDynamicValue *string_to_double_value(const char *str) {
-    double *parsed = mem_str_to_double(str);
-    if (parsed) {
-        return rox_dynamic_value_create_double_ptr(parsed);
+    double parsed;
+    if (str && str_parse_double(str, &parsed)) {
+        return rox_dynamic_value_create_double(parsed);
     }
     return NULL;
 }
@@ -299,11 +318,9 @@ static RoxDynamicValue *result_to_double_value(EvaluationResult *result) {
         return rox_dynamic_value_create_double(*int_ptr);
     }
     char *str = result_get_string(result);
-    if (str) {
-        double *parsed = mem_str_to_double(str);
-        if (parsed) {
-            return rox_dynamic_value_create_double_ptr(parsed);
-        }
+    double parsed;
+    if (str && str_parse_double(str, &parsed)) {
+        return rox_dynamic_value_create_double(parsed);
     }
     return NULL;
 }
@@ -340,14 +357,6 @@ static RoxDynamicValue *result_to_bool_value(EvaluationResult *result) {
     return NULL;
 }
 
-struct EvaluationContext {
-    RoxStringBase *variant;
-    RoxContext *context;
-    bool invoke_impression;
-    bool use_freeze;
-    bool use_overrides;
-};
-
 ROX_INTERNAL void variant_set_config(RoxStringBase *variant, VariantConfig *config) {
     assert(variant != NULL);
     assert(config != NULL);
@@ -401,10 +410,13 @@ ROX_INTERNAL RoxDynamicValue *variant_get_value(
         default_value = variant->default_value;
     }
 
-    if (variant->parser && !str_is_empty(variant->condition)) {
+    // the state, and the configuration the condition refers to, stay alive until the end of the section
+    int epoch_token = epoch_read_begin();
+    VariantState *state = variant_get_state(variant);
+    if (state && state->parser && !str_is_empty(state->condition)) {
         EvaluationResult *evaluation_result = parser_evaluate_expression(
-                variant->parser,
-                variant->condition,
+                state->parser,
+                state->condition,
                 eval_context);
         if (evaluation_result) {
             ret_val = converter->from_eval_result(evaluation_result);
@@ -417,46 +429,71 @@ ROX_INTERNAL RoxDynamicValue *variant_get_value(
     if (!ret_val) {
         ret_val = converter->from_string(default_value);
     }
-    if ((!eval_context || eval_context->invoke_impression) && variant->impression_invoker) {
+    if ((!eval_context || eval_context->invoke_impression) && state && state->impression_invoker &&
+        impression_invoker_has_handlers(state->impression_invoker)) {
         char *string_value = converter->to_string(ret_val);
-        RoxReportingValue *reporting_value = reporting_value_create(
-                variant->name,
-                string_value,
-                variant->experiment != NULL);
-        impression_invoker_invoke(
-                variant->impression_invoker,
-                reporting_value,
-                variant->experiment,
-                used_context);
-        reporting_value_free(reporting_value);
-        free(string_value);
+        if (eval_context && eval_context->impressions) {
+            impression_buffer_add(
+                    eval_context->impressions,
+                    state->impression_invoker,
+                    variant->name,
+                    string_value,
+                    state->experiment,
+                    used_context);
+        } else {
+            RoxReportingValue *reporting_value = reporting_value_create(
+                    variant->name,
+                    string_value,
+                    state->experiment != NULL);
+            impression_invoker_invoke(
+                    state->impression_invoker,
+                    reporting_value,
+                    state->experiment,
+                    used_context);
+            reporting_value_free(reporting_value);
+            free(string_value);
+        }
     }
+    epoch_read_end(epoch_token);
     return ret_val;
 }
 
+ROX_INTERNAL void eval_context_init(EvaluationContext *eval_context, RoxStringBase *variant, RoxContext *context) {
+    assert(eval_context);
+    eval_context->variant = variant;
+    eval_context->context = variant
+                            ? rox_context_init_merged(&eval_context->merged_context, variant->global_context, context)
+                            : context;
+    eval_context->invoke_impression = true;
+    eval_context->use_freeze = true;
+    eval_context->use_overrides = true;
+    eval_context->memo = NULL;
+    eval_context->impressions = NULL;
+}
+
 ROX_INTERNAL EvaluationContext *eval_context_create(RoxStringBase *variant, RoxContext *context) {
     EvaluationContext *ctx = calloc(1, sizeof(EvaluationContext));
-    ctx->variant = variant;
-    ctx->context = variant ? rox_context_create_merged(variant->global_context, context) : context;
-    ctx->invoke_impression = true;
-    ctx->use_freeze = true;
-    ctx->use_overrides = true;
+    eval_context_init(ctx, variant, context);
     return ctx;
 }
 
 ROX_INTERNAL EvaluationContext *eval_context_create_custom(EvalContextConfig *config) {
     assert(config != NULL);
     EvaluationContext *ctx = calloc(1, sizeof(EvaluationContext));
-    ctx->variant = config->variant;
-    ctx->context = config->variant
-                   ? rox_context_create_merged(config->variant->global_context, config->context)
-                   : config->context;
+    eval_context_init(ctx, config->variant, config->context);
     ctx->invoke_impression = config->invoke_impression;
     ctx->use_freeze = config->use_freeze;
     ctx->use_overrides = config->use_overrides;
     return ctx;
 }
 
+ROX_INTERNAL bool eval_context_is_initialized_for(EvaluationContext *eval_context, RoxStringBase *variant) {
+    assert(eval_context);
+    assert(variant);
+    return eval_context->variant &&
+           eval_context->merged_context.merged.global_context == variant->global_context;
+}
+
 ROX_INTERNAL RoxContext *eval_context_get_context(EvaluationContext *eval_context) {
     assert(eval_context);
     return eval_context->context;
@@ -472,10 +509,65 @@ ROX_INTERNAL bool eval_context_is_use_overrides(EvaluationContext *eval_context)
     return eval_context->use_overrides;
 }
 
-ROX_INTERNAL void eval_context_free(EvaluationContext *context) {
-    if (context->variant) {
-        rox_context_free(context->context); // free merged context
+ROX_INTERNAL void eval_memo_init(EvaluationMemo *memo) {
+    assert(memo);
+    memo->size = 0;
+}
+
+ROX_INTERNAL void eval_memo_release(EvaluationMemo *memo) {
+    assert(memo);
+    for (size_t i = 0; i < memo->size; ++i) {
+        if (memo->entries[i].value) {
+            rox_dynamic_value_free(memo->entries[i].value);
+        }
+    }
+    memo->size = 0;
+}
+
+ROX_INTERNAL bool eval_context_memo_get(
+        EvaluationContext *eval_context,
+        EvaluationMemoKind kind,
+        const RoxSymbol *symbol,
+        RoxDynamicValue **value) {
+    assert(eval_context);
+    assert(symbol);
+    assert(value);
+    EvaluationMemo *memo = eval_context->memo;
+    if (!memo) {
+        return false;
+    }
+    for (size_t i = 0; i < memo->size; ++i) {
+        EvaluationMemoEntry *entry = &memo->entries[i];
+        if (entry->symbol == symbol && entry->kind == kind) {
+            *value = entry->value;
+            return true;
+        }
     }
+    return false;
+}
+
+ROX_INTERNAL void eval_context_memo_put(
+        EvaluationContext *eval_context,
+        EvaluationMemoKind kind,
+        const RoxSymbol *symbol,
+        RoxDynamicValue *value) {
+    assert(eval_context);
+    assert(symbol);
+    EvaluationMemo *memo = eval_context->memo;
+    if (!memo || memo->size == ROX_EVAL_MEMO_CAPACITY) {
+        if (value) {
+            rox_dynamic_value_free(value);
+        }
+        return;
+    }
+    EvaluationMemoEntry *entry = &memo->entries[memo->size++];
+    entry->kind = kind;
+    entry->symbol = symbol;
+    entry->value = value;
+}
+
+ROX_INTERNAL void eval_context_free(EvaluationContext *context) {
+    assert(context);
     free(context);
 }
 
@@ -503,6 +595,88 @@ static FlagValueConverter DOUBLE_CONVERTER = {
         double_value_to_string
 };
 
+//
+// Typed evaluation, used for the variants evaluated by variant_get_value() itself, with no impression
+// to report. It gives the same results as the converters above, without creating any intermediate
+// EvaluationResult and RoxDynamicValue.
+//
+
+typedef bool (*typed_value_converter_func)(const VmValue *value, void *result);
+
+static bool value_to_bool(const VmValue *value, void *result) {
+    switch (value->type) {
+        case VmValueTypeNull:
+            *(bool *) result = false;
+            return true;
+        case VmValueTypeBoolean:
+            *(bool *) result = value->data.boolean_value;
+            return true;
+        case VmValueTypeString:
+            *(bool *) result = str_equals(value->data.str_value, FLAG_TRUE_VALUE);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool value_to_int(const VmValue *value, void *result) {
+    switch (value->type) {
+        case VmValueTypeInt:
+            *(int *) result = value->data.int_value;
+            return true;
+        case VmValueTypeString:
+            return str_parse_int(value->data.str_value, (int *) result);
+        default:
+            return false;
+    }
+}
+
+static bool value_to_double(const VmValue *value, void *result) {
+    switch (value->type) {
+        case VmValueTypeDouble:
+            *(double *) result = value->data.double_value;
+            return true;
+        case VmValueTypeInt:
+            *(double *) result = value->data.int_value;
+            return true;
+        case VmValueTypeString:
+            return str_parse_double(value->data.str_value, (double *) result);
+        default:
+            return false;
+    }
+}
+
+/**
+ * @param result Not <code>NULL</code>. Left untouched when the variant's value is not defined.
+ * @return <code>false</code> if the variant must be evaluated through its <code>eval_func</code> instead.
+ */
+static bool variant_get_typed_value(
+        RoxStringBase *variant,
+        EvaluationContext *eval_context,
+        typed_value_converter_func converter,
+        void *result) {
+    if (variant->eval_func != &variant_get_value) {
+        return false;
+    }
+    int epoch_token = epoch_read_begin();
+    VariantState *state = variant_get_state(variant);
+    if ((!eval_context || eval_context->invoke_impression) && state && state->impression_invoker &&
+        impression_invoker_has_handlers(state->impression_invoker)) {
+        epoch_read_end(epoch_token);
+        return false;
+    }
+    if (state && state->parser && !str_is_empty(state->condition)) {
+        VmValue value;
+        parser_evaluate_expression_value(state->parser, state->condition, eval_context, &value);
+        if (value.type != VmValueTypeUndefined) {
+            converter(&value, result);
+        }
+        vm_value_release(&value);
+    }
+    epoch_read_end(epoch_token);
+    return true;
+}
+
 ROX_INTERNAL char *
 variant_get_string(RoxStringBase *variant, const char *default_value, EvaluationContext *eval_context) {
     assert(variant);
@@ -517,6 +691,13 @@ variant_get_string(RoxStringBase *variant, const char *default_value, Evaluation
 
 ROX_INTERNAL int variant_get_int(RoxStringBase *variant, const char *default_value, EvaluationContext *eval_context) {
     assert(variant);
+    if (!default_value) {
+        default_value = variant->default_value;
+    }
+    int typed_value = default_value ? str_to_int(default_value, 0) : 0;
+    if (variant_get_typed_value(variant, eval_context, &value_to_int, &typed_value)) {
+        return typed_value;
+    }
     variant_eval_func eval_func = variant->eval_func;
     RoxDynamicValue *value = eval_func(variant, default_value, eval_context, &INT_CONVERTER);
     if (!value) {
@@ -534,6 +715,13 @@ ROX_INTERNAL int variant_get_int(RoxStringBase *variant, const char *default_val
 ROX_INTERNAL double
 variant_get_double(RoxStringBase *variant, const char *default_value, EvaluationContext *eval_context) {
     assert(variant);
+    if (!default_value) {
+        default_value = variant->default_value;
+    }
+    double typed_value = default_value ? str_to_double(default_value, 0.0) : 0.0;
+    if (variant_get_typed_value(variant, eval_context, &value_to_double, &typed_value)) {
+        return typed_value;
+    }
     variant_eval_func eval_func = variant->eval_func;
     RoxDynamicValue *value = eval_func(variant, default_value, eval_context, &DOUBLE_CONVERTER);
     if (!value) {
@@ -550,6 +738,13 @@ variant_get_double(RoxStringBase *variant, const char *default_value, Evaluation
 
 ROX_INTERNAL bool variant_get_bool(RoxStringBase *variant, const char *default_value, EvaluationContext *eval_context) {
     assert(variant);
+    if (!default_value) {
+        default_value = variant->default_value;
+    }
+    bool typed_value = default_value && str_equals(default_value, FLAG_TRUE_VALUE);
+    if (variant_get_typed_value(variant, eval_context, &value_to_bool, &typed_value)) {
+        return typed_value;
+    }
     variant_eval_func eval_func = variant->eval_func;
     RoxDynamicValue *value = eval_func(variant, default_value, eval_context, &BOOL_CONVERTER);
     bool return_value = rox_dynamic_value_get_boolean(value);
@@ -561,24 +756,24 @@ ROX_INTERNAL char *variant_get_value_as_string(RoxStringBase *variant, Evaluatio
     assert(variant);
     assert(eval_context);
     FlagValueConverter *converter;
-    RoxDynamicValue *value;
+    RoxDynamicValue value;
     if (variant->is_flag) {
-        value = rox_dynamic_value_create_boolean(variant_get_bool(variant, variant->default_value, eval_context));
+        value = dynamic_value_boolean(variant_get_bool(variant, variant->default_value, eval_context));
         converter = &BOOL_CONVERTER;
     } else if (variant->is_int) {
-        value = rox_dynamic_value_create_int(variant_get_int(variant, variant->default_value, eval_context));
+        value = dynamic_value_int(variant_get_int(variant, variant->default_value, eval_context));
         converter = &INT_CONVERTER;
     } else if (variant->is_double) {
-        value = rox_dynamic_value_create_double(variant_get_double(variant, variant->default_value, eval_context));
+        value = dynamic_value_double(variant_get_double(variant, variant->default_value, eval_context));
         converter = &DOUBLE_CONVERTER;
     } else if (variant->is_string) {
-        value = rox_dynamic_value_create_string_ptr(variant_get_string(variant, variant->default_value, eval_context));
+        value = dynamic_value_string_ptr(variant_get_string(variant, variant->default_value, eval_context));
         converter = &STRING_CONVERTER;
     } else {
         return NULL;
     }
-    char *result = converter->to_string(value);
-    rox_dynamic_value_free(value);
+    char *result = converter->to_string(&value);
+    dynamic_value_release(&value);
     return result;
 }
 
@@ -597,9 +792,11 @@ static void flag_setter_repository_callback(void *target, RoxStringBase *variant
     assert(target != NULL);
     assert(variant != NULL);
     FlagSetter *flag_setter = (FlagSetter *) target;
+    int epoch_token = epoch_read_begin();
     ExperimentModel *exp = experiment_repository_get_experiment_by_flag(
             flag_setter->experiment_repository, variant->name);
     variant_set_for_evaluation(variant, flag_setter->parser, exp, flag_setter->impression_invoker);
+    epoch_read_end(epoch_token);
 }
 
 ROX_INTERNAL FlagSetter *flag_setter_create(
@@ -622,21 +819,21 @@ ROX_INTERNAL void flag_setter_set_experiments(FlagSetter *flag_setter) {
     assert(flag_setter != NULL);
 
     RoxSet *flags_with_condition = rox_set_create();
+    int epoch_token = epoch_read_begin();
     RoxList *experiments = experiment_repository_get_all_experiments(flag_setter->experiment_repository);
 
     ROX_LIST_FOREACH(exp, experiments, {
         ExperimentModel *model = (ExperimentModel *) exp;
-        RoxListIter *flag_iter = rox_list_iter_create();
-        rox_list_iter_init(flag_iter, model->flags);
+        RoxListIter flag_iter;
+        rox_list_iter_init(&flag_iter, model->flags);
         char *flag_name;
-        while (rox_list_iter_next(flag_iter, (void **) &flag_name)) {
+        while (rox_list_iter_next(&flag_iter, (void **) &flag_name)) {
             RoxStringBase *flag = flag_repository_get_flag(flag_setter->flag_repository, flag_name);
             if (flag) {
                 variant_set_for_evaluation(flag, flag_setter->parser, exp, flag_setter->impression_invoker);
                 rox_set_add(flags_with_condition, flag_name);
             }
         }
-        rox_list_iter_free(flag_iter);
     })
 
     RoxMap *all_flags = flag_repository_get_all_flags(flag_setter->flag_repository);
@@ -647,9 +844,63 @@ ROX_INTERNAL void flag_setter_set_experiments(FlagSetter *flag_setter) {
         }
     })
 
+    epoch_read_end(epoch_token);
     rox_set_free(flags_with_condition);
 }
 
+// adds the flags of the experiments in snapshot which are bound differently in other
+static void _flag_setter_add_changed_flags(
+        RoxSet *changed_flags,
+        ConfigurationSnapshot *snapshot,
+        ConfigurationSnapshot *other) {
+    RoxList *experiments = configuration_snapshot_get_experiments(snapshot);
+    ROX_LIST_FOREACH(item, experiments, {
+        ExperimentModel *model = (ExperimentModel *) item;
+        if (!model->flags) {
+            continue;
+        }
+        ExperimentModel *other_model = model->id && configuration_snapshot_get_experiment(snapshot, model->id) == model
+                                       ? configuration_snapshot_get_experiment(other, model->id)
+                                       : NULL;
+        bool changed = !other_model || !experiment_model_equals(model, other_model);
+        RoxListIter flag_iter;
+        rox_list_iter_init(&flag_iter, model->flags);
+        char *flag_name;
+        while (rox_list_iter_next(&flag_iter, (void **) &flag_name)) {
+            // an unchanged experiment may still stop being the first one using the flag
+            if (changed ||
+                (configuration_snapshot_get_experiment_by_flag(snapshot, flag_name) == model) !=
+                (configuration_snapshot_get_experiment_by_flag(other, flag_name) == other_model)) {
+                rox_set_add(changed_flags, flag_name);
+            }
+        }
+    })
+}
+
+ROX_INTERNAL void flag_setter_set_changed_experiments(FlagSetter *flag_setter, ConfigurationSnapshot *previous) {
+    assert(flag_setter);
+    assert(previous);
+
+    RoxSet *changed_flags = rox_set_create();
+    int epoch_token = epoch_read_begin();
+    ConfigurationSnapshot *snapshot = experiment_repository_get_snapshot(flag_setter->experiment_repository);
+    _flag_setter_add_changed_flags(changed_flags, snapshot, previous);
+    _flag_setter_add_changed_flags(changed_flags, previous, snapshot);
+
+    ROX_SET_FOREACH(item, changed_flags, {
+        const char *flag_name = (const char *) item;
+        RoxStringBase *flag = flag_repository_get_flag(flag_setter->flag_repository, flag_name);
+        if (flag) {
+            variant_set_for_evaluation(flag, flag_setter->parser,
+                                       configuration_snapshot_get_experiment_by_flag(snapshot, flag_name),
+                                       flag_setter->impression_invoker);
+        }
+    })
+
+    epoch_read_end(epoch_token);
+    rox_set_free(changed_flags);
+}
+
 ROX_INTERNAL void flag_setter_free(FlagSetter *flag_setter) {
     assert(flag_setter);
     free(flag_setter);
@@ -262,6 +262,8 @@ typedef struct FlagRepository FlagRepository;
 
 typedef struct ExperimentRepository ExperimentRepository;
 
+typedef struct ConfigurationSnapshot ConfigurationSnapshot;
+
 /**
  * The returned object must be destroyed after use by calling <code>flag_setter_free</code>.
  *
@@ -282,6 +284,16 @@ ROX_INTERNAL FlagSetter *flag_setter_create(
  */
 ROX_INTERNAL void flag_setter_set_experiments(FlagSetter *flag_setter);
 
+/**
+ * Same as <code>flag_setter_set_experiments()</code>, but only the flags whose experiment differs
+ * from the one in <code>previous</code> are set again.
+ *
+ * @param flag_setter Not <code>NULL</code>.
+ * @param previous Not <code>NULL</code>. Snapshot the flags were set from, must stay valid during the call,
+ * e.g. by being loaded within the caller's read section.
+ */
+ROX_INTERNAL void flag_setter_set_changed_experiments(FlagSetter *flag_setter, ConfigurationSnapshot *previous);
+
 /**
  * @param flag_setter Not <code>NULL</code>.
  */
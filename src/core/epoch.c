@@ -0,0 +1,150 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "epoch.h"
+#include "util.h"
+
+//
+// Readers register in one of the two counters chosen by the parity of the current epoch. To reclaim
+// the objects retired so far, the epoch is advanced and the objects are freed as soon as the counter
+// of the previous parity drops to zero: readers that come later register in the other counter and
+// can only load the pointers published in the meantime.
+//
+
+typedef struct EpochRetired {
+    void *ptr;
+    epoch_free_func free_func;
+    struct EpochRetired *next;
+} EpochRetired;
+
+static struct {
+    long epoch;
+    long readers[2];
+    // retired, waiting for the next epoch change
+    EpochRetired *pending;
+    // retired before the last epoch change, waiting for the readers of its previous parity
+    EpochRetired *draining;
+    int draining_parity;
+    // whether any of the two lists above is non-empty
+    int has_retired;
+} epoch_state;
+
+static pthread_mutex_t epoch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void epoch_free_retired(EpochRetired *retired) {
+    while (retired) {
+        EpochRetired *next = retired->next;
+        retired->free_func(retired->ptr);
+        free(retired);
+        retired = next;
+    }
+}
+
+/**
+ * Must be called with epoch_lock held.
+ *
+ * @return Objects that are safe to free now, the caller is responsible for freeing them outside of the lock.
+ */
+static EpochRetired *epoch_reclaim_unsafe() {
+    EpochRetired *reclaimed = NULL;
+    if (epoch_state.draining) {
+        if (__atomic_load_n(&epoch_state.readers[epoch_state.draining_parity], __ATOMIC_SEQ_CST) != 0) {
+            return NULL;
+        }
+        reclaimed = epoch_state.draining;
+        epoch_state.draining = NULL;
+    }
+    if (epoch_state.pending) {
+        long epoch = __atomic_add_fetch(&epoch_state.epoch, 1, __ATOMIC_SEQ_CST);
+        epoch_state.draining = epoch_state.pending;
+        epoch_state.draining_parity = (int) ((epoch - 1) & 1);
+        epoch_state.pending = NULL;
+        if (__atomic_load_n(&epoch_state.readers[epoch_state.draining_parity], __ATOMIC_SEQ_CST) == 0) {
+            EpochRetired *last = epoch_state.draining;
+            while (last->next) {
+                last = last->next;
+            }
+            last->next = reclaimed;
+            reclaimed = epoch_state.draining;
+            epoch_state.draining = NULL;
+        }
+    }
+    __atomic_store_n(&epoch_state.has_retired, epoch_state.draining != NULL, __ATOMIC_SEQ_CST);
+    return reclaimed;
+}
+
+static void epoch_try_reclaim(bool wait) {
+    EpochRetired *reclaimed;
+    if (wait) {
+        pthread_mutex_lock(&epoch_lock);
+    } else if (pthread_mutex_trylock(&epoch_lock) != 0) {
+        return;
+    }
+    reclaimed = epoch_reclaim_unsafe();
+    pthread_mutex_unlock(&epoch_lock);
+    epoch_free_retired(reclaimed);
+}
+
+ROX_INTERNAL int epoch_read_begin() {
+    while (true) {
+        int parity = (int) (__atomic_load_n(&epoch_state.epoch, __ATOMIC_SEQ_CST) & 1);
+        __atomic_add_fetch(&epoch_state.readers[parity], 1, __ATOMIC_SEQ_CST);
+        if ((__atomic_load_n(&epoch_state.epoch, __ATOMIC_SEQ_CST) & 1) == parity) {
+            return parity;
+        }
+        // the epoch has changed in the meantime, the writer may not be waiting for this counter
+        __atomic_sub_fetch(&epoch_state.readers[parity], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+ROX_INTERNAL void epoch_read_end(int token) {
+    assert(token == 0 || token == 1);
+    if (__atomic_sub_fetch(&epoch_state.readers[token], 1, __ATOMIC_SEQ_CST) == 0 &&
+        __atomic_load_n(&epoch_state.has_retired, __ATOMIC_SEQ_CST)) {
+        // the last reader frees what it was holding back, unless another thread is doing that already
+        epoch_try_reclaim(false);
+    }
+}
+
+ROX_INTERNAL void *epoch_load(void *const *location) {
+    assert(location);
+    return __atomic_load_n(location, __ATOMIC_ACQUIRE);
+}
+
+ROX_INTERNAL void epoch_publish(void **location, void *value) {
+    assert(location);
+    __atomic_store_n(location, value, __ATOMIC_SEQ_CST);
+}
+
+ROX_INTERNAL void epoch_retire(void *ptr, epoch_free_func free_func) {
+    assert(free_func);
+    if (!ptr) {
+        return;
+    }
+    EpochRetired *retired = calloc(1, sizeof(EpochRetired));
+    retired->ptr = ptr;
+    retired->free_func = free_func;
+    pthread_mutex_lock(&epoch_lock);
+    retired->next = epoch_state.pending;
+    epoch_state.pending = retired;
+    __atomic_store_n(&epoch_state.has_retired, 1, __ATOMIC_SEQ_CST);
+    EpochRetired *reclaimed = epoch_reclaim_unsafe();
+    pthread_mutex_unlock(&epoch_lock);
+    epoch_free_retired(reclaimed);
+}
+
+ROX_INTERNAL void epoch_synchronize() {
+    while (true) {
+        pthread_mutex_lock(&epoch_lock);
+        EpochRetired *reclaimed = epoch_reclaim_unsafe();
+        bool done = !epoch_state.draining && !epoch_state.pending;
+        pthread_mutex_unlock(&epoch_lock);
+        epoch_free_retired(reclaimed);
+        if (done) {
+            return;
+        }
+        thread_sleep(0);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "rox/defs.h"
+
+//
+// Epoch based memory reclamation.
+//
+// Data shared with the evaluating threads (configuration snapshots, compiled expressions etc.) is
+// never modified in place. A writer publishes a new immutable version with epoch_publish() and hands
+// the replaced one to epoch_retire(). Readers wrap their accesses with epoch_read_begin() and
+// epoch_read_end() and load the pointers with epoch_load(). Neither of these takes a lock.
+// A retired object is freed once all the readers that could have loaded it have left their sections.
+//
+// Read sections may nest, but a thread must not wait for the reclamation while being inside one.
+//
+
+typedef void (*epoch_free_func)(void *ptr);
+
+/**
+ * @return Token to pass to the matching <code>epoch_read_end()</code>.
+ */
+ROX_INTERNAL int epoch_read_begin();
+
+/**
+ * @param token Value returned by the matching <code>epoch_read_begin()</code>.
+ */
+ROX_INTERNAL void epoch_read_end(int token);
+
+/**
+ * @param location Not <code>NULL</code>.
+ * @return Value stored at <code>location</code> by <code>epoch_publish()</code>.
+ */
+ROX_INTERNAL void *epoch_load(void *const *location);
+
+/**
+ * Makes <code>value</code> visible to the readers, along with everything written before.
+ *
+ * @param location Not <code>NULL</code>.
+ * @param value May be <code>NULL</code>.
+ */
+ROX_INTERNAL void epoch_publish(void **location, void *value);
+
+/**
+ * Frees <code>ptr</code> by calling <code>free_func</code> once no reader can see it anymore.
+ * That's immediately when there are no readers at the moment, so objects retired outside of the
+ * read sections are freed by the time this returns.
+ *
+ * @param ptr May be <code>NULL</code>, in which case nothing happens.
+ * @param free_func Not <code>NULL</code>.
+ */
+ROX_INTERNAL void epoch_retire(void *ptr, epoch_free_func free_func);
+
+/**
+ * Frees all the retired objects, waiting for the current readers to leave.
+ * Must not be called from within a read section.
+ */
+ROX_INTERNAL void epoch_synchronize();
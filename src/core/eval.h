@@ -1,12 +1,67 @@
 #pragma once
 
 #include "rox/flags.h"
+#include "core/context.h"
+#include "core/impression.h"
 
 // EvaluationContext
 
 typedef struct EvaluationResult EvaluationResult;
 
-typedef struct EvaluationContext EvaluationContext;
+//
+// EvaluationMemo.
+//
+// Results of the operators that are costly to evaluate again (custom properties, nested target groups
+// and flags), computed once per evaluation and looked up by the interned operand. It holds a few
+// entries inline, so that it lives on the stack; the results that don't fit are just not memoized.
+//
+
+#define ROX_EVAL_MEMO_CAPACITY 16
+
+typedef enum EvaluationMemoKind {
+    EvaluationMemoProperty,
+    EvaluationMemoTargetGroup,
+    EvaluationMemoFlagValue
+} EvaluationMemoKind;
+
+typedef struct EvaluationMemoEntry {
+    EvaluationMemoKind kind;
+    const RoxSymbol *symbol;
+    // NULL when the result is undefined or null, depending on the operator
+    RoxDynamicValue *value;
+} EvaluationMemoEntry;
+
+typedef struct EvaluationMemo {
+    size_t size;
+    EvaluationMemoEntry entries[ROX_EVAL_MEMO_CAPACITY];
+} EvaluationMemo;
+
+/**
+ * @param memo Not <code>NULL</code>.
+ */
+ROX_INTERNAL void eval_memo_init(EvaluationMemo *memo);
+
+/**
+ * Drops the references to all the memoized values.
+ *
+ * @param memo Not <code>NULL</code>.
+ */
+ROX_INTERNAL void eval_memo_release(EvaluationMemo *memo);
+
+// Defined here, rather than kept opaque, so that it can live on the stack of the evaluating function.
+typedef struct EvaluationContext {
+    RoxStringBase *variant;
+    RoxContext *context;
+    bool invoke_impression;
+    bool use_freeze;
+    bool use_overrides;
+    // backs context when the variant's global context is merged in
+    InlineMergedContext merged_context;
+    // set for the duration of the outermost expression evaluation, unless set beforehand
+    EvaluationMemo *memo;
+    // when set, the impressions are collected instead of being invoked right away
+    ImpressionBuffer *impressions;
+} EvaluationContext;
 
 typedef RoxDynamicValue *(*from_string_converter_func)(const char *value);
 
@@ -33,6 +88,16 @@ typedef RoxDynamicValue *(*variant_eval_func)(
  */
 ROX_INTERNAL EvaluationContext *eval_context_create(RoxStringBase *variant, RoxContext *context);
 
+/**
+ * Same as <code>eval_context_create()</code>, but nothing is allocated, so there's nothing to free.
+ * The initialized context refers to itself, so it must not be copied.
+ *
+ * @param eval_context Not <code>NULL</code>.
+ * @param variant May be <code>NULL</code>.
+ * @param context May be <code>NULL</code>.
+ */
+ROX_INTERNAL void eval_context_init(EvaluationContext *eval_context, RoxStringBase *variant, RoxContext *context);
+
 typedef struct EvalContextConfig {
     RoxStringBase *variant;
     RoxContext *context;
@@ -43,10 +108,41 @@ typedef struct EvalContextConfig {
 
 ROX_INTERNAL EvaluationContext *eval_context_create_custom(EvalContextConfig *config);
 
+/**
+ * @param eval_context Not <code>NULL</code>. Initialized by <code>eval_context_init()</code>.
+ * @param variant Not <code>NULL</code>.
+ * @return Whether the context was initialized for a variant with the same global context, so that
+ * it evaluates the given variant the same way once its <code>variant</code> is replaced.
+ */
+ROX_INTERNAL bool eval_context_is_initialized_for(EvaluationContext *eval_context, RoxStringBase *variant);
+
 ROX_INTERNAL RoxContext *eval_context_get_context(EvaluationContext *eval_context);
 
 ROX_INTERNAL bool eval_context_is_use_freeze(EvaluationContext *eval_context);
 
 ROX_INTERNAL bool eval_context_is_use_overrides(EvaluationContext *eval_context);
 
+/**
+ * @param eval_context Not <code>NULL</code>.
+ * @param symbol Not <code>NULL</code>.
+ * @param value Not <code>NULL</code>. Set to the memoized value, still owned by the memo.
+ * @return Whether the result was memoized. Always <code>false</code> when there's no memo.
+ */
+ROX_INTERNAL bool eval_context_memo_get(
+        EvaluationContext *eval_context,
+        EvaluationMemoKind kind,
+        const RoxSymbol *symbol,
+        RoxDynamicValue **value);
+
+/**
+ * @param eval_context Not <code>NULL</code>.
+ * @param symbol Not <code>NULL</code>.
+ * @param value May be <code>NULL</code>. The ownership is transferred to the memo in any case.
+ */
+ROX_INTERNAL void eval_context_memo_put(
+        EvaluationContext *eval_context,
+        EvaluationMemoKind kind,
+        const RoxSymbol *symbol,
+        RoxDynamicValue *value);
+
 ROX_INTERNAL void eval_context_free(EvaluationContext *context);
@@ -40,6 +40,11 @@ ROX_INTERNAL void impression_invoker_register(
     rox_list_add(impression_invoker->handlers, h);
 }
 
+ROX_INTERNAL bool impression_invoker_has_handlers(ImpressionInvoker *impression_invoker) {
+    assert(impression_invoker);
+    return impression_invoker->delegate || rox_list_size(impression_invoker->handlers) > 0;
+}
+
 ROX_INTERNAL void impression_invoker_invoke(
         ImpressionInvoker *impression_invoker,
         RoxReportingValue *value,
@@ -64,4 +69,74 @@ ROX_INTERNAL void impression_invoker_free(ImpressionInvoker *impression_invoker)
     assert(impression_invoker);
     rox_list_free_cb(impression_invoker->handlers, &free);
     free(impression_invoker);
-}
\ No newline at end of file
+}
+
+typedef struct BufferedImpression {
+    ImpressionInvoker *invoker;
+    char *name;
+    char *value;
+    ExperimentModel *experiment;
+    RoxContext *context;
+} BufferedImpression;
+
+struct ImpressionBuffer {
+    RoxList *impressions; // of BufferedImpression*
+};
+
+ROX_INTERNAL ImpressionBuffer *impression_buffer_create() {
+    ImpressionBuffer *buffer = calloc(1, sizeof(ImpressionBuffer));
+    buffer->impressions = rox_list_create();
+    return buffer;
+}
+
+ROX_INTERNAL void impression_buffer_add(
+        ImpressionBuffer *buffer,
+        ImpressionInvoker *impression_invoker,
+        const char *name,
+        char *value,
+        ExperimentModel *experiment,
+        RoxContext *context) {
+    assert(buffer);
+    assert(impression_invoker);
+    BufferedImpression *impression = calloc(1, sizeof(BufferedImpression));
+    impression->invoker = impression_invoker;
+    impression->name = name ? mem_copy_str(name) : NULL;
+    impression->value = value;
+    impression->experiment = experiment ? experiment_model_copy(experiment) : NULL;
+    impression->context = context;
+    rox_list_add(buffer->impressions, impression);
+}
+
+static void buffered_impression_free(BufferedImpression *impression) {
+    assert(impression);
+    if (impression->name) {
+        free(impression->name);
+    }
+    if (impression->value) {
+        free(impression->value);
+    }
+    if (impression->experiment) {
+        experiment_model_free(impression->experiment);
+    }
+    free(impression);
+}
+
+ROX_INTERNAL void impression_buffer_flush(ImpressionBuffer *buffer) {
+    assert(buffer);
+    ROX_LIST_FOREACH(item, buffer->impressions, {
+        BufferedImpression *impression = (BufferedImpression *) item;
+        RoxReportingValue value;
+        value.name = impression->name;
+        value.value = impression->value;
+        value.targeting = impression->experiment != NULL;
+        impression_invoker_invoke(impression->invoker, &value, impression->experiment, impression->context);
+        buffered_impression_free(impression);
+    })
+    rox_list_remove_all(buffer->impressions);
+}
+
+ROX_INTERNAL void impression_buffer_free(ImpressionBuffer *buffer) {
+    assert(buffer);
+    rox_list_free_cb(buffer->impressions, (void (*)(void *)) &buffered_impression_free);
+    free(buffer);
+}
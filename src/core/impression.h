@@ -49,6 +49,12 @@ ROX_INTERNAL void impression_invoker_register(
         void *target,
         rox_impression_handler handler);
 
+/**
+ * @param impression_invoker Not <code>NULL</code>.
+ * @return Whether there's a delegate or a handler to invoke, so that the impression is worth reporting.
+ */
+ROX_INTERNAL bool impression_invoker_has_handlers(ImpressionInvoker *impression_invoker);
+
 /**
  * @param impression_invoker Not <code>NULL</code>.
  * @param value May be <code>NULL</code>.
@@ -64,4 +70,45 @@ ROX_INTERNAL void impression_invoker_invoke(
 /**
  * @param impression_invoker Not <code>NULL</code>.
  */
-ROX_INTERNAL void impression_invoker_free(ImpressionInvoker *impression_invoker);
\ No newline at end of file
+ROX_INTERNAL void impression_invoker_free(ImpressionInvoker *impression_invoker);
+
+//
+// ImpressionBuffer.
+//
+// Impressions collected while evaluating the flags of an evaluation session, and reported together
+// when the session ends.
+//
+
+typedef struct ImpressionBuffer ImpressionBuffer;
+
+ROX_INTERNAL ImpressionBuffer *impression_buffer_create();
+
+/**
+ * @param buffer Not <code>NULL</code>.
+ * @param impression_invoker Not <code>NULL</code>. Must outlive the buffered impression.
+ * @param name May be <code>NULL</code>. Copied internally.
+ * @param value May be <code>NULL</code>. The ownership is transferred to the buffer.
+ * @param experiment May be <code>NULL</code>. Copied internally.
+ * @param context May be <code>NULL</code>. Must outlive the buffered impression.
+ */
+ROX_INTERNAL void impression_buffer_add(
+        ImpressionBuffer *buffer,
+        ImpressionInvoker *impression_invoker,
+        const char *name,
+        char *value,
+        ExperimentModel *experiment,
+        RoxContext *context);
+
+/**
+ * Invokes the buffered impressions in the order they were added, and removes them.
+ *
+ * @param buffer Not <code>NULL</code>.
+ */
+ROX_INTERNAL void impression_buffer_flush(ImpressionBuffer *buffer);
+
+/**
+ * The impressions still buffered are dropped.
+ *
+ * @param buffer Not <code>NULL</code>.
+ */
+ROX_INTERNAL void impression_buffer_free(ImpressionBuffer *buffer);
\ No newline at end of file
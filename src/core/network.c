@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <ctype.h>
 #include "core/logging.h"
 #include "network.h"
 #include "util.h"
@@ -42,6 +43,8 @@ struct HttpResponseMessage {
     int status;
     char *content;
     size_t content_len;
+    char *etag;
+    char *last_modified;
 };
 
 ROX_INTERNAL HttpResponseMessage *response_message_create(int status, char *data) {
@@ -62,11 +65,22 @@ ROX_INTERNAL bool response_message_is_successful(HttpResponseMessage *message) {
     return message->status >= 200 && message->status <= 299;
 }
 
+ROX_INTERNAL bool response_message_is_not_modified(HttpResponseMessage *message) {
+    assert(message);
+    return message->status == 304;
+}
+
 ROX_INTERNAL void response_message_free(HttpResponseMessage *message) {
     assert(message);
     if (message->content) {
         free(message->content);
     }
+    if (message->etag) {
+        free(message->etag);
+    }
+    if (message->last_modified) {
+        free(message->last_modified);
+    }
     free(message);
 }
 
@@ -75,6 +89,99 @@ ROX_INTERNAL char *response_get_contents(HttpResponseMessage *message) {
     return message->content;
 }
 
+ROX_INTERNAL void response_message_set_validators(
+        HttpResponseMessage *message,
+        const char *etag,
+        const char *last_modified) {
+    assert(message);
+    if (message->etag) {
+        free(message->etag);
+    }
+    if (message->last_modified) {
+        free(message->last_modified);
+    }
+    message->etag = etag ? mem_copy_str(etag) : NULL;
+    message->last_modified = last_modified ? mem_copy_str(last_modified) : NULL;
+}
+
+ROX_INTERNAL const char *response_message_get_etag(HttpResponseMessage *message) {
+    assert(message);
+    return message->etag;
+}
+
+ROX_INTERNAL const char *response_message_get_last_modified(HttpResponseMessage *message) {
+    assert(message);
+    return message->last_modified;
+}
+
+//
+// Shared cache
+//
+
+// DNS and TLS session caches shared by all the curl handles of the process, so that the new connections
+// to the same host skip the lookup and resume the TLS session. The connection cache isn't shared, since
+// libcurl doesn't support sharing it between the concurrent threads; each thread's handle keeps its own
+// connections alive instead.
+static struct {
+    CURLSH *share;
+    int ref_count;
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+} network_share;
+
+static pthread_mutex_t network_share_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _network_share_lock_func(CURL *curl, curl_lock_data data, curl_lock_access access, void *userptr) {
+    pthread_mutex_lock(&network_share.locks[data]);
+}
+
+static void _network_share_unlock_func(CURL *curl, curl_lock_data data, void *userptr) {
+    pthread_mutex_unlock(&network_share.locks[data]);
+}
+
+ROX_INTERNAL void network_share_retain() {
+    pthread_mutex_lock(&network_share_lock);
+    if (network_share.ref_count++ == 0) {
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i) {
+            pthread_mutex_init(&network_share.locks[i], NULL);
+        }
+        network_share.share = curl_share_init();
+        curl_share_setopt(network_share.share, CURLSHOPT_LOCKFUNC, &_network_share_lock_func);
+        curl_share_setopt(network_share.share, CURLSHOPT_UNLOCKFUNC, &_network_share_unlock_func);
+        curl_share_setopt(network_share.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(network_share.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    pthread_mutex_unlock(&network_share_lock);
+}
+
+ROX_INTERNAL bool network_share_attach(void *curl) {
+    assert(curl);
+    pthread_mutex_lock(&network_share_lock);
+    assert(network_share.ref_count > 0);
+    CURLcode res = curl_easy_setopt(curl, CURLOPT_SHARE, network_share.share);
+    pthread_mutex_unlock(&network_share_lock);
+    return res == CURLE_OK;
+}
+
+ROX_INTERNAL void *network_share_get() {
+    pthread_mutex_lock(&network_share_lock);
+    CURLSH *share = network_share.share;
+    pthread_mutex_unlock(&network_share_lock);
+    return share;
+}
+
+ROX_INTERNAL void network_share_release() {
+    pthread_mutex_lock(&network_share_lock);
+    assert(network_share.ref_count > 0);
+    if (--network_share.ref_count == 0) {
+        curl_share_cleanup(network_share.share);
+        network_share.share = NULL;
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i) {
+            pthread_mutex_destroy(&network_share.locks[i]);
+        }
+    }
+    pthread_mutex_unlock(&network_share_lock);
+}
+
 //
 // Request
 //
@@ -87,6 +194,7 @@ struct Request {
     pthread_key_t thread_local_storage_key;
     int request_timeout;
     RoxList *curl_handles;
+    bool stopped;
 };
 
 typedef struct RequestCurlContext {
@@ -106,6 +214,55 @@ static void _request_delete_handle(RequestCurlHandle *handle) {
     pthread_setspecific(handle->request->thread_local_storage_key, NULL);
 }
 
+static size_t _request_curl_write_callback(char *contents, size_t size, size_t nmemb, void *userdata) {
+    size_t real_size = size * nmemb;
+    RequestCurlContext *context = (RequestCurlContext *) userdata;
+    HttpResponseMessage *message = context->message;
+    char *ptr = realloc(message->content, message->content_len + real_size + 1);
+    if (ptr == NULL) {
+        ROX_ERROR("not enough memory");
+        return 0;
+    }
+    message->content = ptr;
+    memcpy(&(message->content[message->content_len]), contents, real_size);
+    message->content_len += real_size;
+    message->content[message->content_len] = 0;
+    return real_size;
+}
+
+static int _request_curl_progress_callback(
+        void *clientp,
+        curl_off_t dltotal,
+        curl_off_t dlnow,
+        curl_off_t ultotal,
+        curl_off_t ulnow) {
+    Request *request = (Request *) clientp;
+    if (!request->stopped) {
+        return 0;
+    }
+    ROX_DEBUG("Request is stopped; returning 1 from progress callback");
+    return 1; // abort the current transfer
+}
+
+// clears the options left by the previous request, keeping the connections, and re-attaches the shared cache
+static void _request_reset_handle(Request *request, CURL *curl) {
+    assert(request);
+    assert(curl);
+    curl_easy_reset(curl);
+    network_share_attach(curl);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // enable all supported built-in compressions
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &_request_curl_write_callback);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, request->request_timeout > 0
+                                            ? request->request_timeout : 30);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &_request_curl_progress_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, request);
+#ifdef ROX_WINDOWS
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false); // FIXME: use Windows CA/root certs
+#endif
+}
+
 static CURL *_request_get_handle(Request *request) {
     assert(request);
     RequestCurlHandle *handle = pthread_getspecific(request->thread_local_storage_key);
@@ -119,19 +276,45 @@ static CURL *_request_get_handle(Request *request) {
     return handle->curl;
 }
 
-static size_t _request_curl_write_callback(char *contents, size_t size, size_t nmemb, void *userdata) {
-    size_t real_size = size * nmemb;
+// returns the trimmed value of the header line if it has the given name, or NULL
+static char *_request_get_header_value(const char *line, size_t line_len, const char *name) {
+    size_t name_len = strlen(name);
+    if (line_len <= name_len || line[name_len] != ':') {
+        return NULL;
+    }
+    for (size_t i = 0; i < name_len; ++i) {
+        if (tolower((unsigned char) line[i]) != tolower((unsigned char) name[i])) {
+            return NULL;
+        }
+    }
+    size_t start = name_len + 1;
+    size_t end = line_len;
+    while (start < end && isspace((unsigned char) line[start])) {
+        ++start;
+    }
+    while (end > start && isspace((unsigned char) line[end - 1])) {
+        --end;
+    }
+    return mem_str_substring_n(line, line_len, (int) start, (int) (end - start));
+}
+
+static size_t _request_curl_header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    size_t real_size = size * nitems;
     RequestCurlContext *context = (RequestCurlContext *) userdata;
     HttpResponseMessage *message = context->message;
-    char *ptr = realloc(message->content, message->content_len + real_size + 1);
-    if (ptr == NULL) {
-        ROX_ERROR("not enough memory");
-        return 0;
+    if (real_size > 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        // status line of the next response when following a redirect
+        response_message_set_validators(message, NULL, NULL);
+        return real_size;
+    }
+    char *value;
+    if ((value = _request_get_header_value(buffer, real_size, "ETag"))) {
+        response_message_set_validators(message, value, message->last_modified);
+        free(value);
+    } else if ((value = _request_get_header_value(buffer, real_size, "Last-Modified"))) {
+        response_message_set_validators(message, message->etag, value);
+        free(value);
     }
-    message->content = ptr;
-    memcpy(&(message->content[message->content_len]), contents, real_size);
-    message->content_len += real_size;
-    message->content[message->content_len] = 0;
     return real_size;
 }
 
@@ -142,10 +325,10 @@ static char *_request_build_url_with_params(Request *request, const char *url, R
     RoxList *kv_pairs = rox_list_create();
     CURL *curl = _request_get_handle(request);
 
-    RoxMapIter *i = rox_map_iter_create();
-    rox_map_iter_init(i, params);
+    RoxMapIter i;
+    rox_map_iter_init(&i, params);
     void *entry_key, *entry_value;
-    while (rox_map_iter_next(i, &entry_key, &entry_value)) {
+    while (rox_map_iter_next(&i, &entry_key, &entry_value)) {
         char *key = curl_easy_escape(curl, entry_key, 0);
         char *value = curl_easy_escape(curl, entry_value, 0);
         char *pair = mem_str_format("%s=%s", key, value);
@@ -153,7 +336,6 @@ static char *_request_build_url_with_params(Request *request, const char *url, R
         curl_free(value);
         rox_list_add(kv_pairs, pair);
     }
-    rox_map_iter_free(i);
     char *query_part = mem_str_join("&", kv_pairs);
     rox_list_free_cb(kv_pairs, &free);
     char *result = mem_str_format("%s?%s", url, query_part);
@@ -175,25 +357,23 @@ static cJSON *_build_json_from_params(RoxMap *params, RoxList *raw_json_params)
     return json;
 }
 
-static void _request_reset_handle(Request *request, CURL *curl) {
-    assert(request);
-    curl_easy_reset(curl);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
-    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // enable all supported built-in compressions
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &_request_curl_write_callback);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, request->request_timeout > 0
-                                            ? request->request_timeout : 30);
-#ifdef ROX_WINDOWS
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false); // FIXME: use Windows CA/root certs
-#endif
-}
-
 static HttpResponseMessage *_request_send_get(void *target, Request *request, RequestData *data) {
     assert(request);
     assert(data);
     char *url = data->params
                 ? _request_build_url_with_params(request, data->url, data->params)
                 : data->url;
+    struct curl_slist *headers = NULL;
+    if (data->if_none_match) {
+        char *header = mem_str_format("If-None-Match: %s", data->if_none_match);
+        headers = curl_slist_append(headers, header);
+        free(header);
+    }
+    if (data->if_modified_since) {
+        char *header = mem_str_format("If-Modified-Since: %s", data->if_modified_since);
+        headers = curl_slist_append(headers, header);
+        free(header);
+    }
     HttpResponseMessage *message = response_message_create(0, NULL);
     RequestCurlContext context = {request, message};
     CURL *curl = _request_get_handle(request);
@@ -201,8 +381,16 @@ static HttpResponseMessage *_request_send_get(void *target, Request *request, Re
     curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &context);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &_request_curl_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &context);
+    if (headers) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
 //    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
     CURLcode res = curl_easy_perform(curl);
+    if (headers) {
+        curl_slist_free_all(headers);
+    }
     if (res != CURLE_OK) {
         ROX_ERROR("curl_easy_perform() failed: %s", curl_easy_strerror(res));
     } else {
@@ -227,7 +415,7 @@ static HttpResponseMessage *_request_send_post_json(void *target, Request *reque
     CURL *curl = _request_get_handle(request);
     _request_reset_handle(request, curl);
     curl_easy_setopt(curl, CURLOPT_URL, uri);
-    curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &context);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
@@ -273,6 +461,7 @@ ROX_INTERNAL Request *request_create(RequestConfig *config) {
     int ret = pthread_key_create(&request->thread_local_storage_key, (void (*)(void *)) &_request_delete_handle);
     assert(ret == 0);
     request->curl_handles = ROX_EMPTY_LIST;
+    network_share_retain();
     return request;
 }
 
@@ -295,6 +484,11 @@ ROX_INTERNAL HttpResponseMessage *request_send_post_json(Request *request, const
     return request->send_post_json(request->target, request, uri, json);
 }
 
+ROX_INTERNAL void request_stop(Request *request) {
+    assert(request);
+    request->stopped = true;
+}
+
 ROX_INTERNAL void request_free(Request *request) {
     assert(request);
     ROX_LIST_FOREACH(item, request->curl_handles, {
@@ -306,6 +500,7 @@ ROX_INTERNAL void request_free(Request *request) {
     })
     rox_list_free(request->curl_handles);
     pthread_key_delete(request->thread_local_storage_key);
+    network_share_release();
     free(request);
 }
 
@@ -313,6 +508,43 @@ ROX_INTERNAL void request_free(Request *request) {
 // ConfigurationFetcher
 //
 
+// validators of the last configuration received from a source, for the conditional requests
+typedef struct ConfigurationValidators {
+    char *etag;
+    char *last_modified;
+} ConfigurationValidators;
+
+static void _configuration_validators_clear(ConfigurationValidators *validators) {
+    assert(validators);
+    if (validators->etag) {
+        free(validators->etag);
+        validators->etag = NULL;
+    }
+    if (validators->last_modified) {
+        free(validators->last_modified);
+        validators->last_modified = NULL;
+    }
+}
+
+static void _configuration_validators_update(ConfigurationValidators *validators, HttpResponseMessage *message) {
+    assert(validators);
+    assert(message);
+    _configuration_validators_clear(validators);
+    if (message->etag) {
+        validators->etag = mem_copy_str(message->etag);
+    }
+    if (message->last_modified) {
+        validators->last_modified = mem_copy_str(message->last_modified);
+    }
+}
+
+static void _configuration_validators_apply(ConfigurationValidators *validators, RequestData *data) {
+    assert(validators);
+    assert(data);
+    data->if_none_match = validators->etag;
+    data->if_modified_since = validators->last_modified;
+}
+
 struct ConfigurationFetcher {
     Request *request;
     SdkSettings *sdk_settings;
@@ -322,6 +554,8 @@ struct ConfigurationFetcher {
     ErrorReporter *reporter;
     char *roxy_url;
     bool cache_read;
+    ConfigurationValidators cdn_validators;
+    ConfigurationValidators roxy_validators;
 };
 
 ROX_INTERNAL ConfigurationFetcher *configuration_fetcher_create(
@@ -420,7 +654,9 @@ static ConfigurationFetchResult *_configuration_fetcher_create_result(
         return NULL;
     }
 
-    return configuration_fetch_result_create(json, source);
+    ConfigurationFetchResult *result = configuration_fetch_result_create(json, source);
+    configuration_fetch_result_set_digest(result, data);
+    return result;
 }
 
 static HttpResponseMessage *_configuration_fetcher_internal_fetch(ConfigurationFetcher *fetcher) {
@@ -435,6 +671,7 @@ static HttpResponseMessage *_configuration_fetcher_internal_fetch(ConfigurationF
     })
 
     RequestData *roxy_request = request_data_create(url, params, NULL);
+    _configuration_validators_apply(&fetcher->roxy_validators, roxy_request);
     HttpResponseMessage *message = request_send_get(fetcher->request, roxy_request);
     request_data_free(roxy_request);
     rox_map_free(params);
@@ -445,9 +682,16 @@ static HttpResponseMessage *_configuration_fetcher_internal_fetch(ConfigurationF
 static ConfigurationFetchResult *_configuration_fetcher_fetch_using_roxy_url(ConfigurationFetcher *fetcher) {
     assert(fetcher);
     HttpResponseMessage *message = _configuration_fetcher_internal_fetch(fetcher);
+    if (message && response_message_is_not_modified(message)) {
+        response_message_free(message);
+        return configuration_fetch_result_create_not_modified(CONFIGURATION_SOURCE_ROXY);
+    }
     if (message && response_message_is_successful(message)) {
         ConfigurationFetchResult *result = _configuration_fetcher_create_result(fetcher, message,
                                                                                 CONFIGURATION_SOURCE_ROXY);
+        if (result) {
+            _configuration_validators_update(&fetcher->roxy_validators, message);
+        }
         response_message_free(message);
         return result;
     } else {
@@ -482,12 +726,15 @@ static ConfigurationFetchResult *_configuration_fetcher_fetch_from_cache(Configu
         return NULL;
     }
     cJSON *json = cJSON_Parse(data);
-    rox_map_free_with_keys_and_values_cb(values, free, free);
     if (!json) {
         ROX_WARN("Failed to deserialize cached config JSON %s", data);
+        rox_map_free_with_keys_and_values_cb(values, free, free);
         return NULL;
     }
-    return configuration_fetch_result_create(json, CONFIGURATION_SOURCE_LOCAL_STORAGE);
+    ConfigurationFetchResult *result = configuration_fetch_result_create(json, CONFIGURATION_SOURCE_LOCAL_STORAGE);
+    configuration_fetch_result_set_digest(result, data);
+    rox_map_free_with_keys_and_values_cb(values, free, free);
+    return result;
 }
 
 static void _configuration_fetcher_update_cache(
@@ -543,6 +790,7 @@ ROX_INTERNAL HttpResponseMessage *configuration_fetcher_fetch_from_cdn(
     char *url = mem_str_format("%s/%s", buffer, path);
     RoxMap *params = ROX_MAP(ROX_PROPERTY_TYPE_DISTINCT_ID.name, distinct_id);
     RequestData *cdn_request = request_data_create(url, params, NULL);
+    _configuration_validators_apply(&fetcher->cdn_validators, cdn_request);
     HttpResponseMessage *message = request_send_get(fetcher->request, cdn_request);
     request_data_free(cdn_request);
     rox_map_free(params);
@@ -598,6 +846,12 @@ ROX_INTERNAL ConfigurationFetchResult *configuration_fetcher_fetch(Configuration
         return NULL;
     }
 
+    if (response_message_is_not_modified(message)) {
+        rox_map_free_with_values(properties);
+        response_message_free(message);
+        return configuration_fetch_result_create_not_modified(source);
+    }
+
     if (response_message_is_successful(message)) {
 
         result = _configuration_fetcher_create_result(fetcher, message, source);
@@ -624,6 +878,7 @@ ROX_INTERNAL ConfigurationFetchResult *configuration_fetcher_fetch(Configuration
 
         if (!should_retry) {
             // success from cdn
+            _configuration_validators_update(&fetcher->cdn_validators, message);
             rox_map_free_with_values(properties);
             response_message_free(message);
 #ifdef ROX_CLIENT
@@ -634,6 +889,7 @@ ROX_INTERNAL ConfigurationFetchResult *configuration_fetcher_fetch(Configuration
     }
 
     if (should_retry || message->status == 403 || message->status == 404) {
+        _configuration_validators_clear(&fetcher->cdn_validators);
         _configuration_fetcher_handle_error(fetcher, source, message, false, CONFIGURATION_SOURCE_API);
         source = CONFIGURATION_SOURCE_API;
         response_message_free(message);
@@ -661,8 +917,15 @@ ROX_INTERNAL ConfigurationFetchResult *configuration_fetcher_fetch(Configuration
     return NULL;
 }
 
+ROX_INTERNAL void configuration_fetcher_reset_validators(ConfigurationFetcher *fetcher) {
+    assert(fetcher);
+    _configuration_validators_clear(&fetcher->cdn_validators);
+    _configuration_validators_clear(&fetcher->roxy_validators);
+}
+
 ROX_INTERNAL void configuration_fetcher_free(ConfigurationFetcher *fetcher) {
     assert(fetcher);
+    configuration_fetcher_reset_validators(fetcher);
     if (fetcher->roxy_url) {
         free(fetcher->roxy_url);
     }
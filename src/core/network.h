@@ -8,6 +8,35 @@
 #include "reporting.h"
 #include "collections.h"
 
+//
+// Shared cache
+//
+// The DNS cache and TLS sessions are shared by all the curl handles of the process,
+// i.e. the handles of every Request and the notification reader. The shared cache lives while
+// it's retained by at least one user.
+//
+
+ROX_INTERNAL void network_share_retain();
+
+/**
+ * Attaches the shared cache to the given handle. Must be called between
+ * <code>network_share_retain()</code> and <code>network_share_release()</code>.
+ *
+ * @param curl Not <code>NULL</code>. The <code>CURL</code> easy handle.
+ * @return Whether the handle uses the shared cache.
+ */
+ROX_INTERNAL bool network_share_attach(void *curl);
+
+/**
+ * @return The <code>CURLSH</code> share handle, or <code>NULL</code> when nobody retains the shared cache.
+ */
+ROX_INTERNAL void *network_share_get();
+
+/**
+ * Frees the shared cache when it's the last user. All the handles it was attached to must be cleaned up before.
+ */
+ROX_INTERNAL void network_share_release();
+
 //
 // RequestData
 //
@@ -16,6 +45,10 @@ typedef struct RequestData {
     char *url;
     RoxMap *params;
     RoxList *raw_json_params;
+    // validators of the previously received content, sent with GET as If-None-Match
+    // and If-Modified-Since. May be NULL, not owned by the request data.
+    const char *if_none_match;
+    const char *if_modified_since;
 } RequestData;
 
 /**
@@ -55,6 +88,12 @@ ROX_INTERNAL int response_message_get_status(HttpResponseMessage *message);
  */
 ROX_INTERNAL bool response_message_is_successful(HttpResponseMessage *message);
 
+/**
+ * @param message Not <code>NULL</code>.
+ * @return Whether the content didn't change since the validators sent with the request (HTTP 304).
+ */
+ROX_INTERNAL bool response_message_is_not_modified(HttpResponseMessage *message);
+
 /**
  * Note: the returned string must <em>NOT</em> be freed after use by the caller.
  * @param message Not <code>NULL</code>.
@@ -62,6 +101,30 @@ ROX_INTERNAL bool response_message_is_successful(HttpResponseMessage *message);
  */
 ROX_INTERNAL char *response_get_contents(HttpResponseMessage *message);
 
+/**
+ * @param message Not <code>NULL</code>.
+ * @param etag May be <code>NULL</code>. Copied internally.
+ * @param last_modified May be <code>NULL</code>. Copied internally.
+ */
+ROX_INTERNAL void response_message_set_validators(
+        HttpResponseMessage *message,
+        const char *etag,
+        const char *last_modified);
+
+/**
+ * Note: the returned string must <em>NOT</em> be freed after use by the caller.
+ * @param message Not <code>NULL</code>.
+ * @return Value of the <code>ETag</code> header. May be <code>NULL</code>.
+ */
+ROX_INTERNAL const char *response_message_get_etag(HttpResponseMessage *message);
+
+/**
+ * Note: the returned string must <em>NOT</em> be freed after use by the caller.
+ * @param message Not <code>NULL</code>.
+ * @return Value of the <code>Last-Modified</code> header. May be <code>NULL</code>.
+ */
+ROX_INTERNAL const char *response_message_get_last_modified(HttpResponseMessage *message);
+
 /**
  * @param message Not <code>NULL</code>.
  */
@@ -121,6 +184,14 @@ ROX_INTERNAL HttpResponseMessage *request_send_post_json(Request *request, const
  */
 ROX_INTERNAL HttpResponseMessage *request_send_post(Request *request, RequestData *data);
 
+/**
+ * Aborts the transfer in progress, if any, and all the subsequent ones, so that the threads
+ * sending with the request don't wait for the request timeout on shutdown.
+ *
+ * @param request Not <code>NULL</code>.
+ */
+ROX_INTERNAL void request_stop(Request *request);
+
 /**
  * @param request Not <code>NULL</code>.
  */
@@ -167,11 +238,23 @@ ROX_INTERNAL ConfigurationFetcher *configuration_fetcher_create_roxy(
         const char *roxy_url);
 
 /**
+ * The CDN and roxy requests are conditional once a configuration was received from them,
+ * so that an unchanged configuration isn't downloaded again.
+ *
  * @param fetcher Not <code>NULL</code>.
- * @return May be <code>NULL</code>.
+ * @return May be <code>NULL</code>. The result is marked as <code>not_modified</code>, without the data,
+ * when the configuration didn't change since the previous fetch from the same source.
  */
 ROX_INTERNAL ConfigurationFetchResult *configuration_fetcher_fetch(ConfigurationFetcher *fetcher);
 
+/**
+ * Forgets the validators of the previously fetched configuration, so that the next fetch downloads it
+ * again. Called when the fetched configuration couldn't be applied.
+ *
+ * @param fetcher Not <code>NULL</code>.
+ */
+ROX_INTERNAL void configuration_fetcher_reset_validators(ConfigurationFetcher *fetcher);
+
 /**
  * @param fetcher Not <code>NULL</code>.
  */
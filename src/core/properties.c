@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include "properties.h"
 #include "util.h"
+#include "values.h"
+#include "context.h"
 
 //
 // CustomPropertyType
@@ -80,11 +82,16 @@ ROX_INTERNAL RoxDynamicValue *custom_property_get_value(CustomProperty *property
         return property->value_generator(property->target, context);
     }
     if (property->value) {
-        return rox_dynamic_value_create_copy(property->value);
+        return dynamic_value_retain(property->value);
     }
     return NULL;
 }
 
+ROX_INTERNAL bool custom_property_is_computed(CustomProperty *property) {
+    assert(property);
+    return property->value_generator != NULL;
+}
+
 ROX_INTERNAL cJSON *custom_property_to_json(CustomProperty *property) {
     assert(property);
     return ROX_JSON_OBJECT(
@@ -167,6 +174,11 @@ ROX_INTERNAL void dynamic_properties_set_rule(
     properties->rule = rule;
 }
 
+ROX_INTERNAL bool dynamic_properties_has_custom_rule(DynamicProperties *properties) {
+    assert(properties);
+    return properties->rule != &default_dynamic_properties_rule;
+}
+
 ROX_INTERNAL RoxDynamicValue *dynamic_properties_invoke(
         DynamicProperties *properties,
         const char *prop_name,
@@ -178,6 +190,18 @@ ROX_INTERNAL RoxDynamicValue *dynamic_properties_invoke(
     return NULL;
 }
 
+ROX_INTERNAL RoxDynamicValue *dynamic_properties_invoke_symbol(
+        DynamicProperties *properties,
+        const RoxSymbol *symbol,
+        RoxContext *context) {
+    assert(properties);
+    assert(symbol);
+    if (properties->rule == &default_dynamic_properties_rule) {
+        return context ? rox_context_get_symbol(context, symbol) : NULL;
+    }
+    return dynamic_properties_invoke(properties, symbol->name, context);
+}
+
 void dynamic_properties_free(DynamicProperties *properties) {
     assert(properties);
     free(properties);
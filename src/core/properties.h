@@ -4,6 +4,7 @@
 #include "rox/options.h"
 #include "rox/properties.h"
 #include "rox/context.h"
+#include "symbols.h"
 
 //
 // CustomPropertyType
@@ -71,6 +72,12 @@ ROX_INTERNAL const CustomPropertyType *custom_property_get_type(CustomProperty *
  */
 ROX_INTERNAL RoxDynamicValue *custom_property_get_value(CustomProperty *property, RoxContext *context);
 
+/**
+ * @param property Not <code>NULL</code>.
+ * @return Whether the value is computed by a callback, rather than set upfront.
+ */
+ROX_INTERNAL bool custom_property_is_computed(CustomProperty *property);
+
 /**
  * @param property Not <code>NULL</code>.
  * @return Not <code>NULL</code>. Must be freed after use.
@@ -115,6 +122,13 @@ ROX_INTERNAL void dynamic_properties_set_rule(
         void *target,
         rox_dynamic_properties_rule rule);
 
+/**
+ * @param properties Not <code>NULL</code>.
+ * @return Whether the properties are looked up by a rule set with <code>dynamic_properties_set_rule()</code>,
+ * rather than read from the context.
+ */
+ROX_INTERNAL bool dynamic_properties_has_custom_rule(DynamicProperties *properties);
+
 /**
  * @param properties Not <code>NULL</code>.
  * @param prop_name Not <code>NULL</code>.
@@ -126,4 +140,18 @@ ROX_INTERNAL RoxDynamicValue *dynamic_properties_invoke(
         const char *prop_name,
         RoxContext *context);
 
+/**
+ * Same as <code>dynamic_properties_invoke()</code>. Unless a custom rule is set,
+ * the context is looked up without hashing the name.
+ *
+ * @param properties Not <code>NULL</code>.
+ * @param symbol Not <code>NULL</code>.
+ * @param context May be <code>NULL</code>.
+ * @return May be <code>NULL</code>.
+ */
+ROX_INTERNAL RoxDynamicValue *dynamic_properties_invoke_symbol(
+        DynamicProperties *properties,
+        const RoxSymbol *symbol,
+        RoxContext *context);
+
 void dynamic_properties_free(DynamicProperties *properties);
\ No newline at end of file
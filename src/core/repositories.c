@@ -1,8 +1,10 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "util.h"
 #include "repositories.h"
 #include "collections.h"
+#include "epoch.h"
 
 //
 // CustomPropertyRepository
@@ -61,6 +63,15 @@ ROX_INTERNAL CustomProperty *custom_property_repository_get_custom_property(
     return (rox_map_get(repository->custom_properties, (void *) property_name, &ptr)) ? ptr : NULL;
 }
 
+ROX_INTERNAL CustomProperty *custom_property_repository_get_custom_property_by_symbol(
+        CustomPropertyRepository *repository,
+        const RoxSymbol *symbol) {
+    assert(repository);
+    assert(symbol);
+    void *ptr;
+    return rox_map_get_hashed(repository->custom_properties, symbol->name, symbol->hash, &ptr) ? ptr : NULL;
+}
+
 ROX_INTERNAL RoxMap *custom_property_repository_get_all_custom_properties(CustomPropertyRepository *repository) {
     assert(repository);
     return repository->custom_properties;
@@ -83,18 +94,254 @@ void custom_property_repository_free(CustomPropertyRepository *repository) {
     free(repository);
 }
 
+//
+// ConfigurationSnapshot
+//
+
+// experiments with their indexes, shared by the snapshots until the experiments change
+typedef struct ExperimentSet {
+    // number of the snapshots containing it, changed atomically
+    int ref_count;
+    RoxList *experiments;
+    // flag name to the first ExperimentModel* using it, keys are owned by the experiments
+    RoxMap *experiments_by_flag;
+    // id to the first ExperimentModel* having it, keys are owned by the experiments
+    RoxMap *experiments_by_id;
+} ExperimentSet;
+
+// target groups with their index, shared by the snapshots until the target groups change
+typedef struct TargetGroupSet {
+    // number of the snapshots containing it, changed atomically
+    int ref_count;
+    RoxList *target_groups;
+    // id to the first TargetGroupModel* having it, keys are owned by the target groups
+    RoxMap *target_groups_by_id;
+} TargetGroupSet;
+
+static ExperimentSet *experiment_set_create(RoxList *experiments) {
+    assert(experiments);
+    ExperimentSet *set = calloc(1, sizeof(ExperimentSet));
+    set->experiments = experiments;
+    set->experiments_by_flag = rox_map_create();
+    set->experiments_by_id = rox_map_create();
+    ROX_LIST_FOREACH(item, experiments, {
+        ExperimentModel *model = (ExperimentModel *) item;
+        if (model->id && !rox_map_contains_key(set->experiments_by_id, model->id)) {
+            rox_map_add(set->experiments_by_id, model->id, model);
+        }
+        if (model->flags) {
+            RoxListIter flag_iter;
+            rox_list_iter_init(&flag_iter, model->flags);
+            char *flag_name;
+            while (rox_list_iter_next(&flag_iter, (void **) &flag_name)) {
+                if (!rox_map_contains_key(set->experiments_by_flag, flag_name)) {
+                    rox_map_add(set->experiments_by_flag, flag_name, model);
+                }
+            }
+        }
+    })
+    return set;
+}
+
+static ExperimentSet *experiment_set_retain(ExperimentSet *set) {
+    assert(set);
+    __atomic_add_fetch(&set->ref_count, 1, __ATOMIC_SEQ_CST);
+    return set;
+}
+
+static void experiment_set_release(ExperimentSet *set) {
+    assert(set);
+    if (__atomic_sub_fetch(&set->ref_count, 1, __ATOMIC_SEQ_CST) > 0) {
+        return;
+    }
+    rox_map_free(set->experiments_by_flag);
+    rox_map_free(set->experiments_by_id);
+    rox_list_free_cb(set->experiments, (void (*)(void *)) &experiment_model_free);
+    free(set);
+}
+
+static TargetGroupSet *target_group_set_create(RoxList *target_groups) {
+    assert(target_groups);
+    TargetGroupSet *set = calloc(1, sizeof(TargetGroupSet));
+    set->target_groups = target_groups;
+    set->target_groups_by_id = rox_map_create();
+    ROX_LIST_FOREACH(item, target_groups, {
+        TargetGroupModel *model = (TargetGroupModel *) item;
+        if (model->id && !rox_map_contains_key(set->target_groups_by_id, model->id)) {
+            rox_map_add(set->target_groups_by_id, model->id, model);
+        }
+    })
+    return set;
+}
+
+static TargetGroupSet *target_group_set_retain(TargetGroupSet *set) {
+    assert(set);
+    __atomic_add_fetch(&set->ref_count, 1, __ATOMIC_SEQ_CST);
+    return set;
+}
+
+static void target_group_set_release(TargetGroupSet *set) {
+    assert(set);
+    if (__atomic_sub_fetch(&set->ref_count, 1, __ATOMIC_SEQ_CST) > 0) {
+        return;
+    }
+    rox_map_free(set->target_groups_by_id);
+    rox_list_free_cb(set->target_groups, (void (*)(void *)) &target_group_model_free);
+    free(set);
+}
+
+struct ConfigurationSnapshot {
+    long version;
+    ExperimentSet *experiments;
+    TargetGroupSet *target_groups;
+};
+
+/**
+ * @param experiments Not <code>NULL</code>. Retained by the snapshot.
+ * @param target_groups Not <code>NULL</code>. Retained by the snapshot.
+ */
+static ConfigurationSnapshot *configuration_snapshot_create(
+        long version,
+        ExperimentSet *experiments,
+        TargetGroupSet *target_groups) {
+    assert(experiments);
+    assert(target_groups);
+    ConfigurationSnapshot *snapshot = calloc(1, sizeof(ConfigurationSnapshot));
+    snapshot->version = version;
+    snapshot->experiments = experiment_set_retain(experiments);
+    snapshot->target_groups = target_group_set_retain(target_groups);
+    return snapshot;
+}
+
+static void configuration_snapshot_free(ConfigurationSnapshot *snapshot) {
+    assert(snapshot);
+    experiment_set_release(snapshot->experiments);
+    target_group_set_release(snapshot->target_groups);
+    free(snapshot);
+}
+
+ROX_INTERNAL long configuration_snapshot_get_version(ConfigurationSnapshot *snapshot) {
+    assert(snapshot);
+    return snapshot->version;
+}
+
+ROX_INTERNAL RoxList *configuration_snapshot_get_experiments(ConfigurationSnapshot *snapshot) {
+    assert(snapshot);
+    return snapshot->experiments->experiments;
+}
+
+ROX_INTERNAL RoxList *configuration_snapshot_get_target_groups(ConfigurationSnapshot *snapshot) {
+    assert(snapshot);
+    return snapshot->target_groups->target_groups;
+}
+
+ROX_INTERNAL ExperimentModel *configuration_snapshot_get_experiment_by_flag(
+        ConfigurationSnapshot *snapshot,
+        const char *flag_name) {
+    assert(snapshot);
+    assert(flag_name);
+    ExperimentModel *model;
+    if (rox_map_get(snapshot->experiments->experiments_by_flag, (void *) flag_name, (void **) &model)) {
+        return model;
+    }
+    return NULL;
+}
+
+ROX_INTERNAL ExperimentModel *configuration_snapshot_get_experiment(
+        ConfigurationSnapshot *snapshot,
+        const char *id) {
+    assert(snapshot);
+    assert(id);
+    ExperimentModel *model;
+    if (rox_map_get(snapshot->experiments->experiments_by_id, (void *) id, (void **) &model)) {
+        return model;
+    }
+    return NULL;
+}
+
+ROX_INTERNAL TargetGroupModel *configuration_snapshot_get_target_group(
+        ConfigurationSnapshot *snapshot,
+        const char *id) {
+    assert(snapshot);
+    assert(id);
+    TargetGroupModel *model;
+    if (rox_map_get(snapshot->target_groups->target_groups_by_id, (void *) id, (void **) &model)) {
+        return model;
+    }
+    return NULL;
+}
+
+//
+// ConfigurationRepository
+//
+
+struct ConfigurationRepository {
+    // replaced as a whole, never modified after being published
+    ConfigurationSnapshot *snapshot;
+    // serializes the updates
+    pthread_mutex_t lock;
+};
+
+ROX_INTERNAL ConfigurationRepository *configuration_repository_create() {
+    ConfigurationRepository *repository = calloc(1, sizeof(ConfigurationRepository));
+    repository->snapshot = configuration_snapshot_create(
+            0, experiment_set_create(rox_list_create()), target_group_set_create(rox_list_create()));
+    repository->lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+    return repository;
+}
+
+ROX_INTERNAL void configuration_repository_set_configuration(
+        ConfigurationRepository *repository,
+        RoxList *experiments,
+        RoxList *target_groups) {
+    assert(repository);
+    assert(experiments || target_groups);
+    pthread_mutex_lock(&repository->lock);
+    ConfigurationSnapshot *previous = repository->snapshot;
+    // the unchanged part is shared with the previous snapshot, together with its index
+    ConfigurationSnapshot *snapshot = configuration_snapshot_create(
+            previous->version + 1,
+            experiments ? experiment_set_create(experiments) : previous->experiments,
+            target_groups ? target_group_set_create(target_groups) : previous->target_groups);
+    epoch_publish((void **) &repository->snapshot, snapshot);
+    // the evaluations that are still running keep the previous snapshot alive
+    epoch_retire(previous, (epoch_free_func) &configuration_snapshot_free);
+    pthread_mutex_unlock(&repository->lock);
+}
+
+ROX_INTERNAL ConfigurationSnapshot *configuration_repository_get_snapshot(ConfigurationRepository *repository) {
+    assert(repository);
+    return epoch_load((void **) &repository->snapshot);
+}
+
+ROX_INTERNAL void configuration_repository_free(ConfigurationRepository *repository) {
+    assert(repository);
+    configuration_snapshot_free(repository->snapshot);
+    pthread_mutex_destroy(&repository->lock);
+    free(repository);
+}
+
 //
 // ExperimentRepository
 //
 
 struct ExperimentRepository {
-    RoxList *experiments;
-    RoxList *previous_experiments;
+    ConfigurationRepository *configuration;
+    bool owns_configuration;
 };
 
 ROX_INTERNAL ExperimentRepository *experiment_repository_create() {
+    ExperimentRepository *repository = experiment_repository_create_with_configuration(
+            configuration_repository_create());
+    repository->owns_configuration = true;
+    return repository;
+}
+
+ROX_INTERNAL ExperimentRepository *experiment_repository_create_with_configuration(
+        ConfigurationRepository *configuration) {
+    assert(configuration);
     ExperimentRepository *repository = calloc(1, sizeof(ExperimentRepository));
-    repository->experiments = rox_list_create();
+    repository->configuration = configuration;
     return repository;
 }
 
@@ -103,12 +350,7 @@ ROX_INTERNAL void experiment_repository_set_experiments(
         RoxList *experiments) {
     assert(repository);
     assert(experiments);
-    // Don't free experiments immediately since they still could be referenced in other threads during the configuration fetch
-    if (repository->previous_experiments) {
-        rox_list_free_cb(repository->previous_experiments, (void (*)(void *)) &experiment_model_free);
-    }
-    repository->previous_experiments = repository->experiments;
-    repository->experiments = experiments;
+    configuration_repository_set_configuration(repository->configuration, experiments, NULL);
 }
 
 ROX_INTERNAL ExperimentModel *experiment_repository_get_experiment_by_flag(
@@ -116,27 +358,25 @@ ROX_INTERNAL ExperimentModel *experiment_repository_get_experiment_by_flag(
         const char *flag_name) {
     assert(repository);
     assert(flag_name);
-    ROX_LIST_FOREACH(item, repository->experiments, {
-        ExperimentModel *model = (ExperimentModel *) item;
-        RoxList *flags = model->flags;
-        if (flags && str_in_list(flag_name, flags)) {
-            ROX_LIST_FOREACH_RETURN_VALUE(model);
-        }
-    })
-    return NULL;
+    return configuration_snapshot_get_experiment_by_flag(
+            configuration_repository_get_snapshot(repository->configuration), flag_name);
+}
+
+ROX_INTERNAL ConfigurationSnapshot *experiment_repository_get_snapshot(ExperimentRepository *repository) {
+    assert(repository);
+    return configuration_repository_get_snapshot(repository->configuration);
 }
 
 ROX_INTERNAL RoxList *experiment_repository_get_all_experiments(ExperimentRepository *repository) {
     assert(repository);
-    return repository->experiments;
+    return configuration_snapshot_get_experiments(configuration_repository_get_snapshot(repository->configuration));
 }
 
 ROX_INTERNAL void experiment_repository_free(ExperimentRepository *repository) {
     assert(repository);
-    if (repository->previous_experiments) {
-        rox_list_free_cb(repository->previous_experiments, (void (*)(void *)) &experiment_model_free);
+    if (repository->owns_configuration) {
+        configuration_repository_free(repository->configuration);
     }
-    rox_list_free_cb(repository->experiments, (void (*)(void *)) &experiment_model_free);
     free(repository);
 }
 
@@ -234,13 +474,22 @@ ROX_INTERNAL void flag_repository_free(FlagRepository *repository) {
 //
 
 struct TargetGroupRepository {
-    RoxList *target_groups;
-    RoxList *previous_target_groups;
+    ConfigurationRepository *configuration;
+    bool owns_configuration;
 };
 
 ROX_INTERNAL TargetGroupRepository *target_group_repository_create() {
+    TargetGroupRepository *repository = target_group_repository_create_with_configuration(
+            configuration_repository_create());
+    repository->owns_configuration = true;
+    return repository;
+}
+
+ROX_INTERNAL TargetGroupRepository *target_group_repository_create_with_configuration(
+        ConfigurationRepository *configuration) {
+    assert(configuration);
     TargetGroupRepository *repository = calloc(1, sizeof(TargetGroupRepository));
-    repository->target_groups = rox_list_create();
+    repository->configuration = configuration;
     return repository;
 }
 
@@ -249,12 +498,7 @@ ROX_INTERNAL void target_group_repository_set_target_groups(
         RoxList *target_groups) {
     assert(repository);
     assert(target_groups);
-    // Don't free target groups immediately since they still could be referenced in other threads during the configuration fetch
-    if (repository->previous_target_groups) {
-        rox_list_free_cb(repository->previous_target_groups, (void (*)(void *)) &target_group_model_free);
-    }
-    repository->previous_target_groups = repository->target_groups;
-    repository->target_groups = target_groups;
+    configuration_repository_set_configuration(repository->configuration, NULL, target_groups);
 }
 
 ROX_INTERNAL TargetGroupModel *target_group_repository_get_target_group(
@@ -262,22 +506,14 @@ ROX_INTERNAL TargetGroupModel *target_group_repository_get_target_group(
         const char *id) {
     assert(repository);
     assert(id);
-    TargetGroupModel *model = NULL;
-    ROX_LIST_FOREACH(item, repository->target_groups, {
-        TargetGroupModel *m = (TargetGroupModel *) item;
-        if (str_equals(m->id, id)) {
-            model = m;
-            break;
-        }
-    })
-    return model;
+    return configuration_snapshot_get_target_group(
+            configuration_repository_get_snapshot(repository->configuration), id);
 }
 
 ROX_INTERNAL void target_group_repository_free(TargetGroupRepository *repository) {
     assert(repository);
-    if (repository->previous_target_groups) {
-        rox_list_free_cb(repository->previous_target_groups, (void (*)(void *)) &target_group_model_free);
+    if (repository->owns_configuration) {
+        configuration_repository_free(repository->configuration);
     }
-    rox_list_free_cb(repository->target_groups, (void (*)(void *)) &target_group_model_free);
     free(repository);
 }
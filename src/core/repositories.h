@@ -3,6 +3,7 @@
 #include "configuration/models.h"
 #include "properties.h"
 #include "entities.h"
+#include "symbols.h"
 
 //
 // CustomPropertyRepository
@@ -46,6 +47,16 @@ ROX_INTERNAL CustomProperty *custom_property_repository_get_custom_property(
         CustomPropertyRepository *repository,
         const char *property_name);
 
+/**
+ * Same as <code>custom_property_repository_get_custom_property()</code>, without hashing the name.
+ *
+ * @param repository Not <code>NULL</code>.
+ * @param symbol Not <code>NULL</code>.
+ */
+ROX_INTERNAL CustomProperty *custom_property_repository_get_custom_property_by_symbol(
+        CustomPropertyRepository *repository,
+        const RoxSymbol *symbol);
+
 /**
  * The returned object is maintained by the repository, you must not call <code>rox_map_destroy</code> on it.
  * @param repository Not <code>NULL</code>.
@@ -69,6 +80,98 @@ ROX_INTERNAL void custom_property_repository_set_handler(
  */
 void custom_property_repository_free(CustomPropertyRepository *repository);
 
+//
+// ConfigurationRepository
+//
+
+/**
+ * Immutable set of experiments and target groups applied together. Evaluations read a snapshot
+ * without taking any lock, see <code>core/epoch.h</code>.
+ */
+typedef struct ConfigurationSnapshot ConfigurationSnapshot;
+
+/**
+ * @param snapshot Not <code>NULL</code>.
+ * @return Number of the configurations applied before this one.
+ */
+ROX_INTERNAL long configuration_snapshot_get_version(ConfigurationSnapshot *snapshot);
+
+/**
+ * @param snapshot Not <code>NULL</code>.
+ * @return List of <code>ExperimentModel *</code>. Maintained by the snapshot.
+ */
+ROX_INTERNAL RoxList *configuration_snapshot_get_experiments(ConfigurationSnapshot *snapshot);
+
+/**
+ * @param snapshot Not <code>NULL</code>.
+ * @return List of <code>TargetGroupModel *</code>. Maintained by the snapshot.
+ */
+ROX_INTERNAL RoxList *configuration_snapshot_get_target_groups(ConfigurationSnapshot *snapshot);
+
+/**
+ * @param snapshot Not <code>NULL</code>.
+ * @param flag_name Not <code>NULL</code>.
+ * @return First experiment using the given flag or <code>NULL</code> if not found.
+ */
+ROX_INTERNAL ExperimentModel *configuration_snapshot_get_experiment_by_flag(
+        ConfigurationSnapshot *snapshot,
+        const char *flag_name);
+
+/**
+ * @param snapshot Not <code>NULL</code>.
+ * @param id Not <code>NULL</code>.
+ * @return First experiment with the given id or <code>NULL</code> if not found.
+ */
+ROX_INTERNAL ExperimentModel *configuration_snapshot_get_experiment(
+        ConfigurationSnapshot *snapshot,
+        const char *id);
+
+/**
+ * @param snapshot Not <code>NULL</code>.
+ * @param id Not <code>NULL</code>.
+ * @return Target group model or <code>NULL</code> if not found.
+ */
+ROX_INTERNAL TargetGroupModel *configuration_snapshot_get_target_group(
+        ConfigurationSnapshot *snapshot,
+        const char *id);
+
+typedef struct ConfigurationRepository ConfigurationRepository;
+
+/**
+ * The returned object must be freed after use by calling <code>configuration_repository_free()</code>.
+ * @return Not <code>NULL</code>.
+ */
+ROX_INTERNAL ConfigurationRepository *configuration_repository_create();
+
+/**
+ * Publishes a new snapshot made of the given lists. The replaced snapshot is freed once the evaluations
+ * that may still be reading it are finished.
+ *
+ * @param repository Not <code>NULL</code>.
+ * @param experiments List of <code>ExperimentModel *</code>. May be <code>NULL</code>, in which case
+ * the current experiments are shared with the new snapshot. The ownership is delegated to repository.
+ * @param target_groups List of <code>TargetGroupModel *</code>. May be <code>NULL</code>, in which case
+ * the current target groups are shared with the new snapshot. The ownership is delegated to repository.
+ */
+ROX_INTERNAL void configuration_repository_set_configuration(
+        ConfigurationRepository *repository,
+        RoxList *experiments,
+        RoxList *target_groups);
+
+/**
+ * The returned snapshot stays valid until the end of the current read section,
+ * or until the next update when called outside of it.
+ *
+ * @param repository Not <code>NULL</code>.
+ * @return Not <code>NULL</code>.
+ */
+ROX_INTERNAL ConfigurationSnapshot *configuration_repository_get_snapshot(ConfigurationRepository *repository);
+
+/**
+ * @param repository Not <code>NULL</code>.
+ */
+ROX_INTERNAL void configuration_repository_free(ConfigurationRepository *repository);
+
 //
 // ExperimentRepository
 //
@@ -80,6 +183,15 @@ typedef struct ExperimentRepository ExperimentRepository;
  */
 ROX_INTERNAL ExperimentRepository *experiment_repository_create();
 
+/**
+ * Same as <code>experiment_repository_create()</code>, but the experiments are stored in
+ * the given <code>configuration</code>, so that they can be swapped along with the target groups.
+ *
+ * @param configuration Not <code>NULL</code>. Must outlive the returned repository.
+ */
+ROX_INTERNAL ExperimentRepository *experiment_repository_create_with_configuration(
+        ConfigurationRepository *configuration);
+
 /**
  * @param repository Not <code>NULL</code>.
  * @param experiments List of <code>ExperimentModel *</code>. Not <code>NULL</code>. The ownership is delegated to repository.
@@ -91,14 +203,23 @@ ROX_INTERNAL void experiment_repository_set_experiments(
 /**
  * @param repository Not <code>NULL</code>.
  * @param flag_name Not <code>NULL</code>.
- * @return RoxExperiment model or NULL if not found.
+ * @return First experiment using the given flag or NULL if not found.
  */
 ROX_INTERNAL ExperimentModel *experiment_repository_get_experiment_by_flag(
         ExperimentRepository *repository,
         const char *flag_name);
 
+/**
+ * The returned snapshot stays valid until the end of the current read section, or until the next update
+ * when called outside of it.
+ * @param repository Not <code>NULL</code>.
+ * @return Not <code>NULL</code>.
+ */
+ROX_INTERNAL ConfigurationSnapshot *experiment_repository_get_snapshot(ExperimentRepository *repository);
+
 /**
  * The returned object is maintained by the repository, you must not call <code>list_destroy</code> on it.
+ * It stays valid until the end of the current read section, or until the next update when called outside of it.
  * @param repository Not <code>NULL</code>.
  * @return List of <code>ExperimentModel *</code>
  */
@@ -185,6 +306,15 @@ typedef struct TargetGroupRepository TargetGroupRepository;
  */
 ROX_INTERNAL TargetGroupRepository *target_group_repository_create();
 
+/**
+ * Same as <code>target_group_repository_create()</code>, but the target groups are stored in
+ * the given <code>configuration</code>, so that they can be swapped along with the experiments.
+ *
+ * @param configuration Not <code>NULL</code>. Must outlive the returned repository.
+ */
+ROX_INTERNAL TargetGroupRepository *target_group_repository_create_with_configuration(
+        ConfigurationRepository *configuration);
+
 /**
  * By calling this method the ownership of the given <code>target_groups</code>
  * list is delegated to the given <code>repository</code>.
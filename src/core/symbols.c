@@ -0,0 +1,41 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "symbols.h"
+#include "collections.h"
+#include "util.h"
+
+static struct {
+    // name to RoxSymbol*, the keys are the names of the symbols
+    RoxMap *symbols;
+    int count;
+} symbol_table;
+
+static pthread_mutex_t symbol_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+ROX_INTERNAL const RoxSymbol *symbol_intern(const char *name) {
+    assert(name);
+    pthread_mutex_lock(&symbol_table_lock);
+    if (!symbol_table.symbols) {
+        symbol_table.symbols = rox_map_create();
+    }
+    RoxSymbol *symbol;
+    size_t hash = rox_map_hash_key(name);
+    if (!rox_map_get_hashed(symbol_table.symbols, name, hash, (void **) &symbol)) {
+        symbol = malloc(sizeof(RoxSymbol));
+        symbol->id = symbol_table.count++;
+        symbol->hash = hash;
+        symbol->name = mem_copy_str(name);
+        rox_map_add(symbol_table.symbols, (void *) symbol->name, symbol);
+    }
+    pthread_mutex_unlock(&symbol_table_lock);
+    return symbol;
+}
+
+ROX_INTERNAL int symbol_count() {
+    pthread_mutex_lock(&symbol_table_lock);
+    int count = symbol_table.count;
+    pthread_mutex_unlock(&symbol_table_lock);
+    return count;
+}
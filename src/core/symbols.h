@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include "rox/defs.h"
+
+//
+// Interned symbols.
+//
+// Names looked up on every evaluation (property names in the compiled conditions) are interned once
+// into a process-wide table. A symbol keeps the name together with its id, dense from 0, and its hash,
+// so the lookups by symbol don't hash the name again. Symbols are immutable and never freed, so they can
+// be used from any thread without synchronization.
+//
+
+typedef struct RoxSymbol {
+    int id;
+    // same as rox_map_hash_key(name)
+    size_t hash;
+    const char *name;
+} RoxSymbol;
+
+/**
+ * @param name Not <code>NULL</code>. Copied internally.
+ * @return Not <code>NULL</code>. The same symbol for the equal names.
+ */
+ROX_INTERNAL const RoxSymbol *symbol_intern(const char *name);
+
+/**
+ * @return Number of symbols interned so far, i.e. the upper bound of their ids.
+ */
+ROX_INTERNAL int symbol_count();
@@ -30,62 +30,84 @@ ROX_INTERNAL double experiment_extensions_get_bucket(const char *seed) {
 }
 
 static void
-parser_operator_merge_seed(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+parser_operator_merge_seed(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    char *seed1 = rox_stack_get_string(item1);
-    char *seed2 = rox_stack_get_string(item2);
-    char *merged = mem_str_format("%s.%s", seed1, seed2);
-    rox_stack_push_string_ptr(stack, merged);
+    VmValue seed1 = vm_stack_pop(stack);
+    VmValue seed2 = vm_stack_pop(stack);
+    if (seed1.type == VmValueTypeString && seed2.type == VmValueTypeString) {
+        char *merged = mem_str_format("%s.%s", seed1.data.str_value, seed2.data.str_value);
+        vm_stack_push(stack, vm_value_string_ptr(merged));
+    } else {
+        vm_stack_push(stack, vm_value_undefined());
+    }
+    vm_value_release(&seed1);
+    vm_value_release(&seed2);
 }
 
 static void
-parser_operator_is_in_percentage(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+parser_operator_is_in_percentage(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    double percentage = rox_stack_get_number(item1);
-    char *seed = rox_stack_get_string(item2);
-    double bucket = experiment_extensions_get_bucket(seed);
-    bool is_in_percentage = bucket <= percentage;
-    rox_stack_push_boolean(stack, is_in_percentage);
+    VmValue percentage = vm_stack_pop(stack);
+    VmValue seed = vm_stack_pop(stack);
+    bool is_in_percentage = false;
+    if (vm_value_is_numeric(&percentage) && seed.type == VmValueTypeString) {
+        double bucket = experiment_extensions_get_bucket(seed.data.str_value);
+        is_in_percentage = bucket <= vm_value_get_number(&percentage);
+    }
+    vm_value_release(&percentage);
+    vm_value_release(&seed);
+    vm_stack_push(stack, vm_value_boolean(is_in_percentage));
 }
 
-static void parser_operator_is_in_percentage_range(void *target, Parser *parser, CoreStack *stack,
+static void parser_operator_is_in_percentage_range(void *target, Parser *parser, VmStack *stack,
                                                    EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    StackItem *item3 = rox_stack_pop(stack);
-    double percentage_low = rox_stack_get_number(item1);
-    double percentage_high = rox_stack_get_number(item2);
-    char *seed = rox_stack_get_string(item3);
-    double bucket = experiment_extensions_get_bucket(seed);
-    bool is_in_percentage = bucket >= percentage_low && bucket < percentage_high;
-    rox_stack_push_boolean(stack, is_in_percentage);
+    VmValue percentage_low = vm_stack_pop(stack);
+    VmValue percentage_high = vm_stack_pop(stack);
+    VmValue seed = vm_stack_pop(stack);
+    bool is_in_percentage = false;
+    if (vm_value_is_numeric(&percentage_low) &&
+        vm_value_is_numeric(&percentage_high) &&
+        seed.type == VmValueTypeString) {
+        double bucket = experiment_extensions_get_bucket(seed.data.str_value);
+        is_in_percentage = bucket >= vm_value_get_number(&percentage_low) &&
+                           bucket < vm_value_get_number(&percentage_high);
+    }
+    vm_value_release(&percentage_low);
+    vm_value_release(&percentage_high);
+    vm_value_release(&seed);
+    vm_stack_push(stack, vm_value_boolean(is_in_percentage));
 }
 
 static void parser_operator_flag_value(
         void *target,
         Parser *parser,
-        CoreStack *stack,
+        VmStack *stack,
         EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
     ExperimentExtensionsContext *extensions = (ExperimentExtensionsContext *) target;
-    StackItem *item = rox_stack_pop(stack);
-    char *feature_flag_identifier = rox_stack_get_string(item);
+    VmValue item = vm_stack_pop(stack);
+    const RoxSymbol *symbol = eval_context && item.type == VmValueTypeString ? item.symbol : NULL;
+    RoxDynamicValue *memoized;
+    if (symbol && eval_context_memo_get(eval_context, EvaluationMemoFlagValue, symbol, &memoized)) {
+        vm_value_release(&item);
+        vm_stack_push(stack, memoized ? vm_value_from_dynamic_value(memoized) : vm_value_null());
+        return;
+    }
+    const char *feature_flag_identifier = item.type == VmValueTypeString ? item.data.str_value : NULL;
     bool value_set = false;
     char *result = NULL;
-    RoxStringBase *variant = flag_repository_get_flag(extensions->flags_repository, feature_flag_identifier);
+    RoxStringBase *variant = feature_flag_identifier
+                             ? flag_repository_get_flag(extensions->flags_repository, feature_flag_identifier)
+                             : NULL;
     if (variant) {
         result = variant_get_string(variant, NULL, eval_context);
         value_set = true;
-    } else {
+    } else if (feature_flag_identifier) {
         ExperimentModel *flags_experiment = experiment_repository_get_experiment_by_flag(
                 extensions->experiment_repository, feature_flag_identifier);
         if (flags_experiment && !str_is_empty(flags_experiment->condition)) {
@@ -99,29 +121,50 @@ static void parser_operator_flag_value(
             result_free(evaluation_result);
         }
     }
+    vm_value_release(&item);
     if (!result && !value_set) {
         result = mem_copy_str(FLAG_FALSE_VALUE);
     }
-    rox_stack_push_string_ptr(stack, result);
+    if (symbol) {
+        RoxDynamicValue *value = result ? rox_dynamic_value_create_string_ptr(result) : NULL;
+        vm_stack_push(stack, value ? vm_value_from_dynamic_value(value) : vm_value_null());
+        eval_context_memo_put(eval_context, EvaluationMemoFlagValue, symbol, value);
+        return;
+    }
+    vm_stack_push(stack, result ? vm_value_string_ptr(result) : vm_value_null());
 }
 
 static void
-parser_operator_is_in_target_group(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+parser_operator_is_in_target_group(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
     ExperimentExtensionsContext *extensions = (ExperimentExtensionsContext *) target;
-    StackItem *item = rox_stack_pop(stack);
-    char *target_group_identifier = rox_stack_get_string(item);
-    TargetGroupModel *target_group = target_group_repository_get_target_group(
-            extensions->target_groups_repository, target_group_identifier);
+    VmValue item = vm_stack_pop(stack);
+    const RoxSymbol *symbol = eval_context && item.type == VmValueTypeString ? item.symbol : NULL;
+    RoxDynamicValue *memoized;
+    if (symbol && eval_context_memo_get(eval_context, EvaluationMemoTargetGroup, symbol, &memoized)) {
+        vm_value_release(&item);
+        vm_stack_push(stack, vm_value_boolean(rox_dynamic_value_get_boolean(memoized)));
+        return;
+    }
+    TargetGroupModel *target_group = item.type == VmValueTypeString
+                                     ? target_group_repository_get_target_group(
+                    extensions->target_groups_repository, item.data.str_value)
+                                     : NULL;
+    vm_value_release(&item);
     if (!target_group) {
-        rox_stack_push_boolean(stack, false);
+        vm_stack_push(stack, vm_value_boolean(false));
         return;
     }
-    EvaluationResult *result = parser_evaluate_expression(parser, target_group->condition, eval_context);
-    bool *bool_result = result_get_boolean(result);
-    rox_stack_push_boolean(stack, bool_result ? *bool_result : false);
-    result_free(result);
+    VmValue result;
+    parser_evaluate_expression_value(parser, target_group->condition, eval_context, &result);
+    bool is_in_target_group = vm_value_is_true(&result);
+    vm_value_release(&result);
+    if (symbol) {
+        eval_context_memo_put(eval_context, EvaluationMemoTargetGroup, symbol,
+                              rox_dynamic_value_create_boolean(is_in_target_group));
+    }
+    vm_stack_push(stack, vm_value_boolean(is_in_target_group));
 }
 
 ROX_INTERNAL void parser_add_experiments_extensions(
@@ -142,11 +185,13 @@ ROX_INTERNAL void parser_add_experiments_extensions(
 
     // dispose this context when parser is destroyed
     parser_add_disposal_handler(parser, context, &parser_extensions_disposal_handler);
-    parser_add_operator(parser, "mergeSeed", context, &parser_operator_merge_seed);
-    parser_add_operator(parser, "isInPercentage", context, &parser_operator_is_in_percentage);
-    parser_add_operator(parser, "isInPercentageRange", context, &parser_operator_is_in_percentage_range);
-    parser_add_operator(parser, "flagValue", context, &parser_operator_flag_value);
-    parser_add_operator(parser, "isInTargetGroup", context, &parser_operator_is_in_target_group);
+    parser_add_native_operator(parser, "mergeSeed", 2, context, &parser_operator_merge_seed);
+    parser_add_native_operator(parser, "isInPercentage", 2, context, &parser_operator_is_in_percentage);
+    parser_add_native_operator(parser, "isInPercentageRange", 3, context, &parser_operator_is_in_percentage_range);
+    parser_add_native_operator(parser, "flagValue", 1, context, &parser_operator_flag_value);
+    parser_add_native_operator(parser, "isInTargetGroup", 1, context, &parser_operator_is_in_target_group);
+    parser_intern_operand(parser, "flagValue");
+    parser_intern_operand(parser, "isInTargetGroup");
 }
 
 typedef struct PropertiesExtensionsContext {
@@ -154,54 +199,69 @@ typedef struct PropertiesExtensionsContext {
     DynamicProperties *dynamic_properties;
 } PropertiesExtensionsContext;
 
-static void parser_operator_property(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_property(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
 
     PropertiesExtensionsContext *extensions = (PropertiesExtensionsContext *) target;
 
-    StackItem *item = rox_stack_pop(stack);
-    const char *prop_name = rox_stack_get_string(item);
+    VmValue item = vm_stack_pop(stack);
+    if (item.type != VmValueTypeString) {
+        vm_value_release(&item);
+        vm_stack_push(stack, vm_value_undefined());
+        return;
+    }
+    const RoxSymbol *symbol = eval_context ? item.symbol : NULL;
+    RoxDynamicValue *memoized;
+    if (symbol && eval_context_memo_get(eval_context, EvaluationMemoProperty, symbol, &memoized)) {
+        vm_value_release(&item);
+        vm_stack_push(stack, memoized ? vm_value_from_dynamic_value(memoized) : vm_value_undefined());
+        return;
+    }
+    const char *prop_name = item.data.str_value;
     RoxContext *context = eval_context ? eval_context_get_context(eval_context) : NULL;
-    CustomProperty *property = custom_property_repository_get_custom_property(
-            extensions->custom_property_repository, prop_name);
+    CustomProperty *property = item.symbol
+                               ? custom_property_repository_get_custom_property_by_symbol(
+                    extensions->custom_property_repository, item.symbol)
+                               : custom_property_repository_get_custom_property(
+                    extensions->custom_property_repository, prop_name);
 
+    // the values read from the context are cheap to look up again, unlike the computed ones
+    bool memoize = symbol && (property
+                              ? custom_property_is_computed(property)
+                              : dynamic_properties_has_custom_rule(extensions->dynamic_properties));
+    RoxDynamicValue *value = NULL;
     if (!property) {
-        RoxDynamicValue *value = dynamic_properties_invoke(extensions->dynamic_properties, prop_name, context);
-        if (value) {
-            if (rox_dynamic_value_is_string(value) ||
-                rox_dynamic_value_is_boolean(value) ||
-                rox_dynamic_value_is_double(value) ||
-                rox_dynamic_value_is_int(value)) {
-                if (rox_dynamic_value_is_int(value)) {
-                    rox_stack_push_int(stack, rox_dynamic_value_get_int(value));
-                    rox_dynamic_value_free(value);
-                } else if (rox_dynamic_value_is_double(value)) {
-                    rox_stack_push_double(stack, rox_dynamic_value_get_double(value));
-                    rox_dynamic_value_free(value);
-                } else {
-                    rox_stack_push_dynamic_value(stack, value);
-                }
-                return;
-            } else {
-                rox_dynamic_value_free(value);
-            }
+        value = item.symbol
+                ? dynamic_properties_invoke_symbol(extensions->dynamic_properties, item.symbol, context)
+                : dynamic_properties_invoke(extensions->dynamic_properties, prop_name, context);
+        if (value &&
+            !rox_dynamic_value_is_string(value) &&
+            !rox_dynamic_value_is_boolean(value) &&
+            !rox_dynamic_value_is_double(value) &&
+            !rox_dynamic_value_is_int(value)) {
+            rox_dynamic_value_free(value);
+            value = NULL;
         }
-        rox_stack_push_undefined(stack);
-        return;
-    }
-
-    RoxDynamicValue *value = custom_property_get_value(property, context);
-    if (value) {
-        if (rox_dynamic_value_is_null(value)) {
+    } else {
+        value = custom_property_get_value(property, context);
+        if (value && rox_dynamic_value_is_null(value)) {
             rox_dynamic_value_free(value);
-        } else {
-            rox_stack_push_dynamic_value(stack, value);
-            return;
+            value = NULL;
         }
     }
+    vm_value_release(&item);
 
-    rox_stack_push_undefined(stack);
+    if (value) {
+        vm_stack_push(stack, vm_value_from_dynamic_value(value));
+    } else {
+        vm_stack_push(stack, vm_value_undefined());
+    }
+    if (memoize) {
+        eval_context_memo_put(eval_context, EvaluationMemoProperty, symbol, value);
+    } else if (value) {
+        rox_dynamic_value_free(value);
+    }
 }
 
 ROX_INTERNAL void parser_add_properties_extensions(
@@ -219,5 +279,6 @@ ROX_INTERNAL void parser_add_properties_extensions(
 
     // dispose this context when parser is destroyed
     parser_add_disposal_handler(parser, context, &parser_extensions_disposal_handler);
-    parser_add_operator(parser, "property", context, &parser_operator_property);
+    parser_add_native_operator(parser, "property", 1, context, &parser_operator_property);
+    parser_intern_operand(parser, "property");
 }
@@ -5,14 +5,18 @@
 #include <float.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "rox/server.h"
 #include "util.h"
 #include "parser.h"
 #include "stack.h"
+#include "vm.h"
 #include "vendor/semver.h"
 #include "core/logging.h"
+#include "core/epoch.h"
 #include "collections.h"
+#include "values.h"
 
 //
 // Symbols
@@ -27,20 +31,120 @@ ROX_INTERNAL const char *ROXX_EMPTY_STRING = "\"\"";
 // TokenTypes
 //
 
+// The classification below replicates the patterns the tokens used to be matched against with PCRE2:
+//   string:    ^"((\\.)|[^\\\\"])*"$
+//   number:    ^[\-]{0,1}\d+[\.]\d+|[\-]{0,1}\d+$
+//   bool:      ^true|false$
+//   undefined: undefined
+// All of them are case insensitive. Note the alternatives of the number and bool patterns are anchored
+// on one side only, and "$" also matches right before a trailing newline.
+
+static bool token_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static char token_to_lower(char c) {
+    return (char) (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+static bool token_is_end(const char *token, size_t position, size_t length) {
+    return position == length || (position + 1 == length && token[position] == '\n');
+}
+
+static bool token_equals_ignore_case_at(const char *token, size_t position, const char *str, size_t str_length) {
+    for (size_t i = 0; i < str_length; ++i) {
+        if (token_to_lower(token[position + i]) != str[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool token_starts_with_ignore_case(const char *token, size_t length, const char *prefix) {
+    size_t prefix_length = strlen(prefix);
+    return length >= prefix_length && token_equals_ignore_case_at(token, 0, prefix, prefix_length);
+}
+
+static bool token_ends_with_ignore_case(const char *token, size_t length, const char *suffix) {
+    size_t suffix_length = strlen(suffix);
+    if (length > 0 && token[length - 1] == '\n' &&
+        length - 1 >= suffix_length &&
+        token_equals_ignore_case_at(token, length - 1 - suffix_length, suffix, suffix_length)) {
+        return true;
+    }
+    return length >= suffix_length && token_equals_ignore_case_at(token, length - suffix_length, suffix, suffix_length);
+}
+
+static bool token_contains_ignore_case(const char *token, size_t length, const char *str) {
+    size_t str_length = strlen(str);
+    for (size_t i = 0; i + str_length <= length; ++i) {
+        if (token_equals_ignore_case_at(token, i, str, str_length)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool token_is_string(const char *token, size_t length) {
+    if (length == 0 || token[0] != '"') {
+        return false;
+    }
+    size_t i = 1;
+    while (i < length) {
+        char c = token[i];
+        if (c == '\\') {
+            if (i + 1 >= length || token[i + 1] == '\n') {
+                return false;
+            }
+            i += 2;
+        } else if (c == '"') {
+            return token_is_end(token, i + 1, length);
+        } else {
+            ++i;
+        }
+    }
+    return false;
+}
+
+static bool token_is_number(const char *token, size_t length) {
+    size_t i = 0;
+    if (i < length && token[i] == '-') {
+        ++i;
+    }
+    size_t integer_start = i;
+    while (i < length && token_is_digit(token[i])) {
+        ++i;
+    }
+    if (i > integer_start && i < length && token[i] == '.' && i + 1 < length && token_is_digit(token[i + 1])) {
+        return true;
+    }
+    // the second alternative is anchored at the end only
+    if (length > 0 && token_is_digit(token[length - 1])) {
+        return true;
+    }
+    return length > 1 && token[length - 1] == '\n' && token_is_digit(token[length - 2]);
+}
+
+static bool token_is_bool(const char *token, size_t length) {
+    return token_starts_with_ignore_case(token, length, ROXX_TRUE) ||
+           token_ends_with_ignore_case(token, length, ROXX_FALSE);
+}
+
 ROX_INTERNAL ParserTokenType get_token_type_from_token(const char *token) {
     if (!token) {
         return TokenTypeNotAType;
     }
-    if (str_matches(token, "^\"((\\\\.)|[^\\\\\\\\\"])*\"$", PCRE2_CASELESS)) {
+    size_t length = strlen(token);
+    if (token_is_string(token, length)) {
         return TokenTypeString;
     }
-    if (str_matches(token, "^[\\-]{0,1}\\d+[\\.]\\d+|[\\-]{0,1}\\d+$", PCRE2_CASELESS)) {
+    if (token_is_number(token, length)) {
         return TokenTypeNumber;
     }
-    if (str_matches(token, "^true|false$", PCRE2_CASELESS)) {
+    if (token_is_bool(token, length)) {
         return TokenTypeBool;
     }
-    if (str_matches(token, ROXX_UNDEFINED, PCRE2_CASELESS)) {
+    if (token_contains_ignore_case(token, length, ROXX_UNDEFINED)) {
         return TokenTypeUndefined;
     }
     return TokenTypeNotAType;
@@ -61,50 +165,48 @@ struct EvaluationResult {
     bool is_undefined;
 };
 
-static EvaluationResult *create_result_from_stack_item(StackItem *item, RoxContext *context) {
+static EvaluationResult *create_result_from_value(const VmValue *value, RoxContext *context) {
     EvaluationResult *result = NULL;
 
-    if (!item || rox_stack_is_null(item)) {
+    if (!value || value->type == VmValueTypeNull) {
         result = result_create(context);
         result->is_null = true;
         return result;
     }
 
-    if (rox_stack_is_undefined(item)) {
+    if (value->type == VmValueTypeUndefined) {
         result = result_create(context);
         result->is_undefined = true;
         return result;
     }
 
-    if (rox_stack_is_boolean(item)) {
-        bool value = rox_stack_get_boolean(item);
+    if (value->type == VmValueTypeBoolean) {
+        bool boolean_value = value->data.boolean_value;
         result = result_create(context);
-        result->is_true = value;
-        result->is_false = !value;
-        result->str_value = mem_copy_str(value ? ROXX_TRUE : ROXX_FALSE);
+        result->is_true = boolean_value;
+        result->is_false = !boolean_value;
+        result->str_value = mem_copy_str(boolean_value ? ROXX_TRUE : ROXX_FALSE);
         return result;
     }
 
-    if (rox_stack_is_int(item)) {
-        int int_value = rox_stack_get_int(item);
+    if (value->type == VmValueTypeInt) {
         result = result_create(context);
-        result->int_value = mem_copy_int(int_value);
+        result->int_value = mem_copy_int(value->data.int_value);
         return result;
     }
 
-    if (rox_stack_is_double(item)) {
-        double double_value = rox_stack_get_double(item);
+    if (value->type == VmValueTypeDouble) {
         result = result_create(context);
-        result->double_value = mem_copy_double(double_value);
+        result->double_value = mem_copy_double(value->data.double_value);
         return result;
     }
 
-    if (rox_stack_is_string(item)) {
-        char *value = rox_stack_get_string(item);
+    if (value->type == VmValueTypeString) {
+        char *str_value = value->data.str_value;
         result = result_create(context);
-        result->int_value = mem_str_to_int(value);
-        result->double_value = mem_str_to_double(value);
-        result->str_value = mem_copy_str(value);
+        result->int_value = mem_str_to_int(str_value);
+        result->double_value = mem_str_to_double(str_value);
+        result->str_value = mem_copy_str(str_value);
         return result;
     }
 
@@ -174,6 +276,8 @@ ROX_INTERNAL void result_free(EvaluationResult *result) {
 struct ParserNode {
     NodeType type;
     RoxDynamicValue *value;
+    // number of enclosing parentheses
+    int depth;
 };
 
 ROX_INTERNAL NodeType node_get_type(ParserNode *node) {
@@ -204,19 +308,15 @@ static ParserNode *node_create_str_copy(NodeType type, const char *str) {
     return node_create_str_ptr(type, mem_copy_str(str));
 }
 
-static ParserNode *node_create_double_ptr(NodeType type, double *value) {
+static ParserNode *node_create_double(NodeType type, double value) {
     ParserNode *node = node_create_empty(type);
-    node->value = rox_dynamic_value_create_double_ptr(value);
+    node->value = rox_dynamic_value_create_double(value);
     return node;
 }
 
-static ParserNode *node_create_double(NodeType type, double value) {
-    return node_create_double_ptr(type, mem_copy_double(value));
-}
-
-static ParserNode *node_create_int_ptr(NodeType type, int *value) {
+static ParserNode *node_create_int(NodeType type, int value) {
     ParserNode *node = node_create_empty(type);
-    node->value = rox_dynamic_value_create_int_ptr(value);
+    node->value = rox_dynamic_value_create_int(value);
     return node;
 }
 
@@ -403,6 +503,8 @@ static const char *DICT_START_DELIMITER = "{";
 static const char *DICT_END_DELIMITER = "}";
 static const char *ARRAY_START_DELIMITER = "[";
 static const char *ARRAY_END_DELIMITER = "]";
+static const char *OPEN_PARENTHESIS_DELIMITER = "(";
+static const char *CLOSE_PARENTHESIS_DELIMITER = ")";
 static const char *TOKEN_DELIMITERS = "{}[]():, \t\r\n\"";
 static const char *PRE_POST_STRING_CHAR = "";
 static const char *STRING_DELIMITER = "\"";
@@ -413,6 +515,7 @@ typedef struct TokenizedExpression {
     RoxList *array_accumulator;
     RoxMap *dict_accumulator;
     char *dict_key;
+    int depth;
 } TokenizedExpression;
 
 static void tokenized_expression_free(TokenizedExpression *expr) {
@@ -445,16 +548,17 @@ static void tokenized_expression_push_node(TokenizedExpression *expr, ParserNode
         if (!rox_map_contains_key(expr->dict_accumulator, expr->dict_key)) {
             rox_map_add(expr->dict_accumulator,
                         expr->dict_key,
-                        rox_dynamic_value_create_copy(node->value));
+                        dynamic_value_retain(node->value));
         } else {
             free(expr->dict_key);
         }
         node_free(node);
         expr->dict_key = NULL;
     } else if (expr->array_accumulator) {
-        rox_list_add(expr->array_accumulator, rox_dynamic_value_create_copy(node->value));
+        rox_list_add(expr->array_accumulator, dynamic_value_retain(node->value));
         node_free(node);
     } else {
+        node->depth = expr->depth;
         rox_list_add(node_list, node);
     }
 }
@@ -478,11 +582,16 @@ static ParserNode *tokenized_expression_node_from_token(NodeType nodeType, const
     }
     if (token_type == TokenTypeNumber) {
         if (str_contains(token, '.')) {
-            double *value = mem_str_to_double(token);
-            return node_create_double_ptr(nodeType, value);
+            double value;
+            if (str_parse_double(token, &value)) {
+                return node_create_double(nodeType, value);
+            }
+        } else {
+            int value;
+            if (str_parse_int(token, &value)) {
+                return node_create_int(nodeType, value);
+            }
         }
-        int *value = mem_str_to_int(token);
-        return node_create_int_ptr(nodeType, value);
     }
     return node_create_null(NodeTypeUnknown);
 }
@@ -543,6 +652,10 @@ ROX_INTERNAL RoxList *tokenized_expression_get_tokens(const char *expression, Ro
                     expr,
                     node_create_list(NodeTypeRand, array_result), // NOTE: array_result must be freed in node_free
                     result_list);
+        } else if (!in_string && str_equals(token, OPEN_PARENTHESIS_DELIMITER)) {
+            ++expr->depth;
+        } else if (!in_string && str_equals(token, CLOSE_PARENTHESIS_DELIMITER)) {
+            --expr->depth;
         } else if (str_equals(token, STRING_DELIMITER)) {
             if (prev_token_len > 0 && str_equals(prev_token, STRING_DELIMITER)) {
                 tokenized_expression_push_node(
@@ -586,446 +699,812 @@ typedef struct ParserDisposalHandler {
     parser_disposal_handler handler;
 } ParserDisposalHandler;
 
+typedef struct ParserOperator {
+    int index;
+    // number of operands, or -1 when not known
+    int arity;
+    void *target;
+    parser_native_operation operation;
+    // set for the operators added with parser_add_operator()
+    void *stack_target;
+    parser_operation stack_operation;
+    // see parser_intern_operand()
+    bool interns_operand;
+} ParserOperator;
+
 struct Parser {
     RoxList *disposal_handlers;
     RoxMap *operators_map;
+    ParserOperator **operators;
+    int operators_count;
+    // published, looked up without the lock
+    RoxMap *compiled_expressions;
+    // compiled since the last publication, guarded by the lock
+    RoxMap *staged_compiled_expressions;
+    // number of the expressions compiled on demand since the last clear or set, guarded by the lock
+    size_t on_demand_compiled_expressions_count;
+    pthread_mutex_t compiled_expressions_lock;
 };
 
-typedef struct ParserOperator {
-    void *target;
-    parser_operation operation;
-} ParserOperator;
+static bool parser_str_to_double(const char *str, double *num) {
+    assert(str);
+    // same rules as mem_str_to_double(), minus the allocation
+    char *end;
+    double value = strtod(str, &end);
+    if ((value == 0 && str[0] != '0') || *end != '\0') {
+        return false;
+    }
+    *num = value;
+    return true;
+}
 
-static int parser_compare_stack_items(StackItem *item, StackItem *item2) {
-    assert(item);
-    assert(item2);
+static int parser_compare_values(const VmValue *value, const VmValue *value2) {
+    assert(value);
+    assert(value2);
 
-    // we return -1 in case when item types don't match,
+    // we return -1 in case when value types don't match,
     // 1 in case when values are of the same type but not equal,
     // and 0 in case when they are equal.
 
     int ret_value = -1;
-    if (rox_stack_is_null(item)) {
-        ret_value = rox_stack_is_null(item2) ? 0 : 1;
-    } else if (rox_stack_is_undefined(item)) {
-        ret_value = rox_stack_is_undefined(item2) ? 0 : 1;
-    } else if (rox_stack_is_numeric(item)) {
-        ret_value = rox_stack_is_numeric(item2)
-                    ? fabs(rox_stack_get_number(item) - rox_stack_get_number(item2)) < FLT_EPSILON
+    if (value->type == VmValueTypeNull) {
+        ret_value = value2->type == VmValueTypeNull ? 0 : 1;
+    } else if (value->type == VmValueTypeUndefined) {
+        ret_value = value2->type == VmValueTypeUndefined ? 0 : 1;
+    } else if (vm_value_is_numeric(value)) {
+        ret_value = vm_value_is_numeric(value2)
+                    ? fabs(vm_value_get_number(value) - vm_value_get_number(value2)) < FLT_EPSILON
                       ? 0 : 1
                     : -1;
-    } else if (rox_stack_is_boolean(item)) {
-        ret_value = rox_stack_is_boolean(item2)
-                    ? rox_stack_get_boolean(item) == rox_stack_get_boolean(item2)
+    } else if (value->type == VmValueTypeBoolean) {
+        ret_value = value2->type == VmValueTypeBoolean
+                    ? value->data.boolean_value == value2->data.boolean_value
                       ? 0 : 1
                     : -1;
-    } else if (rox_stack_is_string(item)) {
-        ret_value = rox_stack_is_string(item2)
-                    ? strcmp(rox_stack_get_string(item), rox_stack_get_string(item2))
+    } else if (value->type == VmValueTypeString) {
+        ret_value = value2->type == VmValueTypeString
+                    ? strcmp(value->data.str_value, value2->data.str_value)
                     : -1;
     }
     return ret_value;
 }
 
+static void vm_stack_push_boolean(VmStack *stack, bool value) {
+    vm_stack_push(stack, vm_value_boolean(value));
+}
+
+static bool vm_stack_pop_boolean(VmStack *stack) {
+    VmValue value = vm_stack_pop(stack);
+    bool result = vm_value_is_true(&value);
+    vm_value_release(&value);
+    return result;
+}
+
 static void
-parser_operator_is_undefined(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+parser_operator_is_undefined(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item = rox_stack_pop(stack);
-    rox_stack_push_boolean(stack, item && rox_stack_is_undefined(item));
+    VmValue value = vm_stack_pop(stack);
+    vm_stack_push_boolean(stack, value.type == VmValueTypeUndefined);
+    vm_value_release(&value);
 }
 
-static void parser_operator_now(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_now(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
     double time = current_time_millis();
-    rox_stack_push_double(stack, time);
-}
-
-static bool rox_stack_pop_boolean(CoreStack *stack) {
-    StackItem *item = rox_stack_pop(stack);
-    assert(item);
-    if (rox_stack_is_boolean(item)) {
-        return rox_stack_get_boolean(item);
-    }
-    return false;
+    vm_stack_push(stack, vm_value_double(time));
 }
 
-static void parser_operator_and(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_and(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    bool b1 = rox_stack_pop_boolean(stack);
-    bool b2 = rox_stack_pop_boolean(stack);
-    rox_stack_push_boolean(stack, b1 && b2);
+    bool b1 = vm_stack_pop_boolean(stack);
+    bool b2 = vm_stack_pop_boolean(stack);
+    vm_stack_push_boolean(stack, b1 && b2);
 }
 
-static void parser_operator_or(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_or(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    bool b1 = rox_stack_pop_boolean(stack);
-    bool b2 = rox_stack_pop_boolean(stack);
-    rox_stack_push_boolean(stack, b1 || b2);
+    bool b1 = vm_stack_pop_boolean(stack);
+    bool b2 = vm_stack_pop_boolean(stack);
+    vm_stack_push_boolean(stack, b1 || b2);
 }
 
-static bool is_number_operand(StackItem *item, double *num) {
-    if (rox_stack_is_undefined(item)) {
-        return false;
-    }
-    if (rox_stack_is_numeric(item)) {
-        *num = rox_stack_get_number(item);
+static bool is_number_operand(const VmValue *value, double *num) {
+    if (vm_value_is_numeric(value)) {
+        *num = vm_value_get_number(value);
         return true;
     }
-    if (rox_stack_is_string(item)) {
-        char *string = rox_stack_get_string(item);
-        double *parsed = mem_str_to_double(string);
-        if (parsed) {
-            *num = *parsed;
-            free(parsed);
-            return true;
-        }
+    if (value->type == VmValueTypeString) {
+        return parser_str_to_double(value->data.str_value, num);
     }
     return false;
 }
 
-static void parser_operator_ne(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
-    assert(parser);
-    assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    bool equal = parser_compare_stack_items(item1, item2) == 0;
-    rox_stack_push_boolean(stack, !equal);
+static void parser_operator_equality(VmStack *stack, bool equal_result) {
+    VmValue value1 = vm_stack_pop(stack);
+    VmValue value2 = vm_stack_pop(stack);
+    bool equal = parser_compare_values(&value1, &value2) == 0;
+    vm_value_release(&value1);
+    vm_value_release(&value2);
+    vm_stack_push_boolean(stack, equal == equal_result);
 }
 
-static void parser_operator_numne(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_ne(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    bool result = false;
-    double dec1, dec2;
-    if (is_number_operand(item1, &dec1) &&
-        is_number_operand(item2, &dec2)) {
-        result = fabs(dec1 - dec2) > DBL_EPSILON;
-    }
-    rox_stack_push_boolean(stack, result);
+    parser_operator_equality(stack, false);
 }
 
-static void parser_operator_eq(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_eq(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    bool equal = parser_compare_stack_items(item1, item2) == 0;
-    rox_stack_push_boolean(stack, equal);
+    parser_operator_equality(stack, true);
 }
 
-static void parser_operator_numeq(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+typedef bool (*parser_comparison_op)(double d1, double d2);
+
+static void parser_operator_cmp_dbl(Parser *parser, VmStack *stack, parser_comparison_op cmp) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
+    VmValue op1 = vm_stack_pop(stack);
+    VmValue op2 = vm_stack_pop(stack);
     bool result = false;
     double dec1, dec2;
-    if (is_number_operand(item1, &dec1) &&
-        is_number_operand(item2, &dec2)) {
-        result = fabs(dec1 - dec2) <= DBL_EPSILON;
+    if (is_number_operand(&op1, &dec1) &&
+        is_number_operand(&op2, &dec2)) {
+        result = cmp(dec1, dec2);
     }
-    rox_stack_push_boolean(stack, result);
+    vm_value_release(&op1);
+    vm_value_release(&op2);
+    vm_stack_push_boolean(stack, result);
 }
 
-static void parser_operator_not(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static bool parser_cmp_dbl_ne(double d1, double d2) {
+    return fabs(d1 - d2) > DBL_EPSILON;
+}
+
+static bool parser_cmp_dbl_eq(double d1, double d2) {
+    return fabs(d1 - d2) <= DBL_EPSILON;
+}
+
+bool parser_cmp_dbl_lt(double d1, double d2) {
+    return d2 - d1 > DBL_EPSILON;
+}
+
+bool parser_cmp_dbl_lte(double d1, double d2) {
+    return parser_cmp_dbl_lt(d1, d2) || (fabs(d1 - d2) < DBL_EPSILON);
+}
+
+bool parser_cmp_dbl_gt(double d1, double d2) {
+    return d1 - d2 > DBL_EPSILON;
+}
+
+bool parser_cmp_dbl_gte(double d1, double d2) {
+    return parser_cmp_dbl_gt(d1, d2) || (fabs(d1 - d2) < DBL_EPSILON);
+}
+
+static void parser_operator_numne(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    rox_stack_push_boolean(stack, !rox_stack_pop_boolean(stack));
+    parser_operator_cmp_dbl(parser, stack, &parser_cmp_dbl_ne);
 }
 
-static void parser_operator_if_then(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_numeq(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    bool b = rox_stack_pop_boolean(stack);
-    StackItem *trueExpression = rox_stack_pop(stack);
-    StackItem *falseExpression = rox_stack_pop(stack);
-    rox_stack_push_item_copy(stack, b ? trueExpression : falseExpression);
+    parser_operator_cmp_dbl(parser, stack, &parser_cmp_dbl_eq);
 }
 
-static void parser_operator_in_array(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_lt(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *op1 = rox_stack_pop(stack);
-    StackItem *op2 = rox_stack_pop(stack);
-    if (!rox_stack_is_list(op2)) {
-        rox_stack_push_boolean(stack, false);
-        return;
-    }
-    RoxList *list = rox_stack_get_list(op2);
-    RoxDynamicValue *v1 = rox_stack_get_value(op1);
-    ROX_LIST_FOREACH(item, list, {
-        RoxDynamicValue *v2 = (RoxDynamicValue *) item;
-        if (rox_dynamic_value_equals(v1, v2)) {
-            rox_stack_push_boolean(stack, true);
-            ROX_LIST_FOREACH_RETURN;
-        }
-    })
-    rox_stack_push_boolean(stack, false);
+    parser_operator_cmp_dbl(parser, stack, &parser_cmp_dbl_lt);
 }
 
-static void parser_operator_md5(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_lte(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item = rox_stack_pop(stack);
-    if (!rox_stack_is_string(item)) {
-        rox_stack_push_undefined(stack);
-        return;
-    }
-    char *s = rox_stack_get_string(item);
-    rox_stack_push_string_ptr(stack, mem_md5_str(s));
+    parser_operator_cmp_dbl(parser, stack, &parser_cmp_dbl_lte);
 }
 
-static void parser_operator_concat(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_gt(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *i1 = rox_stack_pop(stack);
-    StackItem *i2 = rox_stack_pop(stack);
-    if (!rox_stack_is_string(i1) || !rox_stack_is_string(i2)) {
-        rox_stack_push_undefined(stack);
-        return;
-    }
-    char *s1 = rox_stack_get_string(i1);
-    char *s2 = rox_stack_get_string(i2);
-    rox_stack_push_string_ptr(stack, mem_str_concat(s1, s2));
+    parser_operator_cmp_dbl(parser, stack, &parser_cmp_dbl_gt);
 }
 
-static void parser_operator_b64d(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_gte(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item = rox_stack_pop(stack);
-    if (!rox_stack_is_string(item)) {
-        rox_stack_push_undefined(stack);
-        return;
-    }
-    char *s = rox_stack_get_string(item);
-    rox_stack_push_string_ptr(stack, mem_base64_decode_str(s));
+    parser_operator_cmp_dbl(parser, stack, &parser_cmp_dbl_gte);
 }
 
-static void parser_operator_ts_to_num(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_not(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *item = rox_stack_pop(stack);
-    // check if a timestamp
-    if (rox_stack_is_datetime(item)) {
-      struct tm *datetime = rox_stack_get_datetime(item);
-      time_t time = mktime(datetime);
-      rox_stack_push_int(stack, time);
+    vm_stack_push_boolean(stack, !vm_stack_pop_boolean(stack));
+}
+
+static void parser_operator_if_then(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
+    assert(parser);
+    assert(stack);
+    bool b = vm_stack_pop_boolean(stack);
+    VmValue true_expression = vm_stack_pop(stack);
+    VmValue false_expression = vm_stack_pop(stack);
+    if (b) {
+        vm_value_release(&false_expression);
+        vm_stack_push(stack, true_expression);
     } else {
-        rox_stack_push_undefined(stack);
+        vm_value_release(&true_expression);
+        vm_stack_push(stack, false_expression);
     }
 }
 
-typedef bool (*parser_comparison_op)(double d1, double d2);
-
-static void
-parser_operator_cmp_dbl(Parser *parser, CoreStack *stack, EvaluationContext *eval_context, parser_comparison_op cmp) {
+static void parser_operator_in_array(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *op1 = rox_stack_pop(stack);
-    StackItem *op2 = rox_stack_pop(stack);
+    VmValue op1 = vm_stack_pop(stack);
+    VmValue op2 = vm_stack_pop(stack);
     bool result = false;
-    double dec1, dec2;
-    if (is_number_operand(op1, &dec1) &&
-        is_number_operand(op2, &dec2)) {
-        result = cmp(dec1, dec2);
+    if (op2.type == VmValueTypeList) {
+        ROX_LIST_FOREACH(item, op2.data.list_value, {
+            if (vm_value_equals_dynamic_value(&op1, (RoxDynamicValue *) item)) {
+                result = true;
+                break;
+            }
+        })
     }
-    rox_stack_push_boolean(stack, result);
-}
-
-bool parser_cmp_dbl_lt(double d1, double d2) {
-    return d2 - d1 > DBL_EPSILON;
+    vm_value_release(&op1);
+    vm_value_release(&op2);
+    vm_stack_push_boolean(stack, result);
 }
 
-bool parser_cmp_dbl_lte(double d1, double d2) {
-    return parser_cmp_dbl_lt(d1, d2) || (fabs(d1 - d2) < DBL_EPSILON);
-}
+typedef char *(*parser_string_function)(const char *str);
 
-bool parser_cmp_dbl_gt(double d1, double d2) {
-    return d1 - d2 > DBL_EPSILON;
-}
-
-bool parser_cmp_dbl_gte(double d1, double d2) {
-    return parser_cmp_dbl_gt(d1, d2) || (fabs(d1 - d2) < DBL_EPSILON);
+static void parser_operator_string_function(VmStack *stack, parser_string_function func) {
+    VmValue value = vm_stack_pop(stack);
+    if (value.type != VmValueTypeString) {
+        vm_value_release(&value);
+        vm_stack_push(stack, vm_value_undefined());
+        return;
+    }
+    char *result = func(value.data.str_value);
+    vm_value_release(&value);
+    vm_stack_push(stack, vm_value_string_ptr(result));
 }
 
-static void parser_operator_lt(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_md5(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_cmp_dbl(parser, stack, eval_context, &parser_cmp_dbl_lt);
+    parser_operator_string_function(stack, &mem_md5_str);
 }
 
-static void parser_operator_lte(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_concat(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_cmp_dbl(parser, stack, eval_context, &parser_cmp_dbl_lte);
+    VmValue value1 = vm_stack_pop(stack);
+    VmValue value2 = vm_stack_pop(stack);
+    VmValue result = vm_value_undefined();
+    if (value1.type == VmValueTypeString && value2.type == VmValueTypeString) {
+        result = vm_value_string_ptr(mem_str_concat(value1.data.str_value, value2.data.str_value));
+    }
+    vm_value_release(&value1);
+    vm_value_release(&value2);
+    vm_stack_push(stack, result);
 }
 
-static void parser_operator_gt(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_b64d(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_cmp_dbl(parser, stack, eval_context, &parser_cmp_dbl_gt);
+    parser_operator_string_function(stack, &mem_base64_decode_str);
 }
 
-static void parser_operator_gte(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_ts_to_num(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_cmp_dbl(parser, stack, eval_context, &parser_cmp_dbl_gte);
+    VmValue value = vm_stack_pop(stack);
+    // check if a timestamp
+    if (value.type == VmValueTypeDateTime) {
+        time_t time = mktime(value.data.datetime_value);
+        vm_stack_push(stack, vm_value_int((int) time));
+    } else {
+        vm_stack_push(stack, vm_value_undefined());
+    }
+    vm_value_release(&value);
 }
 
 typedef int (*parser_cmp_semver)(semver_t x, semver_t y);
 
-static int parser_operator_semver_cmp(
-        Parser *parser, CoreStack *stack, EvaluationContext *eval_context, parser_cmp_semver cmp) {
+static void parser_operator_semver_cmp(Parser *parser, VmStack *stack, parser_cmp_semver cmp) {
     assert(parser);
     assert(stack);
-    StackItem *item1 = rox_stack_pop(stack);
-    StackItem *item2 = rox_stack_pop(stack);
-    if (!rox_stack_is_string(item1) || !rox_stack_is_string(item2)) {
-        rox_stack_push_boolean(stack, false);
-        return -1;
-    }
-    char *s1 = rox_stack_get_string(item1);
-    char *s2 = rox_stack_get_string(item2);
-    semver_t v1, v2;
-    memset(&v1, 0, sizeof(semver_t));
-    memset(&v2, 0, sizeof(semver_t));
-    v1.patch = -1;
-    v2.patch = -1;
-    if (semver_parse(s1, &v1) != 0 || semver_parse(s2, &v2) != 0) {
-        rox_stack_push_boolean(stack, false);
-        return -1;
-    }
-    bool result = cmp(v1, v2);
-    rox_stack_push_boolean(stack, result);
-    return 0;
-}
-
-static void parser_operator_semver_ne(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+    VmValue value1 = vm_stack_pop(stack);
+    VmValue value2 = vm_stack_pop(stack);
+    bool result = false;
+    if (value1.type == VmValueTypeString && value2.type == VmValueTypeString) {
+        semver_t v1, v2;
+        memset(&v1, 0, sizeof(semver_t));
+        memset(&v2, 0, sizeof(semver_t));
+        v1.patch = -1;
+        v2.patch = -1;
+        if (semver_parse(value1.data.str_value, &v1) == 0 && semver_parse(value2.data.str_value, &v2) == 0) {
+            result = cmp(v1, v2);
+        }
+    }
+    vm_value_release(&value1);
+    vm_value_release(&value2);
+    vm_stack_push_boolean(stack, result);
+}
+
+static void parser_operator_semver_ne(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_semver_cmp(parser, stack, eval_context, &semver_neq);
+    parser_operator_semver_cmp(parser, stack, &semver_neq);
 }
 
-static void parser_operator_semver_eq(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_semver_eq(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_semver_cmp(parser, stack, eval_context, &semver_eq);
+    parser_operator_semver_cmp(parser, stack, &semver_eq);
 }
 
-static void parser_operator_semver_lt(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_semver_lt(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_semver_cmp(parser, stack, eval_context, &semver_lt);
+    parser_operator_semver_cmp(parser, stack, &semver_lt);
 }
 
 static void
-parser_operator_semver_lte(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+parser_operator_semver_lte(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_semver_cmp(parser, stack, eval_context, &semver_lte);
+    parser_operator_semver_cmp(parser, stack, &semver_lte);
 }
 
-static void parser_operator_semver_gt(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_semver_gt(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_semver_cmp(parser, stack, eval_context, &semver_gt);
+    parser_operator_semver_cmp(parser, stack, &semver_gt);
 }
 
 static void
-parser_operator_semver_gte(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+parser_operator_semver_gte(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    parser_operator_semver_cmp(parser, stack, eval_context, &semver_gte);
+    parser_operator_semver_cmp(parser, stack, &semver_gte);
 }
 
-static void parser_operator_match(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+static void parser_operator_match(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
     assert(parser);
     assert(stack);
-    StackItem *op1 = rox_stack_pop(stack);
-    StackItem *op2 = rox_stack_pop(stack);
-    StackItem *op3 = rox_stack_pop(stack);
-
-    if (!rox_stack_is_string(op1)
-        || !rox_stack_is_string(op2)
-        || !rox_stack_is_string(op3)) {
-        rox_stack_push_boolean(stack, false);
-        return;
+    VmValue op1 = vm_stack_pop(stack);
+    VmValue op2 = vm_stack_pop(stack);
+    VmValue op3 = vm_stack_pop(stack);
+
+    bool match = false;
+    if (op1.type == VmValueTypeString &&
+        op2.type == VmValueTypeString &&
+        op3.type == VmValueTypeString) {
+
+        const char *str = op1.data.str_value;
+        const char *pattern = op2.data.str_value;
+        const char *flags = op3.data.str_value;
+
+        unsigned int options = 0;
+        for (int i = 0; flags[i] != '\0'; ++i) {
+            char flag = flags[i];
+            if (flag == 'i') {
+                options |= PCRE2_CASELESS;
+            }
+            if (flag == 'x') {
+                options |= PCRE2_EXTENDED;
+            }
+            if (flag == 's') {
+                options |= PCRE2_DOTALL;
+            }
+            if (flag == 'm') {
+                options |= PCRE2_MULTILINE;
+            }
+            if (flag == 'n') {
+                options |= PCRE2_NO_AUTO_CAPTURE;
+            }
+        }
+
+        match = str_matches(str, pattern, options);
+    }
+
+    vm_value_release(&op1);
+    vm_value_release(&op2);
+    vm_value_release(&op3);
+    vm_stack_push_boolean(stack, match);
+}
+
+static void parser_set_basic_operators(Parser *parser) {
+    assert(parser);
+
+    // basic functions
+    parser_add_native_operator(parser, "isUndefined", 1, NULL, &parser_operator_is_undefined);
+    parser_add_native_operator(parser, "now", 0, NULL, &parser_operator_now);
+    parser_add_native_operator(parser, "and", 2, NULL, &parser_operator_and);
+    parser_add_native_operator(parser, "or", 2, NULL, &parser_operator_or);
+    parser_add_native_operator(parser, "ne", 2, NULL, &parser_operator_ne);
+    parser_add_native_operator(parser, "numne", 2, NULL, &parser_operator_numne);
+    parser_add_native_operator(parser, "eq", 2, NULL, &parser_operator_eq);
+    parser_add_native_operator(parser, "numeq", 2, NULL, &parser_operator_numeq);
+    parser_add_native_operator(parser, "not", 1, NULL, &parser_operator_not);
+    parser_add_native_operator(parser, "ifThen", 3, NULL, &parser_operator_if_then);
+    parser_add_native_operator(parser, "inArray", 2, NULL, &parser_operator_in_array);
+    parser_add_native_operator(parser, "md5", 1, NULL, &parser_operator_md5);
+    parser_add_native_operator(parser, "concat", 2, NULL, &parser_operator_concat);
+    parser_add_native_operator(parser, "b64d", 1, NULL, &parser_operator_b64d);
+    parser_add_native_operator(parser, "tsToNum", 1, NULL, &parser_operator_ts_to_num);
+
+    // value compare functions
+    parser_add_native_operator(parser, "lt", 2, NULL, &parser_operator_lt);
+    parser_add_native_operator(parser, "lte", 2, NULL, &parser_operator_lte);
+    parser_add_native_operator(parser, "gt", 2, NULL, &parser_operator_gt);
+    parser_add_native_operator(parser, "gte", 2, NULL, &parser_operator_gte);
+    parser_add_native_operator(parser, "semverNe", 2, NULL, &parser_operator_semver_ne);
+    parser_add_native_operator(parser, "semverEq", 2, NULL, &parser_operator_semver_eq);
+    parser_add_native_operator(parser, "semverLt", 2, NULL, &parser_operator_semver_lt);
+    parser_add_native_operator(parser, "semverLte", 2, NULL, &parser_operator_semver_lte);
+    parser_add_native_operator(parser, "semverGt", 2, NULL, &parser_operator_semver_gt);
+    parser_add_native_operator(parser, "semverGte", 2, NULL, &parser_operator_semver_gte);
+
+    // regular expression functions
+    parser_add_native_operator(parser, "match", 3, NULL, &parser_operator_match);
+}
+
+//
+// CompiledExpression.
+// Bytecode of a condition, compiled once and shared between evaluations.
+//
+
+typedef struct CompiledExpression {
+    char *expression;
+    VmProgram *program;
+    // number of the compiled expressions maps containing it, changed atomically
+    int ref_count;
+} CompiledExpression;
+
+//
+// The tokens come in prefix order, e.g. "and(eq(1, 1), true)" yields and, eq, 1, 1, true, each with the
+// number of enclosing parentheses. The operands of a token are the tokens following it with a greater depth.
+// Emitting the operands in reverse order before the token itself yields the reversed token list, i.e. the
+// postfix program. The operands of and, or and ifThen are emitted with jumps instead when every token in
+// them is a value or a native operator called with exactly its arity, so that each operand pushes exactly
+// one value and the unused one can be skipped.
+//
+
+typedef struct ParserCompilation {
+    Parser *parser;
+    VmProgram *program;
+    ParserNode **nodes;
+    int nodes_count;
+} ParserCompilation;
+
+static int parser_compilation_subtree_end(ParserCompilation *compilation, int index) {
+    assert(compilation);
+    int end = index + 1;
+    while (end < compilation->nodes_count && compilation->nodes[end]->depth > compilation->nodes[index]->depth) {
+        ++end;
     }
+    return end;
+}
 
-    const char *str = rox_stack_get_string(op1);
-    const char *pattern = rox_stack_get_string(op2);
-    const char *flags = rox_stack_get_string(op3);
+static ParserOperator *parser_compilation_get_operator(ParserCompilation *compilation, int index) {
+    assert(compilation);
+    ParserNode *node = compilation->nodes[index];
+    if (node->type != NodeTypeRator) {
+        return NULL;
+    }
+    assert(rox_dynamic_value_is_string(node->value));
+    ParserOperator *op = NULL;
+    rox_map_get(compilation->parser->operators_map, rox_dynamic_value_get_string(node->value), (void **) &op);
+    return op;
+}
 
-    unsigned int options = 0;
-    for (int i = 0; flags[i] != '\0'; ++i) {
-        char flag = flags[i];
-        if (flag == 'i') {
-            options |= PCRE2_CASELESS;
+static bool parser_compilation_is_balanced(ParserCompilation *compilation, int index) {
+    assert(compilation);
+    int end = parser_compilation_subtree_end(compilation, index);
+    if (compilation->nodes[index]->type == NodeTypeRand) {
+        return end == index + 1;
+    }
+    ParserOperator *op = parser_compilation_get_operator(compilation, index);
+    if (!op || op->arity < 0) {
+        return false;
+    }
+    int operands_count = 0;
+    for (int operand = index + 1; operand < end; operand = parser_compilation_subtree_end(compilation, operand)) {
+        if (!parser_compilation_is_balanced(compilation, operand)) {
+            return false;
         }
-        if (flag == 'x') {
-            options |= PCRE2_EXTENDED;
+        ++operands_count;
+    }
+    return operands_count == op->arity;
+}
+
+static void parser_compilation_patch_jump(ParserCompilation *compilation, int jump) {
+    assert(compilation);
+    compilation->program->instructions[jump].operand = (int) compilation->program->instructions_count;
+}
+
+static void parser_compilation_emit_subtree(ParserCompilation *compilation, int index);
+
+static void parser_compilation_emit_subtrees_reversed(ParserCompilation *compilation, int index, int end) {
+    assert(compilation);
+    if (index >= end) {
+        return;
+    }
+    parser_compilation_emit_subtrees_reversed(compilation, parser_compilation_subtree_end(compilation, index), end);
+    parser_compilation_emit_subtree(compilation, index);
+}
+
+static void parser_compilation_emit_subtree(ParserCompilation *compilation, int index) {
+    assert(compilation);
+    VmProgram *program = compilation->program;
+    ParserNode *node = compilation->nodes[index];
+    int end = parser_compilation_subtree_end(compilation, index);
+    if (node->type == NodeTypeRand) {
+        parser_compilation_emit_subtrees_reversed(compilation, index + 1, end);
+        int constant = vm_program_add_constant(program, vm_value_from_dynamic_value(node->value));
+        vm_program_emit(program, VmOpcodePushConstant, constant);
+        return;
+    }
+    if (node->type != NodeTypeRator) {
+        parser_compilation_emit_subtrees_reversed(compilation, index + 1, end);
+        vm_program_emit(program, VmOpcodeUnknownToken, 0);
+        return;
+    }
+
+    ParserOperator *op = parser_compilation_get_operator(compilation, index);
+    bool is_and = op && op->operation == &parser_operator_and;
+    bool is_or = op && op->operation == &parser_operator_or;
+    bool is_if_then = op && op->operation == &parser_operator_if_then;
+    if ((is_and || is_or || is_if_then) && parser_compilation_is_balanced(compilation, index)) {
+        int first = index + 1;
+        int second = parser_compilation_subtree_end(compilation, first);
+        parser_compilation_emit_subtree(compilation, first);
+        int skip_second = vm_program_emit(program, is_or ? VmOpcodeJumpIfTrue : VmOpcodeJumpIfFalse, 0);
+        parser_compilation_emit_subtree(compilation, second);
+        if (!is_if_then) {
+            vm_program_emit(program, VmOpcodeToBoolean, 0);
         }
-        if (flag == 's') {
-            options |= PCRE2_DOTALL;
+        int skip_third = vm_program_emit(program, VmOpcodeJump, 0);
+        parser_compilation_patch_jump(compilation, skip_second);
+        if (is_if_then) {
+            parser_compilation_emit_subtree(compilation, parser_compilation_subtree_end(compilation, second));
+        } else {
+            vm_program_emit(program, VmOpcodePushBoolean, is_or);
         }
-        if (flag == 'm') {
-            options |= PCRE2_MULTILINE;
+        parser_compilation_patch_jump(compilation, skip_third);
+        return;
+    }
+
+    parser_compilation_emit_subtrees_reversed(compilation, index + 1, end);
+    if (op) {
+        // the first operand is emitted last
+        VmInstruction *last = program->instructions_count > 0
+                              ? &program->instructions[program->instructions_count - 1]
+                              : NULL;
+        if (op->interns_operand && index + 1 < end && last && last->opcode == VmOpcodePushConstant) {
+            VmValue *constant = &program->constants[last->operand];
+            if (constant->type == VmValueTypeString) {
+                constant->symbol = symbol_intern(constant->data.str_value);
+            }
         }
-        if (flag == 'n') {
-            options |= PCRE2_NO_AUTO_CAPTURE;
+        vm_program_emit(program, VmOpcodeCallOperator, op->index);
+    }
+}
+
+static VmProgram *parser_compile_program(Parser *parser, const char *expression) {
+    assert(parser);
+    assert(expression);
+    RoxList *tokens = tokenized_expression_get_tokens(expression, parser->operators_map);
+    ParserCompilation compilation;
+    compilation.parser = parser;
+    compilation.program = vm_program_create();
+    compilation.nodes_count = (int) rox_list_size(tokens);
+    compilation.nodes = calloc(compilation.nodes_count + 1, sizeof(ParserNode *));
+    int index = 0;
+    ROX_LIST_FOREACH(item, tokens, {
+        compilation.nodes[index++] = (ParserNode *) item;
+    })
+    parser_compilation_emit_subtrees_reversed(&compilation, 0, compilation.nodes_count);
+    free(compilation.nodes);
+    rox_list_free_cb(tokens, (void (*)(void *)) &node_free);
+    return compilation.program;
+}
+
+static CompiledExpression *compiled_expression_create(Parser *parser, const char *expression) {
+    assert(parser);
+    assert(expression);
+    CompiledExpression *compiled = calloc(1, sizeof(CompiledExpression));
+    compiled->expression = mem_copy_str(expression);
+    compiled->program = parser_compile_program(parser, expression);
+    return compiled;
+}
+
+static void compiled_expression_free(CompiledExpression *compiled) {
+    assert(compiled);
+    vm_program_free(compiled->program);
+    free(compiled->expression);
+    free(compiled);
+}
+
+static void compiled_expressions_add(RoxMap *compiled_expressions, CompiledExpression *compiled) {
+    assert(compiled_expressions);
+    assert(compiled);
+    __atomic_add_fetch(&compiled->ref_count, 1, __ATOMIC_SEQ_CST);
+    rox_map_add(compiled_expressions, compiled->expression, compiled);
+}
+
+static void compiled_expressions_free(RoxMap *compiled_expressions) {
+    assert(compiled_expressions);
+    ROX_MAP_FOREACH(key, value, compiled_expressions, {
+        CompiledExpression *compiled = (CompiledExpression *) value;
+        if (__atomic_sub_fetch(&compiled->ref_count, 1, __ATOMIC_SEQ_CST) == 0) {
+            compiled_expression_free(compiled);
         }
+    })
+    rox_map_free(compiled_expressions);
+}
+
+/**
+ * Must be called with parser->compiled_expressions_lock held.
+ */
+static void parser_publish_compiled_expressions_unsafe(Parser *parser, RoxMap *compiled_expressions) {
+    assert(parser);
+    assert(compiled_expressions);
+    RoxMap *previous = parser->compiled_expressions;
+    epoch_publish((void **) &parser->compiled_expressions, compiled_expressions);
+    epoch_retire(previous, (epoch_free_func) &compiled_expressions_free);
+}
+
+/**
+ * Must be called with parser->compiled_expressions_lock held.
+ */
+static void parser_clear_staged_compiled_expressions_unsafe(Parser *parser) {
+    assert(parser);
+    if (rox_map_size(parser->staged_compiled_expressions) > 0) {
+        // the expressions returned from the staged map may still be in use by the readers
+        epoch_retire(parser->staged_compiled_expressions, (epoch_free_func) &compiled_expressions_free);
+        parser->staged_compiled_expressions = rox_map_create();
+    }
+}
+
+/**
+ * Must be called with parser->compiled_expressions_lock held.
+ */
+static void parser_stage_compiled_expression_unsafe(Parser *parser, CompiledExpression *compiled) {
+    assert(parser);
+    assert(compiled);
+    compiled_expressions_add(parser->staged_compiled_expressions, compiled);
+    size_t published_count = rox_map_size(parser->compiled_expressions);
+    if (rox_map_size(parser->staged_compiled_expressions) < published_count) {
+        return;
     }
+    // the published maps are never modified, so the staged expressions go to a copy; merging only once
+    // as many have been staged as published keeps the copying linear in the number of expressions
+    RoxMap *merged = rox_map_create();
+    ROX_MAP_FOREACH(key, value, parser->compiled_expressions, {
+        compiled_expressions_add(merged, (CompiledExpression *) value);
+    })
+    ROX_MAP_FOREACH(key, value, parser->staged_compiled_expressions, {
+        compiled_expressions_add(merged, (CompiledExpression *) value);
+    })
+    parser_publish_compiled_expressions_unsafe(parser, merged);
+    parser_clear_staged_compiled_expressions_unsafe(parser);
+}
 
-    bool match = str_matches(str, pattern, options);
-    rox_stack_push_boolean(stack, match);
+/**
+ * Must be called with parser->compiled_expressions_lock held.
+ */
+static bool parser_find_compiled_expression_unsafe(
+        Parser *parser,
+        const char *expression,
+        CompiledExpression **compiled) {
+    assert(parser);
+    assert(expression);
+    assert(compiled);
+    return rox_map_get(parser->compiled_expressions, (void *) expression, (void **) compiled) ||
+           rox_map_get(parser->staged_compiled_expressions, (void *) expression, (void **) compiled);
 }
 
-static void parser_set_basic_operators(Parser *parser) {
+/**
+ * Must be called within an epoch read section, the returned expression is valid until it ends.
+ *
+ * @param cached Set to whether the returned expression is cached. If it's not,
+ * the caller must free it with <code>compiled_expression_free()</code>.
+ */
+static CompiledExpression *parser_get_compiled_expression(Parser *parser, const char *expression, bool *cached) {
     assert(parser);
+    assert(expression);
+    assert(cached);
 
-    // basic functions
-    parser_add_operator(parser, "isUndefined", NULL, &parser_operator_is_undefined);
-    parser_add_operator(parser, "now", NULL, &parser_operator_now);
-    parser_add_operator(parser, "and", NULL, &parser_operator_and);
-    parser_add_operator(parser, "or", NULL, &parser_operator_or);
-    parser_add_operator(parser, "ne", NULL, &parser_operator_ne);
-    parser_add_operator(parser, "numne", NULL, &parser_operator_numne);
-    parser_add_operator(parser, "eq", NULL, &parser_operator_eq);
-    parser_add_operator(parser, "numeq", NULL, &parser_operator_numeq);
-    parser_add_operator(parser, "not", NULL, &parser_operator_not);
-    parser_add_operator(parser, "ifThen", NULL, &parser_operator_if_then);
-    parser_add_operator(parser, "inArray", NULL, &parser_operator_in_array);
-    parser_add_operator(parser, "md5", NULL, &parser_operator_md5);
-    parser_add_operator(parser, "concat", NULL, &parser_operator_concat);
-    parser_add_operator(parser, "b64d", NULL, &parser_operator_b64d);
-    parser_add_operator(parser, "tsToNum", NULL, &parser_operator_ts_to_num);
+    *cached = true;
+    CompiledExpression *compiled = NULL;
+    RoxMap *compiled_expressions = epoch_load((void **) &parser->compiled_expressions);
+    if (rox_map_get(compiled_expressions, (void *) expression, (void **) &compiled)) {
+        return compiled;
+    }
 
-    // value compare functions
-    parser_add_operator(parser, "lt", NULL, &parser_operator_lt);
-    parser_add_operator(parser, "lte", NULL, &parser_operator_lte);
-    parser_add_operator(parser, "gt", NULL, &parser_operator_gt);
-    parser_add_operator(parser, "gte", NULL, &parser_operator_gte);
-    parser_add_operator(parser, "semverNe", NULL, &parser_operator_semver_ne);
-    parser_add_operator(parser, "semverEq", NULL, &parser_operator_semver_eq);
-    parser_add_operator(parser, "semverLt", NULL, &parser_operator_semver_lt);
-    parser_add_operator(parser, "semverLte", NULL, &parser_operator_semver_lte);
-    parser_add_operator(parser, "semverGt", NULL, &parser_operator_semver_gt);
-    parser_add_operator(parser, "semverGte", NULL, &parser_operator_semver_gte);
+    // not published yet, may be staged
+    pthread_mutex_lock(&parser->compiled_expressions_lock);
+    bool found = parser_find_compiled_expression_unsafe(parser, expression, &compiled);
+    pthread_mutex_unlock(&parser->compiled_expressions_lock);
+    if (found) {
+        return compiled;
+    }
 
-    // regular expression functions
-    parser_add_operator(parser, "match", NULL, &parser_operator_match);
+    // compiling outside of the lock, the other thread may win the race
+    CompiledExpression *created = compiled_expression_create(parser, expression);
+    pthread_mutex_lock(&parser->compiled_expressions_lock);
+    if (parser_find_compiled_expression_unsafe(parser, expression, &compiled)) {
+        compiled_expression_free(created);
+    } else if (parser->on_demand_compiled_expressions_count >= ROX_PARSER_MAX_COMPILED_EXPRESSIONS) {
+        ROX_DEBUG("Compiled expressions cache is full, not caching %s", expression);
+        compiled = created;
+        *cached = false;
+    } else {
+        parser_stage_compiled_expression_unsafe(parser, created);
+        ++parser->on_demand_compiled_expressions_count;
+        compiled = created;
+    }
+    pthread_mutex_unlock(&parser->compiled_expressions_lock);
+    return compiled;
+}
+
+ROX_INTERNAL void parser_clear_compiled_expressions(Parser *parser) {
+    assert(parser);
+    pthread_mutex_lock(&parser->compiled_expressions_lock);
+    parser_publish_compiled_expressions_unsafe(parser, rox_map_create());
+    parser_clear_staged_compiled_expressions_unsafe(parser);
+    parser->on_demand_compiled_expressions_count = 0;
+    pthread_mutex_unlock(&parser->compiled_expressions_lock);
+}
+
+ROX_INTERNAL void parser_set_compiled_expressions(Parser *parser, RoxList *expressions) {
+    assert(parser);
+    assert(expressions);
+    pthread_mutex_lock(&parser->compiled_expressions_lock);
+    RoxMap *compiled_expressions = rox_map_create();
+    ROX_LIST_FOREACH(item, expressions, {
+        const char *expression = (const char *) item;
+        CompiledExpression *compiled;
+        if (rox_map_contains_key(compiled_expressions, (void *) expression)) {
+            continue;
+        }
+        if (parser_find_compiled_expression_unsafe(parser, expression, &compiled)) {
+            compiled_expressions_add(compiled_expressions, compiled);
+        } else {
+            compiled_expressions_add(compiled_expressions, compiled_expression_create(parser, expression));
+        }
+    })
+    parser_publish_compiled_expressions_unsafe(parser, compiled_expressions);
+    parser_clear_staged_compiled_expressions_unsafe(parser);
+    parser->on_demand_compiled_expressions_count = 0;
+    pthread_mutex_unlock(&parser->compiled_expressions_lock);
+}
+
+ROX_INTERNAL size_t parser_get_compiled_expressions_count(Parser *parser) {
+    assert(parser);
+    pthread_mutex_lock(&parser->compiled_expressions_lock);
+    size_t count = rox_map_size(parser->compiled_expressions) + rox_map_size(parser->staged_compiled_expressions);
+    pthread_mutex_unlock(&parser->compiled_expressions_lock);
+    return count;
 }
 
 ROX_INTERNAL Parser *parser_create() {
     Parser *parser = calloc(1, sizeof(Parser));
     parser->disposal_handlers = rox_list_create();
     parser->operators_map = rox_map_create();
+    parser->compiled_expressions = rox_map_create();
+    parser->staged_compiled_expressions = rox_map_create();
+    parser->compiled_expressions_lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
     parser_set_basic_operators(parser);
     return parser;
 }
@@ -1050,63 +1529,208 @@ ROX_INTERNAL void parser_free(Parser *parser) {
         ParserDisposalHandler *handler = (ParserDisposalHandler *) item;
         handler->handler(handler->target, parser);
     })
+    // nobody is evaluating expressions with the parser being freed
+    compiled_expressions_free(parser->compiled_expressions);
+    compiled_expressions_free(parser->staged_compiled_expressions);
+    pthread_mutex_destroy(&parser->compiled_expressions_lock);
     rox_map_free_with_keys_and_values(parser->operators_map);
+    if (parser->operators) {
+        free(parser->operators);
+    }
     rox_list_free_cb(parser->disposal_handlers, &free);
     free(parser);
 }
 
-ROX_INTERNAL void parser_add_operator(Parser *parser, const char *name, void *target, parser_operation op) {
+static ParserOperator *parser_register_operator(Parser *parser, const char *name) {
     assert(parser);
     assert(name);
-    assert(op);
     assert(!rox_map_contains_key(parser->operators_map, (void *) name));
     ParserOperator *operator = calloc(1, sizeof(ParserOperator));
+    operator->index = parser->operators_count++;
+    parser->operators = realloc(parser->operators, parser->operators_count * sizeof(ParserOperator *));
+    parser->operators[operator->index] = operator;
+    rox_map_add(parser->operators_map, (void *) mem_copy_str(name), operator);
+    // tokens are classified as operators at compile time
+    parser_clear_compiled_expressions(parser);
+    return operator;
+}
+
+ROX_INTERNAL void parser_add_native_operator(
+        Parser *parser,
+        const char *name,
+        int arity,
+        void *target,
+        parser_native_operation op) {
+    assert(parser);
+    assert(name);
+    assert(arity >= 0);
+    assert(op);
+    ParserOperator *operator = parser_register_operator(parser, name);
+    operator->arity = arity;
     operator->target = target;
     operator->operation = op;
-    rox_map_add(parser->operators_map, (void *) mem_copy_str(name), operator);
 }
 
-ROX_INTERNAL EvaluationResult *parser_evaluate_expression(
+ROX_INTERNAL void parser_intern_operand(Parser *parser, const char *name) {
+    assert(parser);
+    assert(name);
+    ParserOperator *operator = NULL;
+    rox_map_get(parser->operators_map, (void *) name, (void **) &operator);
+    assert(operator);
+    operator->interns_operand = true;
+    parser_clear_compiled_expressions(parser);
+}
+
+static void parser_operator_stack_adapter(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
+    assert(target);
+    assert(parser);
+    assert(stack);
+    ParserOperator *operator = (ParserOperator *) target;
+
+    // the operator may consume any number of operands, so it gets the entire stack
+    CoreStack *core_stack = rox_stack_create();
+    for (size_t i = 0; i < stack->size; ++i) {
+        rox_stack_push_dynamic_value(core_stack, vm_value_to_dynamic_value(&stack->values[i]));
+    }
+    vm_stack_release(stack);
+
+    operator->stack_operation(operator->stack_target, parser, core_stack, eval_context);
+
+    RoxList *items = rox_list_create();
+    StackItem *item;
+    while ((item = rox_stack_pop(core_stack))) {
+        rox_list_add(items, item);
+    }
+    rox_list_reverse(items);
+    ROX_LIST_FOREACH(value, items, {
+        vm_stack_push(stack, vm_value_from_dynamic_value(rox_stack_get_value((StackItem *) value)));
+    })
+    rox_list_free(items);
+    rox_stack_free(core_stack);
+}
+
+ROX_INTERNAL void parser_add_operator(Parser *parser, const char *name, void *target, parser_operation op) {
+    assert(parser);
+    assert(name);
+    assert(op);
+    ParserOperator *operator = parser_register_operator(parser, name);
+    operator->arity = -1;
+    operator->target = operator;
+    operator->operation = &parser_operator_stack_adapter;
+    operator->stack_target = target;
+    operator->stack_operation = op;
+}
+
+/**
+ * @return <code>true</code> if the program contains an unknown token.
+ */
+static bool parser_execute_program(
         Parser *parser,
-        const char *expression,
+        const VmProgram *program,
+        VmStack *stack,
         EvaluationContext *eval_context) {
 
     assert(parser);
-    assert(expression);
-
-    EvaluationResult *result = NULL;
-    StackItem *item = NULL;
-    CoreStack *stack = rox_stack_create();
-    RoxList *tokens = tokenized_expression_get_tokens(expression, parser->operators_map);
-    rox_list_reverse(tokens);
+    assert(program);
+    assert(stack);
 
-    RoxContext *context = eval_context ? eval_context_get_context(eval_context) : NULL;
-    RoxListIter *i = rox_list_iter_create();
-    rox_list_iter_init(i, tokens);
-    ParserNode *node;
-    while (rox_list_iter_next(i, (void **) &node)) {
-        if (node->type == NodeTypeRand) {
-            rox_stack_push_dynamic_value(stack, rox_dynamic_value_create_copy(node->value));
-        } else if (node->type == NodeTypeRator) {
-            assert(rox_dynamic_value_is_string(node->value));
-            ParserOperator *op;
-            if (rox_map_get(parser->operators_map, rox_dynamic_value_get_string(node->value), (void **) &op)) {
+    bool has_unknown_token = false;
+    size_t position = 0;
+    while (position < program->instructions_count) {
+        const VmInstruction *instruction = &program->instructions[position++];
+        switch (instruction->opcode) {
+            case VmOpcodePushConstant:
+                vm_stack_push(stack, vm_value_borrow(&program->constants[instruction->operand]));
+                break;
+            case VmOpcodeCallOperator: {
+                ParserOperator *op = parser->operators[instruction->operand];
                 op->operation(op->target, parser, stack, eval_context);
+                break;
             }
-        } else {
-            result = create_result_from_stack_item(NULL, context);
+            case VmOpcodeJump:
+                position = (size_t) instruction->operand;
+                break;
+            case VmOpcodeJumpIfFalse:
+            case VmOpcodeJumpIfTrue: {
+                VmValue value = vm_stack_pop(stack);
+                if (vm_value_is_true(&value) == (instruction->opcode == VmOpcodeJumpIfTrue)) {
+                    position = (size_t) instruction->operand;
+                }
+                vm_value_release(&value);
+                break;
+            }
+            case VmOpcodeToBoolean: {
+                VmValue value = vm_stack_pop(stack);
+                vm_stack_push(stack, vm_value_boolean(vm_value_is_true(&value)));
+                vm_value_release(&value);
+                break;
+            }
+            case VmOpcodePushBoolean:
+                vm_stack_push(stack, vm_value_boolean(instruction->operand != 0));
+                break;
+            case VmOpcodeUnknownToken:
+                has_unknown_token = true;
+                break;
         }
     }
+    return has_unknown_token;
+}
+
+ROX_INTERNAL void parser_evaluate_expression_value(
+        Parser *parser,
+        const char *expression,
+        EvaluationContext *eval_context,
+        VmValue *value) {
+
+    assert(parser);
+    assert(expression);
+    assert(value);
+
+    // the nested evaluations (target groups, flags) share the memo of the outermost one
+    EvaluationMemo memo;
+    bool owns_memo = eval_context && !eval_context->memo;
+    if (owns_memo) {
+        eval_memo_init(&memo);
+        eval_context->memo = &memo;
+    }
 
-    rox_list_iter_free(i);
+    VmStack stack;
+    vm_stack_init(&stack);
+    bool cached;
+    CompiledExpression *compiled = parser_get_compiled_expression(parser, expression, &cached);
+    if (parser_execute_program(parser, compiled->program, &stack, eval_context)) {
+        *value = vm_value_null();
+    } else {
+        *value = vm_stack_pop(&stack);
+    }
+    vm_stack_release(&stack);
+    if (!cached) {
+        // the value may borrow the constants of the program
+        vm_value_own(value);
+        compiled_expression_free(compiled);
+    }
 
-    if (!result) {
-        item = rox_stack_pop(stack);
-        result = create_result_from_stack_item(item, context);
+    if (owns_memo) {
+        eval_context->memo = NULL;
+        eval_memo_release(&memo);
     }
+}
 
-    rox_list_free_cb(tokens, (void (*)(void *)) &node_free); // here all the inner lists and maps should be freed
-    rox_stack_free(stack);
+ROX_INTERNAL EvaluationResult *parser_evaluate_expression(
+        Parser *parser,
+        const char *expression,
+        EvaluationContext *eval_context) {
+
+    assert(parser);
+    assert(expression);
+
+    int token = epoch_read_begin();
+    VmValue value;
+    parser_evaluate_expression_value(parser, expression, eval_context, &value);
+    RoxContext *context = eval_context ? eval_context_get_context(eval_context) : NULL;
+    EvaluationResult *result = create_result_from_value(&value, context);
+    vm_value_release(&value);
+    epoch_read_end(token);
 
     return result;
-}
\ No newline at end of file
+}
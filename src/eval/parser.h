@@ -3,11 +3,15 @@
 #include "rox/context.h"
 #include "core/eval.h"
 #include "stack.h"
+#include "vm.h"
 
 typedef struct Parser Parser;
 
 typedef void (*parser_operation)(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context);
 
+typedef void (*parser_native_operation)(
+        void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context);
+
 typedef void (*parser_disposal_handler)(void *target, Parser *parser);
 
 typedef enum ParserTokenType {
@@ -64,6 +68,68 @@ ROX_INTERNAL void parser_free(Parser *parser);
  */
 ROX_INTERNAL void parser_add_operator(Parser *parser, const char *name, void *target, parser_operation op);
 
+/**
+ * Same as <code>parser_add_operator()</code>, but the operation works directly on the value stack
+ * of the virtual machine. Operators added with <code>parser_add_operator()</code> get a <code>CoreStack</code>
+ * populated with a copy of the value stack instead.
+ *
+ * @param parser Parser reference. NOT <code>NULL</code>.
+ * @param name Operator name. NOT <code>NULL</code>. Value is copied internally.
+ * @param arity Number of operands the operation pops. It must always push exactly one value. Knowing that
+ * lets the unused branches of <code>and</code>, <code>or</code> and <code>ifThen</code> be skipped.
+ * @param target Optional function target. May be <code>NULL</code>.
+ * @param op Pointer to operation function. NOT <code>NULL</code>.
+ */
+ROX_INTERNAL void parser_add_native_operator(
+        Parser *parser,
+        const char *name,
+        int arity,
+        void *target,
+        parser_native_operation op);
+
+/**
+ * Lets the given operator look its first operand up by symbol: when it's a string constant, it's
+ * interned at compile time and pushed with <code>VmValue.symbol</code> set.
+ *
+ * @param parser Parser reference. NOT <code>NULL</code>.
+ * @param name Name of an operator added before. NOT <code>NULL</code>.
+ */
+ROX_INTERNAL void parser_intern_operand(Parser *parser, const char *name);
+
+/**
+ * Upper bound of the expressions compiled and cached on demand, i.e. besides the ones given to
+ * <code>parser_set_compiled_expressions()</code>, which are always cached. Beyond it the other expressions
+ * are compiled on every evaluation until the cache is cleared or replaced, e.g. by the next configuration.
+ */
+#define ROX_PARSER_MAX_COMPILED_EXPRESSIONS 10000
+
+/**
+ * Expressions are compiled once per expression text and reused by subsequent
+ * <code>parser_evaluate_expression()</code> calls, which look them up without taking any lock
+ * once published. The expressions compiled on demand are staged and published in batches.
+ * Drops all the compiled expressions, e.g. when a new configuration is applied. Evaluations
+ * that are already running keep their compiled expressions until they finish.
+ *
+ * @param parser Parser reference. NOT <code>NULL</code>.
+ */
+ROX_INTERNAL void parser_clear_compiled_expressions(Parser *parser);
+
+/**
+ * Replaces all the compiled expressions with the given ones. The expressions that are already
+ * compiled are reused, the others are compiled right away, e.g. all the conditions of a new
+ * configuration, so that evaluating them doesn't need compiling anymore.
+ *
+ * @param parser Parser reference. NOT <code>NULL</code>.
+ * @param expressions List of <code>char *</code>. NOT <code>NULL</code>. The caller holds the ownership.
+ */
+ROX_INTERNAL void parser_set_compiled_expressions(Parser *parser, RoxList *expressions);
+
+/**
+ * @param parser Parser reference. NOT <code>NULL</code>.
+ * @return Number of currently cached compiled expressions.
+ */
+ROX_INTERNAL size_t parser_get_compiled_expressions_count(Parser *parser);
+
 /**
  * THE RETURNED POINTER MUST BE FREED AFTER USE BY CALLING result_free(result).
  * @param parser Parser reference. NOT NULL.
@@ -76,6 +142,23 @@ ROX_INTERNAL EvaluationResult *parser_evaluate_expression(
         const char *expression,
         EvaluationContext *eval_context);
 
+/**
+ * Same as <code>parser_evaluate_expression()</code>, but the value is returned as is, without
+ * allocating an <code>EvaluationResult</code>. It may borrow the constants of the compiled expression,
+ * so the caller must be inside a read section (see <code>core/epoch.h</code>) and release the value
+ * with <code>vm_value_release()</code> before leaving it.
+ *
+ * @param parser Parser reference. NOT NULL.
+ * @param expression Expression. NOT NULL.
+ * @param eval_context Can be NULL.
+ * @param value NOT NULL. Null value when the expression contains an unknown token.
+ */
+ROX_INTERNAL void parser_evaluate_expression_value(
+        Parser *parser,
+        const char *expression,
+        EvaluationContext *eval_context,
+        VmValue *value);
+
 //
 // Get value from evaluation result. If actual value type is different
 // cast is performed, so it's safe to call any of these func on any EvaluationResult.
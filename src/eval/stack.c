@@ -8,6 +8,7 @@
 #include <time.h>
 #include "stack.h"
 #include "collections.h"
+#include "values.h"
 
 struct CoreStack {
     StackItem *current;
@@ -116,7 +117,7 @@ ROX_INTERNAL void rox_stack_push_undefined(CoreStack *stack) {
 ROX_INTERNAL void rox_stack_push_item_copy(CoreStack *stack, StackItem *item) {
     assert(stack);
     assert(item);
-    rox_stack_push_dynamic_value(stack, rox_dynamic_value_create_copy(item->value));
+    rox_stack_push_dynamic_value(stack, dynamic_value_retain(item->value));
 }
 
 ROX_INTERNAL StackItem *rox_stack_pop(struct CoreStack *stack) {
@@ -0,0 +1,338 @@
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+#include "util.h"
+#include "collections.h"
+#include "values.h"
+
+//
+// VmValue
+//
+
+static VmValue vm_value_create(VmValueType type) {
+    VmValue value;
+    memset(&value, 0, sizeof(VmValue));
+    value.type = type;
+    return value;
+}
+
+ROX_INTERNAL VmValue vm_value_null() {
+    return vm_value_create(VmValueTypeNull);
+}
+
+ROX_INTERNAL VmValue vm_value_undefined() {
+    return vm_value_create(VmValueTypeUndefined);
+}
+
+ROX_INTERNAL VmValue vm_value_boolean(bool value) {
+    VmValue result = vm_value_create(VmValueTypeBoolean);
+    result.data.boolean_value = value;
+    return result;
+}
+
+ROX_INTERNAL VmValue vm_value_int(int value) {
+    VmValue result = vm_value_create(VmValueTypeInt);
+    result.data.int_value = value;
+    return result;
+}
+
+ROX_INTERNAL VmValue vm_value_double(double value) {
+    VmValue result = vm_value_create(VmValueTypeDouble);
+    result.data.double_value = value;
+    return result;
+}
+
+ROX_INTERNAL VmValue vm_value_string_ptr(char *value) {
+    assert(value);
+    VmValue result = vm_value_create(VmValueTypeString);
+    result.data.str_value = value;
+    result.owned = true;
+    return result;
+}
+
+ROX_INTERNAL VmValue vm_value_borrow(const VmValue *value) {
+    assert(value);
+    VmValue result = *value;
+    result.owned = false;
+    result.ref = NULL;
+    return result;
+}
+
+// the items are immutable, so they are shared by the copy
+static RoxList *vm_copy_dynamic_value_list(RoxList *list) {
+    assert(list);
+    return mem_deep_copy_list(list, (void *(*)(void *)) &dynamic_value_retain);
+}
+
+static RoxMap *vm_copy_dynamic_value_map(RoxMap *map) {
+    assert(map);
+    RoxMap *copy = rox_map_create();
+    ROX_MAP_FOREACH(key, value, map, {
+        rox_map_add(copy, mem_copy_str(key), dynamic_value_retain(value));
+    })
+    return copy;
+}
+
+static struct tm *vm_copy_datetime(const struct tm *datetime) {
+    assert(datetime);
+    struct tm *copy = malloc(sizeof(struct tm));
+    memcpy(copy, datetime, sizeof(struct tm));
+    return copy;
+}
+
+ROX_INTERNAL VmValue vm_value_from_dynamic_value(RoxDynamicValue *value) {
+    assert(value);
+    if (rox_dynamic_value_is_null(value)) {
+        return vm_value_null();
+    }
+    if (rox_dynamic_value_is_undefined(value)) {
+        return vm_value_undefined();
+    }
+    if (rox_dynamic_value_is_int(value)) {
+        return vm_value_int(rox_dynamic_value_get_int(value));
+    }
+    if (rox_dynamic_value_is_double(value)) {
+        return vm_value_double(rox_dynamic_value_get_double(value));
+    }
+    if (rox_dynamic_value_is_boolean(value)) {
+        return vm_value_boolean(rox_dynamic_value_get_boolean(value));
+    }
+    VmValue result = vm_value_null();
+    if (rox_dynamic_value_is_string(value)) {
+        result.type = VmValueTypeString;
+        result.data.str_value = rox_dynamic_value_get_string(value);
+    } else if (rox_dynamic_value_is_datetime(value)) {
+        result.type = VmValueTypeDateTime;
+        result.data.datetime_value = rox_dynamic_value_get_datetime(value);
+    } else if (rox_dynamic_value_is_list(value)) {
+        result.type = VmValueTypeList;
+        result.data.list_value = rox_dynamic_value_get_list(value);
+    } else if (rox_dynamic_value_is_map(value)) {
+        result.type = VmValueTypeMap;
+        result.data.map_value = rox_dynamic_value_get_map(value);
+    } else {
+        return result;
+    }
+    result.ref = dynamic_value_retain(value);
+    return result;
+}
+
+ROX_INTERNAL RoxDynamicValue *vm_value_to_dynamic_value(const VmValue *value) {
+    assert(value);
+    if (value->ref) {
+        return dynamic_value_retain(value->ref);
+    }
+    switch (value->type) {
+        case VmValueTypeUndefined:
+            return rox_dynamic_value_create_undefined();
+        case VmValueTypeBoolean:
+            return rox_dynamic_value_create_boolean(value->data.boolean_value);
+        case VmValueTypeInt:
+            return rox_dynamic_value_create_int(value->data.int_value);
+        case VmValueTypeDouble:
+            return rox_dynamic_value_create_double(value->data.double_value);
+        case VmValueTypeString:
+            return rox_dynamic_value_create_string_copy(value->data.str_value);
+        case VmValueTypeDateTime:
+            return rox_dynamic_value_create_datetime_ptr(vm_copy_datetime(value->data.datetime_value));
+        case VmValueTypeList:
+            return rox_dynamic_value_create_list(vm_copy_dynamic_value_list(value->data.list_value));
+        case VmValueTypeMap:
+            return rox_dynamic_value_create_map(vm_copy_dynamic_value_map(value->data.map_value));
+        default:
+            return rox_dynamic_value_create_null();
+    }
+}
+
+ROX_INTERNAL void vm_value_own(VmValue *value) {
+    assert(value);
+    if (value->owned || value->ref) {
+        return;
+    }
+    switch (value->type) {
+        case VmValueTypeString:
+            value->data.str_value = mem_copy_str(value->data.str_value);
+            break;
+        case VmValueTypeDateTime:
+            value->data.datetime_value = vm_copy_datetime(value->data.datetime_value);
+            break;
+        case VmValueTypeList:
+            value->data.list_value = vm_copy_dynamic_value_list(value->data.list_value);
+            break;
+        case VmValueTypeMap:
+            value->data.map_value = vm_copy_dynamic_value_map(value->data.map_value);
+            break;
+        default:
+            return;
+    }
+    value->owned = true;
+}
+
+ROX_INTERNAL bool vm_value_is_numeric(const VmValue *value) {
+    assert(value);
+    return value->type == VmValueTypeInt || value->type == VmValueTypeDouble;
+}
+
+ROX_INTERNAL bool vm_value_is_true(const VmValue *value) {
+    assert(value);
+    return value->type == VmValueTypeBoolean && value->data.boolean_value;
+}
+
+ROX_INTERNAL double vm_value_get_number(const VmValue *value) {
+    assert(value);
+    assert(vm_value_is_numeric(value));
+    return value->type == VmValueTypeDouble
+           ? value->data.double_value
+           : (double) value->data.int_value;
+}
+
+ROX_INTERNAL bool vm_value_equals_dynamic_value(const VmValue *value, RoxDynamicValue *dynamic_value) {
+    assert(value);
+    assert(dynamic_value);
+    switch (value->type) {
+        case VmValueTypeNull:
+            return rox_dynamic_value_is_null(dynamic_value);
+        case VmValueTypeUndefined:
+            return rox_dynamic_value_is_undefined(dynamic_value);
+        case VmValueTypeInt:
+        case VmValueTypeDouble: {
+            double d2;
+            if (rox_dynamic_value_is_int(dynamic_value)) {
+                d2 = rox_dynamic_value_get_int(dynamic_value);
+            } else if (rox_dynamic_value_is_double(dynamic_value)) {
+                d2 = rox_dynamic_value_get_double(dynamic_value);
+            } else {
+                return false;
+            }
+            return fabs(vm_value_get_number(value) - d2) < FLT_EPSILON;
+        }
+        case VmValueTypeBoolean:
+            return rox_dynamic_value_is_boolean(dynamic_value) &&
+                   rox_dynamic_value_get_boolean(dynamic_value) == value->data.boolean_value;
+        case VmValueTypeString:
+            return rox_dynamic_value_is_string(dynamic_value) &&
+                   strcmp(value->data.str_value, rox_dynamic_value_get_string(dynamic_value)) == 0;
+        default:
+            return false;
+    }
+}
+
+ROX_INTERNAL void vm_value_release(VmValue *value) {
+    assert(value);
+    if (value->ref) {
+        rox_dynamic_value_free(value->ref);
+    } else if (value->owned) {
+        switch (value->type) {
+            case VmValueTypeString:
+                free(value->data.str_value);
+                break;
+            case VmValueTypeDateTime:
+                free(value->data.datetime_value);
+                break;
+            case VmValueTypeList:
+                rox_list_free_cb(value->data.list_value, (void (*)(void *)) &rox_dynamic_value_free);
+                break;
+            case VmValueTypeMap:
+                rox_map_free_with_keys_and_values_cb(value->data.map_value, &free,
+                                                     (void (*)(void *)) &rox_dynamic_value_free);
+                break;
+            default:
+                break;
+        }
+    }
+    *value = vm_value_null();
+}
+
+//
+// VmStack
+//
+
+ROX_INTERNAL void vm_stack_init(VmStack *stack) {
+    assert(stack);
+    stack->values = stack->inline_values;
+    stack->size = 0;
+    stack->capacity = ROX_VM_STACK_INLINE_CAPACITY;
+}
+
+ROX_INTERNAL void vm_stack_release(VmStack *stack) {
+    assert(stack);
+    for (size_t i = 0; i < stack->size; ++i) {
+        vm_value_release(&stack->values[i]);
+    }
+    if (stack->values != stack->inline_values) {
+        free(stack->values);
+    }
+    vm_stack_init(stack);
+}
+
+ROX_INTERNAL void vm_stack_push(VmStack *stack, VmValue value) {
+    assert(stack);
+    if (stack->size == stack->capacity) {
+        size_t capacity = stack->capacity * 2;
+        if (stack->values == stack->inline_values) {
+            stack->values = malloc(capacity * sizeof(VmValue));
+            memcpy(stack->values, stack->inline_values, stack->size * sizeof(VmValue));
+        } else {
+            stack->values = realloc(stack->values, capacity * sizeof(VmValue));
+        }
+        stack->capacity = capacity;
+    }
+    stack->values[stack->size++] = value;
+}
+
+ROX_INTERNAL VmValue vm_stack_pop(VmStack *stack) {
+    assert(stack);
+    if (stack->size == 0) {
+        return vm_value_null();
+    }
+    return stack->values[--stack->size];
+}
+
+//
+// VmProgram
+//
+
+ROX_INTERNAL VmProgram *vm_program_create() {
+    return calloc(1, sizeof(VmProgram));
+}
+
+ROX_INTERNAL int vm_program_add_constant(VmProgram *program, VmValue value) {
+    assert(program);
+    if (program->constants_count == program->constants_capacity) {
+        program->constants_capacity = program->constants_capacity ? program->constants_capacity * 2 : 4;
+        program->constants = realloc(program->constants, program->constants_capacity * sizeof(VmValue));
+    }
+    program->constants[program->constants_count] = value;
+    return (int) program->constants_count++;
+}
+
+ROX_INTERNAL int vm_program_emit(VmProgram *program, VmOpcode opcode, int operand) {
+    assert(program);
+    if (program->instructions_count == program->instructions_capacity) {
+        program->instructions_capacity = program->instructions_capacity ? program->instructions_capacity * 2 : 8;
+        program->instructions = realloc(program->instructions,
+                                        program->instructions_capacity * sizeof(VmInstruction));
+    }
+    VmInstruction *instruction = &program->instructions[program->instructions_count];
+    instruction->opcode = opcode;
+    instruction->operand = operand;
+    return (int) program->instructions_count++;
+}
+
+ROX_INTERNAL void vm_program_free(VmProgram *program) {
+    assert(program);
+    for (size_t i = 0; i < program->constants_count; ++i) {
+        vm_value_release(&program->constants[i]);
+    }
+    if (program->constants) {
+        free(program->constants);
+    }
+    if (program->instructions) {
+        free(program->instructions);
+    }
+    free(program);
+}
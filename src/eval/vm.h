@@ -0,0 +1,215 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include "rox/server.h"
+#include "core/symbols.h"
+
+//
+// VmValue.
+//
+// Tagged value stored inline on the virtual machine stack. Strings, datetimes, lists and maps
+// are either borrowed (e.g. from the program constants), owned by the value, in which case
+// they are freed by vm_value_release(), or shared with the RoxDynamicValue they were taken from,
+// which is then referenced until vm_value_release().
+//
+
+typedef enum VmValueType {
+    VmValueTypeNull,
+    VmValueTypeUndefined,
+    VmValueTypeBoolean,
+    VmValueTypeInt,
+    VmValueTypeDouble,
+    VmValueTypeString,
+    VmValueTypeDateTime,
+    VmValueTypeList,
+    VmValueTypeMap
+} VmValueType;
+
+typedef struct VmValue {
+    VmValueType type;
+    bool owned;
+    // dynamic value the data belongs to, if any
+    RoxDynamicValue *ref;
+    // interned string, set on the constants the operator looks up by name, see parser_intern_operand()
+    const RoxSymbol *symbol;
+    union {
+        bool boolean_value;
+        int int_value;
+        double double_value;
+        char *str_value;
+        struct tm *datetime_value;
+        RoxList *list_value; // list of RoxDynamicValue*
+        RoxMap *map_value; // map of char* to RoxDynamicValue*
+    } data;
+} VmValue;
+
+ROX_INTERNAL VmValue vm_value_null();
+
+ROX_INTERNAL VmValue vm_value_undefined();
+
+ROX_INTERNAL VmValue vm_value_boolean(bool value);
+
+ROX_INTERNAL VmValue vm_value_int(int value);
+
+ROX_INTERNAL VmValue vm_value_double(double value);
+
+/**
+ * @param value Not <code>NULL</code>. The ownership is transferred to the returned value.
+ */
+ROX_INTERNAL VmValue vm_value_string_ptr(char *value);
+
+/**
+ * @param value Not <code>NULL</code>.
+ * @return Value that doesn't own any memory, so it must not outlive <code>value</code>.
+ */
+ROX_INTERNAL VmValue vm_value_borrow(const VmValue *value);
+
+/**
+ * @param value Not <code>NULL</code>. Heap allocated. Its data is shared, not copied.
+ */
+ROX_INTERNAL VmValue vm_value_from_dynamic_value(RoxDynamicValue *value);
+
+/**
+ * THE RETURNED VALUE MUST BE FREED BY CALLING <code>rox_dynamic_value_free()</code> AFTER USE.
+ *
+ * @param value Not <code>NULL</code>. Copied, unless it was taken from a dynamic value.
+ */
+ROX_INTERNAL RoxDynamicValue *vm_value_to_dynamic_value(const VmValue *value);
+
+/**
+ * Copies the borrowed data, if any, so that the value can outlive what it was borrowed from,
+ * e.g. the constants of a program that is freed.
+ *
+ * @param value Not <code>NULL</code>.
+ */
+ROX_INTERNAL void vm_value_own(VmValue *value);
+
+ROX_INTERNAL bool vm_value_is_numeric(const VmValue *value);
+
+/**
+ * @param value Not <code>NULL</code>.
+ * @return Whether the value is boolean <code>true</code>.
+ */
+ROX_INTERNAL bool vm_value_is_true(const VmValue *value);
+
+/**
+ * @param value Must be numeric.
+ */
+ROX_INTERNAL double vm_value_get_number(const VmValue *value);
+
+/**
+ * Same semantics as <code>rox_dynamic_value_equals()</code>.
+ *
+ * @param value Not <code>NULL</code>.
+ * @param dynamic_value Not <code>NULL</code>.
+ */
+ROX_INTERNAL bool vm_value_equals_dynamic_value(const VmValue *value, RoxDynamicValue *dynamic_value);
+
+/**
+ * Frees the owned memory, if any. The value is then reset to null.
+ *
+ * @param value Not <code>NULL</code>.
+ */
+ROX_INTERNAL void vm_value_release(VmValue *value);
+
+//
+// VmStack.
+//
+// Flat value stack. The first ROX_VM_STACK_INLINE_CAPACITY values are stored within the stack
+// struct itself, so when it's allocated on the C stack the typical evaluation doesn't touch the heap.
+//
+
+#define ROX_VM_STACK_INLINE_CAPACITY 32
+
+typedef struct VmStack {
+    VmValue *values;
+    size_t size;
+    size_t capacity;
+    VmValue inline_values[ROX_VM_STACK_INLINE_CAPACITY];
+} VmStack;
+
+/**
+ * @param stack Not <code>NULL</code>.
+ */
+ROX_INTERNAL void vm_stack_init(VmStack *stack);
+
+/**
+ * Releases all the values left on the stack. DON'T FORGET TO CALL THIS.
+ *
+ * @param stack Not <code>NULL</code>.
+ */
+ROX_INTERNAL void vm_stack_release(VmStack *stack);
+
+/**
+ * @param stack Not <code>NULL</code>.
+ * @param value The ownership of the value memory (if any) is transferred to the stack.
+ */
+ROX_INTERNAL void vm_stack_push(VmStack *stack, VmValue value);
+
+/**
+ * @param stack Not <code>NULL</code>.
+ * @return Top value, the caller is responsible for calling <code>vm_value_release()</code> on it.
+ * Null value when the stack is empty.
+ */
+ROX_INTERNAL VmValue vm_stack_pop(VmStack *stack);
+
+//
+// VmProgram.
+//
+// Compiled expression: a flat sequence of instructions plus the constants they refer to.
+//
+
+typedef enum VmOpcode {
+    // pushes the constant with index <code>operand</code>
+    VmOpcodePushConstant,
+    // calls the parser operator with index <code>operand</code>
+    VmOpcodeCallOperator,
+    // continues with the instruction with index <code>operand</code>
+    VmOpcodeJump,
+    // pops a value and jumps to <code>operand</code> unless it's boolean true
+    VmOpcodeJumpIfFalse,
+    // pops a value and jumps to <code>operand</code> if it's boolean true
+    VmOpcodeJumpIfTrue,
+    // replaces the top value with boolean true if it's boolean true, or boolean false otherwise
+    VmOpcodeToBoolean,
+    // pushes boolean <code>operand != 0</code>
+    VmOpcodePushBoolean,
+    // the expression contains a token that is neither a value nor a known operator
+    VmOpcodeUnknownToken
+} VmOpcode;
+
+typedef struct VmInstruction {
+    VmOpcode opcode;
+    int operand;
+} VmInstruction;
+
+typedef struct VmProgram {
+    VmInstruction *instructions;
+    size_t instructions_count;
+    size_t instructions_capacity;
+    VmValue *constants;
+    size_t constants_count;
+    size_t constants_capacity;
+} VmProgram;
+
+ROX_INTERNAL VmProgram *vm_program_create();
+
+/**
+ * @param program Not <code>NULL</code>.
+ * @param value The ownership of the value memory (if any) is transferred to the program.
+ * @return Index of the constant.
+ */
+ROX_INTERNAL int vm_program_add_constant(VmProgram *program, VmValue value);
+
+/**
+ * @param program Not <code>NULL</code>.
+ * @return Index of the emitted instruction.
+ */
+ROX_INTERNAL int vm_program_emit(VmProgram *program, VmOpcode opcode, int operand);
+
+/**
+ * @param program Not <code>NULL</code>.
+ */
+ROX_INTERNAL void vm_program_free(VmProgram *program);
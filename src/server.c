@@ -198,6 +198,13 @@ ROX_API void rox_fetch() {
     rox_core_fetch(rox_global->core, false);
 }
 
+ROX_API bool rox_wait_until_ready(int timeout_ms) {
+    if (!check_setup_called()) {
+        return false;
+    }
+    return rox_core_wait_until_ready(rox_global->core, timeout_ms);
+}
+
 ROX_API void rox_set_context(RoxContext *context) {
     if (!check_setup_called()) {
         return;
@@ -249,69 +256,69 @@ ROX_API RoxStringBase *rox_add_double_with_options(const char *name, double defa
 
 ROX_API char *rox_get_string(RoxStringBase *variant) {
     assert(variant);
-    EvaluationContext *eval_context = eval_context_create(variant, NULL);
-    char *result = variant_get_string(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    char *result = variant_get_string(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API char *rox_get_string_ctx(RoxStringBase *variant, RoxContext *context) {
     assert(variant);
     assert(context);
-    EvaluationContext *eval_context = eval_context_create(variant, context);
-    char *result = variant_get_string(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, context);
+    char *result = variant_get_string(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API int rox_get_int(RoxStringBase *variant) {
     assert(variant);
-    EvaluationContext *eval_context = eval_context_create(variant, NULL);
-    int result = variant_get_int(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    int result = variant_get_int(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API int rox_get_int_ctx(RoxStringBase *variant, RoxContext *context) {
     assert(variant);
     assert(context);
-    EvaluationContext *eval_context = eval_context_create(variant, context);
-    int result = variant_get_int(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, context);
+    int result = variant_get_int(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API double rox_get_double(RoxStringBase *variant) {
     assert(variant);
-    EvaluationContext *eval_context = eval_context_create(variant, NULL);
-    double result = variant_get_double(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    double result = variant_get_double(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API double rox_get_double_ctx(RoxStringBase *variant, RoxContext *context) {
     assert(variant);
     assert(context);
-    EvaluationContext *eval_context = eval_context_create(variant, context);
-    double result = variant_get_double(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, context);
+    double result = variant_get_double(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API bool rox_is_enabled(RoxStringBase *variant) {
     assert(variant);
-    EvaluationContext *eval_context = eval_context_create(variant, NULL);
-    bool result = variant_get_bool(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    bool result = variant_get_bool(variant, NULL, &eval_context);
     return result;
 }
 
 ROX_API bool rox_is_enabled_ctx(RoxStringBase *variant, RoxContext *context) {
     assert(variant);
     assert(context);
-    EvaluationContext *eval_context = eval_context_create(variant, context);
-    bool result = variant_get_bool(variant, NULL, eval_context);
-    eval_context_free(eval_context);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, context);
+    bool result = variant_get_bool(variant, NULL, &eval_context);
     return result;
 }
 
@@ -350,6 +357,63 @@ ROX_API void rox_disabled_do_ctx(RoxStringBase *variant, RoxContext *context, vo
     }
 }
 
+struct RoxEvalSession {
+    RoxContext *context;
+    EvaluationContext eval_context;
+    EvaluationMemo memo;
+    ImpressionBuffer *impressions;
+};
+
+ROX_API RoxEvalSession *rox_eval_session_begin(RoxContext *context) {
+    RoxEvalSession *session = calloc(1, sizeof(RoxEvalSession));
+    session->context = context;
+    eval_context_init(&session->eval_context, NULL, context);
+    eval_memo_init(&session->memo);
+    session->impressions = impression_buffer_create();
+    return session;
+}
+
+static EvaluationContext *rox_eval_session_get_eval_context(RoxEvalSession *session, RoxStringBase *variant) {
+    assert(session);
+    assert(variant);
+    EvaluationContext *eval_context = &session->eval_context;
+    if (eval_context_is_initialized_for(eval_context, variant)) {
+        eval_context->variant = variant;
+        return eval_context;
+    }
+    // the buffered impressions refer to the merged context, and the memo to the values found in it
+    impression_buffer_flush(session->impressions);
+    eval_memo_release(&session->memo);
+    eval_context_init(eval_context, variant, session->context);
+    eval_context->memo = &session->memo;
+    eval_context->impressions = session->impressions;
+    return eval_context;
+}
+
+ROX_API char *rox_eval_session_get_string(RoxEvalSession *session, RoxStringBase *variant) {
+    return variant_get_string(variant, NULL, rox_eval_session_get_eval_context(session, variant));
+}
+
+ROX_API int rox_eval_session_get_int(RoxEvalSession *session, RoxStringBase *variant) {
+    return variant_get_int(variant, NULL, rox_eval_session_get_eval_context(session, variant));
+}
+
+ROX_API double rox_eval_session_get_double(RoxEvalSession *session, RoxStringBase *variant) {
+    return variant_get_double(variant, NULL, rox_eval_session_get_eval_context(session, variant));
+}
+
+ROX_API bool rox_eval_session_is_enabled(RoxEvalSession *session, RoxStringBase *variant) {
+    return variant_get_bool(variant, NULL, rox_eval_session_get_eval_context(session, variant));
+}
+
+ROX_API void rox_eval_session_end(RoxEvalSession *session) {
+    assert(session);
+    impression_buffer_flush(session->impressions);
+    impression_buffer_free(session->impressions);
+    eval_memo_release(&session->memo);
+    free(session);
+}
+
 static void add_custom_prop(const char *name, const CustomPropertyType *type, void *target,
                             rox_custom_property_value_generator generator) {
     assert(name);
@@ -6,6 +6,8 @@
 extern "C" {
 #include "core/client.h"
 #include "core/logging.h"
+#include "core/context.h"
+#include "values.h"
 #include "collections.h"
 #include "util.h"
 }
@@ -44,58 +46,110 @@ namespace Rox {
     // Context
     //
 
-    ContextBuilder::ContextBuilder() {
-        _map = ROX_EMPTY_MAP;
+#define ROX_CONTEXT_BUILDER_DEFAULT_COUNT 8
+#define ROX_CONTEXT_BUILDER_DEFAULT_BYTES 256
+
+    ContextBuilder::ContextBuilder()
+            : _context(nullptr),
+              _reserveCount(ROX_CONTEXT_BUILDER_DEFAULT_COUNT),
+              _reserveBytes(ROX_CONTEXT_BUILDER_DEFAULT_BYTES) {
+    }
+
+#undef ROX_CONTEXT_BUILDER_DEFAULT_COUNT
+#undef ROX_CONTEXT_BUILDER_DEFAULT_BYTES
+
+    ContextBuilder::~ContextBuilder() {
+        if (_context) {
+            rox_context_free(_context);
+        }
+    }
+
+    Context *ContextBuilder::GetContext() {
+        if (!_context) {
+            _context = rox_context_create_arena(_reserveCount, _reserveBytes);
+        }
+        return _context;
+    }
+
+    ContextBuilder &ContextBuilder::Reserve(size_t count, size_t bytes) {
+        if (_context) {
+            rox_context_arena_reserve(_context, count, bytes);
+        } else {
+            _reserveCount = count;
+            _reserveBytes = bytes;
+        }
+        return *this;
+    }
+
+    ContextBuilder &ContextBuilder::Reset(Context *context) {
+        if (_context && _context != context) {
+            rox_context_free(_context);
+        }
+        _context = context;
+        if (context) {
+            rox_context_arena_reset(context);
+        }
+        return *this;
     }
 
     ContextBuilder &ContextBuilder::AddBoolValue(const char *name, bool value) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), rox_dynamic_value_create_boolean(value));
+        RoxDynamicValue dynamic_value = dynamic_value_boolean(value);
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     ContextBuilder &ContextBuilder::AddIntValue(const char *name, int value) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), rox_dynamic_value_create_int(value));
+        RoxDynamicValue dynamic_value = dynamic_value_int(value);
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     ContextBuilder &ContextBuilder::AddDoubleValue(const char *name, double value) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), rox_dynamic_value_create_double(value));
+        RoxDynamicValue dynamic_value = dynamic_value_double(value);
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     ContextBuilder &ContextBuilder::AddStringValue(const char *name, const char *value) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), value
-                                              ? rox_dynamic_value_create_string_copy(value)
-                                              : rox_dynamic_value_create_null());
+        RoxDynamicValue dynamic_value = value
+                                        ? dynamic_value_string_borrowed(value)
+                                        : dynamic_value_null();
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     ContextBuilder &ContextBuilder::AddDateTimeValue(const char *name, const struct tm *value) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), value
-                                              ? rox_dynamic_value_create_datetime_copy(value)
-                                              : rox_dynamic_value_create_null());
+        RoxDynamicValue dynamic_value = value
+                                        ? dynamic_value_datetime_borrowed(value)
+                                        : dynamic_value_null();
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     ContextBuilder &ContextBuilder::AddUndefined(const char *name) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), rox_dynamic_value_create_undefined());
+        RoxDynamicValue dynamic_value = dynamic_value_undefined();
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     ContextBuilder &ContextBuilder::AddNull(const char *name) {
         assert(name);
-        rox_map_add(_map, mem_copy_str(name), rox_dynamic_value_create_null());
+        RoxDynamicValue dynamic_value = dynamic_value_null();
+        rox_context_arena_add(GetContext(), name, &dynamic_value);
         return *this;
     }
 
     Context *ContextBuilder::Build() {
-        return rox_context_create_from_map(_map);
+        // the builder starts a new context from now on, the built one is owned by the caller
+        Context *context = GetContext();
+        _context = nullptr;
+        return context;
     }
 
     //
@@ -180,6 +234,11 @@ namespace Rox {
         return *this;
     }
 
+    OptionsBuilder &OptionsBuilder::SetAsyncSetup(bool asyncSetup) {
+        rox_options_set_async_setup(_options, asyncSetup);
+        return *this;
+    }
+
     ROX_API Options *OptionsBuilder::Build() {
         return _options;
     }
@@ -233,6 +292,33 @@ namespace Rox {
                : rox_is_enabled_ctx(_variant, context);
     }
 
+    EvalSession::EvalSession(Context *context) : _session(rox_eval_session_begin(context)) {
+    }
+
+    EvalSession::~EvalSession() {
+        rox_eval_session_end(_session);
+    }
+
+    char *EvalSession::GetValue(String *flag) {
+        assert(flag);
+        return rox_eval_session_get_string(_session, flag->_variant);
+    }
+
+    bool EvalSession::IsEnabled(Flag *flag) {
+        assert(flag);
+        return rox_eval_session_is_enabled(_session, flag->_variant);
+    }
+
+    int EvalSession::GetValue(Int *flag) {
+        assert(flag);
+        return rox_eval_session_get_int(_session, flag->_variant);
+    }
+
+    double EvalSession::GetValue(Double *flag) {
+        assert(flag);
+        return rox_eval_session_get_double(_session, flag->_variant);
+    }
+
     ROX_API Int *Int::Create(const char *name, int defaultValue) {
         assert(name);
         return new Int(rox_add_int(name, defaultValue));
@@ -407,6 +493,10 @@ namespace Rox {
         rox_fetch();
     }
 
+    ROX_API bool WaitUntilReady(int timeoutMs) {
+        return rox_wait_until_ready(timeoutMs);
+    }
+
     //
     // Dynamic API
     //
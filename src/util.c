@@ -6,8 +6,10 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "util.h"
+#include "collections.h"
 #include "vendor/base64.h"
 #include "vendor/strrep.h"
 #include "vendor/md5.h"
@@ -72,11 +74,8 @@ ROX_INTERNAL bool *mem_copy_bool(bool value) {
 
 ROX_INTERNAL int *mem_str_to_int(const char *str) {
     assert(str);
-    if (str_contains(str, '.')) {
-        return NULL;
-    }
-    long num = strtol(str, NULL, 0);
-    if (num == 0 && str[0] != '0') {
+    int num;
+    if (!str_parse_int(str, &num)) {
         return NULL;
     }
     return mem_copy_int(num);
@@ -84,9 +83,8 @@ ROX_INTERNAL int *mem_str_to_int(const char *str) {
 
 ROX_INTERNAL double *mem_str_to_double(const char *str) {
     assert(str);
-    char *end;
-    double num = strtod(str, &end);
-    if ((num == 0 && str[0] != '0') || *end != '\0') {
+    double num;
+    if (!str_parse_double(str, &num)) {
         return NULL;
     }
     return mem_copy_double(num);
@@ -128,10 +126,98 @@ ROX_INTERNAL char *mem_bool_to_str(bool value,
            : mem_copy_str(false_value);
 }
 
+//
+// Compiled regular expressions cache.
+//
+// Patterns are compiled once per (pattern, options) pair and kept in a bounded LRU list.
+// The compiled code is shared between threads, while the match data is per-thread.
+//
+
 #define ROX_STR_MATCHES_BUFFER_SIZE 256
+#define ROX_REGEX_CACHE_CAPACITY 128
+
+typedef struct RegexCacheEntry {
+    char *key;
+    // NULL if the pattern doesn't compile
+    pcre2_code *code;
+    // the cache holds one reference while the entry is in the list
+    int ref_count;
+    struct RegexCacheEntry *prev;
+    struct RegexCacheEntry *next;
+} RegexCacheEntry;
+
+typedef struct RegexCache {
+    pthread_mutex_t lock;
+    RoxMap *entries; // of char* to RegexCacheEntry*
+    RegexCacheEntry *most_recent;
+    RegexCacheEntry *least_recent;
+    size_t capacity;
+    size_t hits;
+    size_t misses;
+    bool jit_enabled;
+    pthread_key_t match_data_key;
+} RegexCache;
+
+static RegexCache regex_cache;
+static pthread_once_t regex_cache_once = PTHREAD_ONCE_INIT;
+
+static void regex_cache_init() {
+    uint32_t jit = 0;
+    regex_cache.lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+    regex_cache.entries = rox_map_create();
+    regex_cache.capacity = ROX_REGEX_CACHE_CAPACITY;
+    regex_cache.jit_enabled = pcre2_config(PCRE2_CONFIG_JIT, &jit) >= 0 && jit == 1;
+    pthread_key_create(&regex_cache.match_data_key, (void (*)(void *)) &pcre2_match_data_free);
+}
+
+static void regex_cache_entry_release_unsafe(RegexCacheEntry *entry) {
+    assert(entry);
+    assert(entry->ref_count > 0);
+    if (--entry->ref_count == 0) {
+        if (entry->code) {
+            pcre2_code_free(entry->code);
+        }
+        free(entry->key);
+        free(entry);
+    }
+}
 
-ROX_INTERNAL bool str_matches(const char *str, const char *pattern, unsigned int options) {
+static void regex_cache_unlink_unsafe(RegexCacheEntry *entry) {
+    assert(entry);
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        regex_cache.most_recent = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        regex_cache.least_recent = entry->prev;
+    }
+    entry->prev = entry->next = NULL;
+}
 
+static void regex_cache_link_unsafe(RegexCacheEntry *entry) {
+    assert(entry);
+    entry->next = regex_cache.most_recent;
+    if (regex_cache.most_recent) {
+        regex_cache.most_recent->prev = entry;
+    } else {
+        regex_cache.least_recent = entry;
+    }
+    regex_cache.most_recent = entry;
+}
+
+static void regex_cache_evict_unsafe(RegexCacheEntry *entry) {
+    assert(entry);
+    void *removed;
+    regex_cache_unlink_unsafe(entry);
+    rox_map_remove(regex_cache.entries, entry->key, &removed);
+    regex_cache_entry_release_unsafe(entry);
+}
+
+static pcre2_code *regex_compile(const char *pattern, unsigned int options) {
+    assert(pattern);
     int error_number;
     PCRE2_SIZE error_offset;
     pcre2_code *re = pcre2_compile(
@@ -146,27 +232,140 @@ ROX_INTERNAL bool str_matches(const char *str, const char *pattern, unsigned int
         PCRE2_UCHAR buffer[ROX_STR_MATCHES_BUFFER_SIZE];
         pcre2_get_error_message(error_number, buffer, sizeof(buffer));
         ROX_WARN("PCRE2 compilation failed at offset %d: %s", (int) error_offset, buffer);
-        return false;
+        return NULL;
     }
 
-    pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(re, NULL);
-    int rc = pcre2_match(
-            re,
-            (PCRE2_SPTR) str,
-            strlen(str),
-            0,                    /* start at offset 0 in the subject */
-            0,                    /* default options */
-            match_data,           /* block for storing the result */
-            NULL);
+    if (regex_cache.jit_enabled) {
+        // pcre2_match() falls back to the interpreter if JIT compilation fails
+        pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
+    }
+    return re;
+}
+
+static RegexCacheEntry *regex_cache_acquire(const char *pattern, unsigned int options) {
+    assert(pattern);
+    char buffer[ROX_STR_MATCHES_BUFFER_SIZE];
+    char *key = buffer;
+    if (snprintf(buffer, sizeof(buffer), "%x/%s", options, pattern) >= (int) sizeof(buffer)) {
+        key = mem_str_format("%x/%s", options, pattern);
+    }
+
+    RegexCacheEntry *entry = NULL;
+    pthread_mutex_lock(&regex_cache.lock);
+    if (rox_map_get(regex_cache.entries, key, (void **) &entry)) {
+        ++regex_cache.hits;
+        regex_cache_unlink_unsafe(entry);
+        regex_cache_link_unsafe(entry);
+        ++entry->ref_count;
+    } else {
+        ++regex_cache.misses;
+    }
+    pthread_mutex_unlock(&regex_cache.lock);
+    if (entry) {
+        if (key != buffer) {
+            free(key);
+        }
+        return entry;
+    }
 
-    // TODO: handle errors?
+    // compiling outside of the lock, the other thread may win the race
+    RegexCacheEntry *created = calloc(1, sizeof(RegexCacheEntry));
+    created->key = key != buffer ? key : mem_copy_str(key);
+    created->code = regex_compile(pattern, options);
+    created->ref_count = 1;
 
-    pcre2_match_data_free(match_data);
-    pcre2_code_free(re);
+    pthread_mutex_lock(&regex_cache.lock);
+    if (rox_map_get(regex_cache.entries, created->key, (void **) &entry)) {
+        regex_cache_unlink_unsafe(entry);
+        regex_cache_entry_release_unsafe(created);
+    } else {
+        entry = created;
+        rox_map_add(regex_cache.entries, entry->key, entry);
+    }
+    regex_cache_link_unsafe(entry);
+    ++entry->ref_count;
+    while (rox_map_size(regex_cache.entries) > regex_cache.capacity) {
+        regex_cache_evict_unsafe(regex_cache.least_recent);
+    }
+    pthread_mutex_unlock(&regex_cache.lock);
+    return entry;
+}
+
+static void regex_cache_release(RegexCacheEntry *entry) {
+    assert(entry);
+    pthread_mutex_lock(&regex_cache.lock);
+    regex_cache_entry_release_unsafe(entry);
+    pthread_mutex_unlock(&regex_cache.lock);
+}
+
+static pcre2_match_data *regex_get_thread_match_data() {
+    pcre2_match_data *match_data = pthread_getspecific(regex_cache.match_data_key);
+    if (!match_data) {
+        // only the fact of matching is needed, so there's no room for the captured substrings
+        match_data = pcre2_match_data_create(1, NULL);
+        pthread_setspecific(regex_cache.match_data_key, match_data);
+    }
+    return match_data;
+}
 
+ROX_INTERNAL bool str_matches(const char *str, const char *pattern, unsigned int options) {
+    assert(str);
+    assert(pattern);
+    pthread_once(&regex_cache_once, &regex_cache_init);
+
+    RegexCacheEntry *entry = regex_cache_acquire(pattern, options);
+    int rc = -1;
+    if (entry->code) {
+        rc = pcre2_match(
+                entry->code,
+                (PCRE2_SPTR) str,
+                strlen(str),
+                0,                    /* start at offset 0 in the subject */
+                0,                    /* default options */
+                regex_get_thread_match_data(),
+                NULL);
+    }
+    regex_cache_release(entry);
+
+    // rc is 0 when the match data has no room for the captured substrings
     return rc >= 0;
 }
 
+ROX_INTERNAL void str_matches_get_cache_stats(RegexCacheStats *stats) {
+    assert(stats);
+    pthread_once(&regex_cache_once, &regex_cache_init);
+    pthread_mutex_lock(&regex_cache.lock);
+    stats->hits = regex_cache.hits;
+    stats->misses = regex_cache.misses;
+    stats->size = rox_map_size(regex_cache.entries);
+    stats->capacity = regex_cache.capacity;
+    stats->jit_enabled = regex_cache.jit_enabled;
+    pthread_mutex_unlock(&regex_cache.lock);
+}
+
+ROX_INTERNAL void str_matches_set_cache_capacity(size_t capacity) {
+    assert(capacity > 0);
+    pthread_once(&regex_cache_once, &regex_cache_init);
+    pthread_mutex_lock(&regex_cache.lock);
+    regex_cache.capacity = capacity;
+    while (rox_map_size(regex_cache.entries) > regex_cache.capacity) {
+        regex_cache_evict_unsafe(regex_cache.least_recent);
+    }
+    pthread_mutex_unlock(&regex_cache.lock);
+}
+
+ROX_INTERNAL void str_matches_clear_cache() {
+    pthread_once(&regex_cache_once, &regex_cache_init);
+    pthread_mutex_lock(&regex_cache.lock);
+    while (regex_cache.least_recent) {
+        regex_cache_evict_unsafe(regex_cache.least_recent);
+    }
+    regex_cache.hits = 0;
+    regex_cache.misses = 0;
+    pthread_mutex_unlock(&regex_cache.lock);
+}
+
+#undef ROX_REGEX_CACHE_CAPACITY
 #undef ROX_STR_MATCHES_BUFFER_SIZE
 
 ROX_INTERNAL int str_index_of(const char *str, char c) {
@@ -214,25 +413,41 @@ ROX_INTERNAL bool str_is_empty(const char *str) {
     return !str || str_equals(str, "");
 }
 
-ROX_INTERNAL double str_to_double(const char *str, double fallback) {
+ROX_INTERNAL bool str_parse_double(const char *str, double *value) {
     assert(str);
+    assert(value);
     char *end;
     double num = strtod(str, &end);
     if ((num == 0 && str[0] != '0') || *end != '\0') {
-        return fallback;
+        return false;
     }
-    return num;
+    *value = num;
+    return true;
 }
 
-ROX_INTERNAL int str_to_int(const char *str, int fallback) {
+ROX_INTERNAL bool str_parse_int(const char *str, int *value) {
+    assert(str);
+    assert(value);
     if (str_contains(str, '.')) {
-        return fallback;
+        return false;
     }
     long num = strtol(str, NULL, 0);
     if (num == 0 && str[0] != '0') {
-        return fallback;
+        return false;
     }
-    return num;
+    *value = (int) num;
+    return true;
+}
+
+ROX_INTERNAL double str_to_double(const char *str, double fallback) {
+    assert(str);
+    double num;
+    return str_parse_double(str, &num) ? num : fallback;
+}
+
+ROX_INTERNAL int str_to_int(const char *str, int fallback) {
+    int num;
+    return str_parse_int(str, &num) ? num : fallback;
 }
 
 ROX_INTERNAL char *str_to_upper(char *str) {
@@ -35,8 +35,41 @@ ROX_INTERNAL char *mem_bool_to_str(bool value,
                                    const char *true_value,
                                    const char *false_value);
 
+/**
+ * Compiled patterns are cached (see <code>str_matches_get_cache_stats()</code>),
+ * so matching the same pattern again doesn't recompile it.
+ *
+ * @param str Not <code>NULL</code>.
+ * @param pattern Not <code>NULL</code>. PCRE2 pattern.
+ * @param options PCRE2 compile options, e.g. <code>PCRE2_CASELESS</code>.
+ */
 ROX_INTERNAL bool str_matches(const char *str, const char *pattern, unsigned int options);
 
+typedef struct RegexCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t size;
+    size_t capacity;
+    bool jit_enabled;
+} RegexCacheStats;
+
+/**
+ * @param stats Not <code>NULL</code>. Filled with the current state of the <code>str_matches()</code> cache.
+ */
+ROX_INTERNAL void str_matches_get_cache_stats(RegexCacheStats *stats);
+
+/**
+ * Least recently used patterns are evicted when the cache exceeds the capacity.
+ *
+ * @param capacity Maximum number of cached patterns. Must be positive.
+ */
+ROX_INTERNAL void str_matches_set_cache_capacity(size_t capacity);
+
+/**
+ * Frees all the cached patterns and resets the counters.
+ */
+ROX_INTERNAL void str_matches_clear_cache();
+
 ROX_INTERNAL int str_index_of(const char *str, char c);
 
 ROX_INTERNAL bool str_contains(const char *str, char c);
@@ -55,12 +88,30 @@ ROX_INTERNAL bool str_is_empty(const char *str);
  */
 ROX_INTERNAL double str_to_double(const char *str, double fallback);
 
+/**
+ * Same as <code>str_to_double()</code>, but tells the parse error apart from a parsed value.
+ *
+ * @param str Not <code>NULL</code>.
+ * @param value Not <code>NULL</code>. Left untouched in case of parse error.
+ * @return Whether <code>str</code> was parsed.
+ */
+ROX_INTERNAL bool str_parse_double(const char *str, double *value);
+
 /**
  * @param str Not <code>NULL</code>.
  * @return Parsed value of <code>fallback</code> in case of parse error.
  */
 ROX_INTERNAL int str_to_int(const char *str, int fallback);
 
+/**
+ * Same as <code>str_to_int()</code>, but tells the parse error apart from a parsed value.
+ *
+ * @param str Not <code>NULL</code>.
+ * @param value Not <code>NULL</code>. Left untouched in case of parse error.
+ * @return Whether <code>str</code> was parsed.
+ */
+ROX_INTERNAL bool str_parse_int(const char *str, int *value);
+
 /**
  * Note the passed <code>str</code> is modified in-place, without creating new strings.
  *
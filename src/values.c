@@ -9,61 +9,131 @@
 #include "rox/server.h"
 #include "util.h"
 #include "collections.h"
+#include "values.h"
 
 //
-// Handle
+// Inline values
 //
 
-struct RoxDynamicValue {
-    int *int_value;
-    double *double_value;
-    char *str_value;
-    struct tm *datetime_value;
-    RoxList *list_value;
-    RoxMap *map_value;
-    bool is_true;
-    bool is_false;
-    bool is_null;
-    bool is_undefined;
-};
+ROX_INTERNAL RoxDynamicValue dynamic_value_undefined() {
+    RoxDynamicValue value = {.type = RoxDynamicValueTypeUndefined};
+    return value;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_null() {
+    RoxDynamicValue value = {.type = RoxDynamicValueTypeNull};
+    return value;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_boolean(bool value) {
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeBoolean, .data.boolean_value = value};
+    return result;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_int(int value) {
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeInt, .data.int_value = value};
+    return result;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_double(double value) {
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeDouble, .data.double_value = value};
+    return result;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_string_ptr(char *value) {
+    assert(value);
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeString, .owned = true, .data.str_value = value};
+    return result;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_string_borrowed(const char *value) {
+    assert(value);
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeString, .data.str_value = (char *) value};
+    return result;
+}
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_datetime_borrowed(const struct tm *value) {
+    assert(value);
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeDateTime, .data.datetime_value = (struct tm *) value};
+    return result;
+}
+
+ROX_INTERNAL void dynamic_value_release(RoxDynamicValue *value) {
+    assert(value);
+    assert(!value->is_static);
+    if (value->owned) {
+        switch (value->type) {
+            case RoxDynamicValueTypeString:
+                free(value->data.str_value);
+                break;
+            case RoxDynamicValueTypeDateTime:
+                free(value->data.datetime_value);
+                break;
+            case RoxDynamicValueTypeList:
+                rox_list_free_cb(value->data.list_value, (void (*)(void *)) &rox_dynamic_value_free);
+                break;
+            case RoxDynamicValueTypeMap:
+                rox_map_free_with_keys_and_values_cb(
+                        value->data.map_value, &free,
+                        (void (*)(void *)) &rox_dynamic_value_free);
+                break;
+            default:
+                break;
+        }
+    }
+    *value = dynamic_value_undefined();
+}
 
 //
 // Constructors
 //
 
-static RoxDynamicValue *_create_value() {
-    return (RoxDynamicValue *) calloc(1, sizeof(RoxDynamicValue));
+// booleans, null and undefined are immutable, so they are shared instead of allocated
+static RoxDynamicValue ROX_DYNAMIC_VALUE_TRUE = {.type = RoxDynamicValueTypeBoolean, .is_static = true, .data.boolean_value = true};
+static RoxDynamicValue ROX_DYNAMIC_VALUE_FALSE = {.type = RoxDynamicValueTypeBoolean, .is_static = true, .data.boolean_value = false};
+static RoxDynamicValue ROX_DYNAMIC_VALUE_NULL = {.type = RoxDynamicValueTypeNull, .is_static = true};
+static RoxDynamicValue ROX_DYNAMIC_VALUE_UNDEFINED = {.type = RoxDynamicValueTypeUndefined, .is_static = true};
+
+static RoxDynamicValue *_create_value(RoxDynamicValue value) {
+    RoxDynamicValue *dynamic_value = malloc(sizeof(RoxDynamicValue));
+    *dynamic_value = value;
+    dynamic_value->ref_count = 1;
+    return dynamic_value;
+}
+
+ROX_INTERNAL RoxDynamicValue *dynamic_value_retain(RoxDynamicValue *value) {
+    assert(value);
+    assert(value->is_static || value->ref_count > 0);
+    if (!value->is_static) {
+        __atomic_add_fetch(&value->ref_count, 1, __ATOMIC_SEQ_CST);
+    }
+    return value;
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_int(int value) {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->int_value = mem_copy_int(value);
-    return dynamic_value;
+    return _create_value(dynamic_value_int(value));
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_int_ptr(int *value) {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->int_value = value;
+    assert(value);
+    RoxDynamicValue *dynamic_value = _create_value(dynamic_value_int(*value));
+    free(value);
     return dynamic_value;
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_double(double value) {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->double_value = mem_copy_double(value);
-    return dynamic_value;
+    return _create_value(dynamic_value_double(value));
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_double_ptr(double *value) {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->double_value = value;
+    assert(value);
+    RoxDynamicValue *dynamic_value = _create_value(dynamic_value_double(*value));
+    free(value);
     return dynamic_value;
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_boolean(bool value) {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->is_true = value;
-    dynamic_value->is_false = !value;
-    return dynamic_value;
+    return value ? &ROX_DYNAMIC_VALUE_TRUE : &ROX_DYNAMIC_VALUE_FALSE;
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_string_copy(const char *value) {
@@ -73,81 +143,75 @@ ROX_API RoxDynamicValue *rox_dynamic_value_create_string_copy(const char *value)
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_string_ptr(char *value) {
     assert(value);
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->str_value = value;
-    return dynamic_value;
+    return _create_value(dynamic_value_string_ptr(value));
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_datetime_copy(const struct tm *value) {
     assert(value);
-    return rox_dynamic_value_create_datetime_ptr(mem_copy_str(value));
+    struct tm *copy = malloc(sizeof(struct tm));
+    memcpy(copy, value, sizeof(struct tm));
+    return rox_dynamic_value_create_datetime_ptr(copy);
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_datetime_ptr(struct tm *value) {
     assert(value);
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->datetime_value = value;
-    return dynamic_value;
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeDateTime, .owned = true, .data.datetime_value = value};
+    return _create_value(result);
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_list(RoxList *value) {
     assert(value);
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->list_value = value;
-    return dynamic_value;
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeList, .owned = true, .data.list_value = value};
+    return _create_value(result);
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_map(RoxMap *value) {
     assert(value);
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->map_value = value;
-    return dynamic_value;
+    RoxDynamicValue result = {.type = RoxDynamicValueTypeMap, .owned = true, .data.map_value = value};
+    return _create_value(result);
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_null() {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->is_null = true;
-    return dynamic_value;
+    return &ROX_DYNAMIC_VALUE_NULL;
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_undefined() {
-    RoxDynamicValue *dynamic_value = _create_value();
-    dynamic_value->is_undefined = true;
-    return dynamic_value;
+    return &ROX_DYNAMIC_VALUE_UNDEFINED;
 }
 
 ROX_API RoxDynamicValue *rox_dynamic_value_create_copy(RoxDynamicValue *value) {
     assert(value);
-    RoxDynamicValue *copy = _create_value();
-    if (value->int_value) {
-        copy->int_value = mem_copy_int(*value->int_value);
-    }
-    if (value->double_value) {
-        copy->double_value = mem_copy_double(*value->double_value);
-    }
-    if (value->str_value) {
-        copy->str_value = mem_copy_str(value->str_value);
-    }
-    if (value->list_value) {
-        copy->list_value = rox_list_create();
-        ROX_LIST_FOREACH(item, value->list_value, {
-            RoxDynamicValue *dv = (RoxDynamicValue *) item;
-            rox_list_add(copy->list_value, rox_dynamic_value_create_copy(dv));
-        })
-    }
-    if (value->map_value) {
-        copy->map_value = rox_map_create();
-        ROX_MAP_FOREACH(key, val, value->map_value, {
-            rox_map_add(copy->map_value,
-                        mem_copy_str(key),
-                        rox_dynamic_value_create_copy(val));
-        })
+    switch (value->type) {
+        case RoxDynamicValueTypeUndefined:
+            return rox_dynamic_value_create_undefined();
+        case RoxDynamicValueTypeNull:
+            return rox_dynamic_value_create_null();
+        case RoxDynamicValueTypeBoolean:
+            return rox_dynamic_value_create_boolean(value->data.boolean_value);
+        case RoxDynamicValueTypeInt:
+            return rox_dynamic_value_create_int(value->data.int_value);
+        case RoxDynamicValueTypeDouble:
+            return rox_dynamic_value_create_double(value->data.double_value);
+        case RoxDynamicValueTypeString:
+            return rox_dynamic_value_create_string_copy(value->data.str_value);
+        case RoxDynamicValueTypeDateTime:
+            return rox_dynamic_value_create_datetime_copy(value->data.datetime_value);
+        case RoxDynamicValueTypeList: {
+            RoxList *list = rox_list_create();
+            ROX_LIST_FOREACH(item, value->data.list_value, {
+                rox_list_add(list, rox_dynamic_value_create_copy(item));
+            })
+            return rox_dynamic_value_create_list(list);
+        }
+        case RoxDynamicValueTypeMap: {
+            RoxMap *map = rox_map_create();
+            ROX_MAP_FOREACH(key, val, value->data.map_value, {
+                rox_map_add(map, mem_copy_str(key), rox_dynamic_value_create_copy(val));
+            })
+            return rox_dynamic_value_create_map(map);
+        }
     }
-    copy->is_undefined = value->is_undefined;
-    copy->is_null = value->is_null;
-    copy->is_true = value->is_true;
-    copy->is_false = value->is_false;
-    return copy;
+    return rox_dynamic_value_create_undefined();
 }
 
 //
@@ -156,47 +220,47 @@ ROX_API RoxDynamicValue *rox_dynamic_value_create_copy(RoxDynamicValue *value) {
 
 ROX_API bool rox_dynamic_value_is_int(RoxDynamicValue *value) {
     assert(value);
-    return value->int_value != NULL;
+    return value->type == RoxDynamicValueTypeInt;
 }
 
 ROX_API bool rox_dynamic_value_is_double(RoxDynamicValue *value) {
     assert(value);
-    return value->double_value != NULL;
+    return value->type == RoxDynamicValueTypeDouble;
 }
 
 ROX_API bool rox_dynamic_value_is_boolean(RoxDynamicValue *value) {
     assert(value);
-    return value->is_true || value->is_false;
+    return value->type == RoxDynamicValueTypeBoolean;
 }
 
 ROX_API bool rox_dynamic_value_is_string(RoxDynamicValue *value) {
     assert(value);
-    return value->str_value != NULL;
+    return value->type == RoxDynamicValueTypeString;
 }
 
 ROX_API bool rox_dynamic_value_is_datetime(RoxDynamicValue *value) {
     assert(value);
-    return value->datetime_value != NULL;
+    return value->type == RoxDynamicValueTypeDateTime;
 }
 
 ROX_API bool rox_dynamic_value_is_list(RoxDynamicValue *value) {
     assert(value);
-    return value->list_value != NULL;
+    return value->type == RoxDynamicValueTypeList;
 }
 
 ROX_API bool rox_dynamic_value_is_map(RoxDynamicValue *value) {
     assert(value);
-    return value->map_value != NULL;
+    return value->type == RoxDynamicValueTypeMap;
 }
 
 ROX_API bool rox_dynamic_value_is_undefined(RoxDynamicValue *value) {
     assert(value);
-    return value->is_undefined;
+    return value->type == RoxDynamicValueTypeUndefined;
 }
 
 ROX_API bool rox_dynamic_value_is_null(RoxDynamicValue *value) {
     assert(value);
-    return value->is_null;
+    return value->type == RoxDynamicValueTypeNull;
 }
 
 //
@@ -205,75 +269,75 @@ ROX_API bool rox_dynamic_value_is_null(RoxDynamicValue *value) {
 
 ROX_API int rox_dynamic_value_get_int(RoxDynamicValue *value) {
     assert(value);
-    assert(value->int_value);
-    return *value->int_value;
+    assert(value->type == RoxDynamicValueTypeInt);
+    return value->data.int_value;
 }
 
 ROX_API double rox_dynamic_value_get_double(RoxDynamicValue *value) {
     assert(value);
-    assert(value->double_value);
-    return *value->double_value;
+    assert(value->type == RoxDynamicValueTypeDouble);
+    return value->data.double_value;
 }
 
 ROX_API bool rox_dynamic_value_get_boolean(RoxDynamicValue *value) {
     assert(value);
-    assert(value->is_true || value->is_false);
-    return value->is_true;
+    assert(value->type == RoxDynamicValueTypeBoolean);
+    return value->data.boolean_value;
 }
 
 ROX_API char *rox_dynamic_value_get_string(RoxDynamicValue *value) {
     assert(value);
-    assert(value->str_value);
-    return value->str_value;
+    assert(value->type == RoxDynamicValueTypeString);
+    return value->data.str_value;
 }
 
 ROX_API struct tm *rox_dynamic_value_get_datetime(RoxDynamicValue *value) {
     assert(value);
-    assert(value->datetime_value);
-    return value->datetime_value;
+    assert(value->type == RoxDynamicValueTypeDateTime);
+    return value->data.datetime_value;
 }
 
 ROX_API RoxList *rox_dynamic_value_get_list(RoxDynamicValue *value) {
     assert(value);
-    assert(value->list_value);
-    return value->list_value;
+    assert(value->type == RoxDynamicValueTypeList);
+    return value->data.list_value;
 }
 
 ROX_API RoxMap *rox_dynamic_value_get_map(RoxDynamicValue *value) {
     assert(value);
-    assert(value->map_value);
-    return value->map_value;
+    assert(value->type == RoxDynamicValueTypeMap);
+    return value->data.map_value;
 }
 
 //
 // Other
 //
 
+static bool _is_numeric(RoxDynamicValue *value) {
+    return value->type == RoxDynamicValueTypeInt || value->type == RoxDynamicValueTypeDouble;
+}
+
+static double _get_numeric(RoxDynamicValue *value) {
+    return value->type == RoxDynamicValueTypeInt ? value->data.int_value : value->data.double_value;
+}
+
 ROX_API bool rox_dynamic_value_equals(RoxDynamicValue *v1, RoxDynamicValue *v2) {
     assert(v1);
     assert(v2);
-    if (v1->is_null) {
-        return v2->is_null;
-    } else if (v1->is_undefined) {
-        return v2->is_undefined;
-    } else if (v1->int_value || v1->double_value) {
-        if (!v2->int_value && !v2->double_value) {
+    switch (v1->type) {
+        case RoxDynamicValueTypeNull:
+        case RoxDynamicValueTypeUndefined:
+            return v2->type == v1->type;
+        case RoxDynamicValueTypeInt:
+        case RoxDynamicValueTypeDouble:
+            return _is_numeric(v2) && fabs(_get_numeric(v1) - _get_numeric(v2)) < FLT_EPSILON;
+        case RoxDynamicValueTypeBoolean:
+            return v2->type == RoxDynamicValueTypeBoolean && v1->data.boolean_value == v2->data.boolean_value;
+        case RoxDynamicValueTypeString:
+            return v2->type == RoxDynamicValueTypeString && strcmp(v1->data.str_value, v2->data.str_value) == 0;
+        default:
             return false;
-        }
-        double d1 = v1->int_value ? *v1->int_value : *v1->double_value;
-        double d2 = v2->int_value ? *v2->int_value : *v2->double_value;
-        return fabs(d1 - d2) < FLT_EPSILON;
-    } else if (v1->is_true) {
-        return v2->is_true;
-    } else if (v1->is_false) {
-        return v2->is_false;
-    } else if (v1->str_value) {
-        if (!v2->str_value) {
-            return false;
-        }
-        return strcmp(v1->str_value, v2->str_value) == 0;
     }
-    return false;
 }
 
 //
@@ -282,22 +346,10 @@ ROX_API bool rox_dynamic_value_equals(RoxDynamicValue *v1, RoxDynamicValue *v2)
 
 ROX_API void rox_dynamic_value_free(RoxDynamicValue *value) {
     assert(value);
-    if (value->int_value) {
-        free(value->int_value);
-    }
-    if (value->double_value) {
-        free(value->double_value);
-    }
-    if (value->str_value) {
-        free(value->str_value);
-    }
-    if (value->list_value) {
-        rox_list_free_cb(value->list_value, (void (*)(void *)) &rox_dynamic_value_free);
-    }
-    if (value->map_value) {
-        rox_map_free_with_keys_and_values_cb(
-                value->map_value, &free,
-                (void (*)(void *)) &rox_dynamic_value_free);
+    assert(value->is_static || value->ref_count > 0);
+    if (value->is_static || __atomic_sub_fetch(&value->ref_count, 1, __ATOMIC_SEQ_CST) > 0) {
+        return;
     }
+    dynamic_value_release(value);
     free(value);
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+#include "rox/values.h"
+
+//
+// RoxDynamicValue.
+//
+// Tagged union with the scalars stored inline. The internal constructors below return the value
+// itself, so that it can live in the caller's storage (stack, struct field, array) instead of the
+// heap. Such values are released with dynamic_value_release() and must never be passed
+// to rox_dynamic_value_free().
+//
+// Heap allocated values are immutable and reference counted: lookups hand out another reference
+// with dynamic_value_retain(), and rox_dynamic_value_free() drops one. Only a caller that needs
+// to modify a value makes a deep copy with rox_dynamic_value_create_copy().
+//
+
+typedef enum RoxDynamicValueType {
+    RoxDynamicValueTypeUndefined,
+    RoxDynamicValueTypeNull,
+    RoxDynamicValueTypeBoolean,
+    RoxDynamicValueTypeInt,
+    RoxDynamicValueTypeDouble,
+    RoxDynamicValueTypeString,
+    RoxDynamicValueTypeDateTime,
+    RoxDynamicValueTypeList,
+    RoxDynamicValueTypeMap
+} RoxDynamicValueType;
+
+struct RoxDynamicValue {
+    RoxDynamicValueType type;
+    // whether the string, datetime, list or map is freed along with the value
+    bool owned;
+    // shared immutable instance, never freed
+    bool is_static;
+    // references to a heap allocated value, 0 for the values in the caller's storage
+    int ref_count;
+    union {
+        bool boolean_value;
+        int int_value;
+        double double_value;
+        char *str_value;
+        struct tm *datetime_value;
+        RoxList *list_value; // list of RoxDynamicValue*
+        RoxMap *map_value; // map of char* to RoxDynamicValue*
+    } data;
+};
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_undefined();
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_null();
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_boolean(bool value);
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_int(int value);
+
+ROX_INTERNAL RoxDynamicValue dynamic_value_double(double value);
+
+/**
+ * @param value Not <code>NULL</code>. The ownership is transferred to the returned value.
+ */
+ROX_INTERNAL RoxDynamicValue dynamic_value_string_ptr(char *value);
+
+/**
+ * @param value Not <code>NULL</code>.
+ * @return Value that doesn't own the string, so it must not outlive <code>value</code>.
+ */
+ROX_INTERNAL RoxDynamicValue dynamic_value_string_borrowed(const char *value);
+
+/**
+ * @param value Not <code>NULL</code>.
+ * @return Value that doesn't own the datetime, so it must not outlive <code>value</code>.
+ */
+ROX_INTERNAL RoxDynamicValue dynamic_value_datetime_borrowed(const struct tm *value);
+
+/**
+ * @param value Not <code>NULL</code>. Heap allocated, i.e. created by one of the public constructors.
+ * @return <code>value</code>, with one more reference that must be dropped by <code>rox_dynamic_value_free()</code>.
+ */
+ROX_INTERNAL RoxDynamicValue *dynamic_value_retain(RoxDynamicValue *value);
+
+/**
+ * Frees the memory owned by a value built in the caller's storage, leaving an undefined value.
+ *
+ * @param value Not <code>NULL</code>.
+ */
+ROX_INTERNAL void dynamic_value_release(RoxDynamicValue *value);
@@ -131,13 +131,12 @@ static char *_state_sender_serialize_feature_flags(StateSender *sender) {
         RoxStringBase *flag;
         if (rox_map_get(flags, key, (void **) &flag)) {
             cJSON *options_arr = cJSON_CreateArray();
-            RoxListIter *list_iter = rox_list_iter_create();
-            rox_list_iter_init(list_iter, variant_get_options(flag));
+            RoxListIter list_iter;
+            rox_list_iter_init(&list_iter, variant_get_options(flag));
             char *option;
-            while (rox_list_iter_next(list_iter, (void **) &option)) {
+            while (rox_list_iter_next(&list_iter, (void **) &option)) {
                 cJSON_AddItemToArray(options_arr, ROX_JSON_STRING(option));
             }
-            rox_list_iter_free(list_iter);
             const char *default_value = variant_get_default_value(flag);
             const char *variant_name = variant_get_name(flag);
             cJSON_AddItemToArray(arr, ROX_JSON_OBJECT(
@@ -7,6 +7,7 @@
 #include "notifications.h"
 #include "util.h"
 #include "core/logging.h"
+#include "core/network.h"
 #include "collections.h"
 #include "os.h"
 
@@ -292,7 +293,9 @@ static size_t _event_source_reader_write_callback(char *ptr, size_t size, size_t
 static void *_event_source_reader_thread_func(void *ptr) {
     EventSourceReader *reader = (EventSourceReader *) ptr;
 
+    network_share_retain();
     CURL *curl = curl_easy_init();
+    network_share_attach(curl);
     curl_easy_setopt(curl, CURLOPT_URL, reader->url);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
     curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1);
@@ -343,6 +346,7 @@ static void *_event_source_reader_thread_func(void *ptr) {
     }
 
     curl_easy_cleanup(curl);
+    network_share_release();
 #ifndef ROX_APPLE
     pthread_detach(pthread_self()); // free thread resources
 #endif
@@ -1,6 +1,8 @@
 #include <check.h>
 #include "roxtests.h"
 #include "collections.h"
+#include "core/context.h"
+#include "values.h"
 
 //
 // ContextImpTests
@@ -101,6 +103,108 @@ START_TEST (test_with_local_and_global_context) {
 
 END_TEST
 
+START_TEST (test_context_will_return_value_by_symbol) {
+    const RoxSymbol *a = symbol_intern("a");
+    const RoxSymbol *b = symbol_intern("b");
+    const RoxSymbol *d = symbol_intern("d");
+    ck_assert_ptr_eq(a, symbol_intern("a"));
+    ck_assert_int_ne(a->id, b->id);
+    ck_assert_int_lt(d->id, symbol_count());
+    ck_assert_str_eq("a", a->name);
+
+    RoxContext *global_context = rox_context_create_from_map(ROX_MAP(
+            mem_copy_str("a"), rox_dynamic_value_create_int(1),
+            mem_copy_str("b"), rox_dynamic_value_create_int(2)));
+    RoxContext *local_context = rox_context_create_from_map(ROX_MAP(
+            mem_copy_str("a"), rox_dynamic_value_create_int(3)));
+    RoxContext *merged_context = rox_context_create_merged(global_context, local_context);
+
+    RoxDynamicValue *v1 = rox_context_get_symbol(merged_context, a);
+    RoxDynamicValue *v2 = rox_context_get_symbol(merged_context, b);
+    ck_assert_int_eq(3, rox_dynamic_value_get_int(v1));
+    ck_assert_int_eq(2, rox_dynamic_value_get_int(v2));
+    ck_assert_ptr_null(rox_context_get_symbol(merged_context, d));
+
+    rox_dynamic_value_free(v2);
+    rox_dynamic_value_free(v1);
+    rox_context_free(merged_context);
+    rox_context_free(local_context);
+    rox_context_free(global_context);
+}
+
+END_TEST
+
+START_TEST (test_flattened_context_will_return_value_by_symbol) {
+    const RoxSymbol *before = symbol_intern("flat_before");
+    RoxContext *global_context = rox_context_create_from_map(ROX_MAP(
+            mem_copy_str("flat_before"), rox_dynamic_value_create_int(1),
+            mem_copy_str("flat_key"), rox_dynamic_value_create_int(2)));
+    rox_context_flatten(global_context);
+    rox_context_flatten(global_context);
+    const RoxSymbol *key = symbol_intern("flat_key");
+    const RoxSymbol *after = symbol_intern("flat_after");
+
+    RoxDynamicValue *v1 = rox_context_get_symbol(global_context, before);
+    RoxDynamicValue *v2 = rox_context_get_symbol(global_context, key);
+    ck_assert_int_eq(1, rox_dynamic_value_get_int(v1));
+    ck_assert_int_eq(2, rox_dynamic_value_get_int(v2));
+    ck_assert_ptr_null(rox_context_get_symbol(global_context, after));
+    rox_dynamic_value_free(v2);
+    rox_dynamic_value_free(v1);
+
+    RoxContext *local_context = rox_context_create_from_map(ROX_MAP(
+            mem_copy_str("flat_key"), rox_dynamic_value_create_int(3)));
+    InlineMergedContext inline_context;
+    RoxContext *merged_context = rox_context_init_merged(&inline_context, global_context, local_context);
+    RoxDynamicValue *v3 = rox_context_get_symbol(merged_context, key);
+    RoxDynamicValue *v4 = rox_context_get_symbol(merged_context, before);
+    ck_assert_int_eq(3, rox_dynamic_value_get_int(v3));
+    ck_assert_int_eq(1, rox_dynamic_value_get_int(v4));
+    rox_dynamic_value_free(v4);
+    rox_dynamic_value_free(v3);
+
+    rox_context_free(local_context);
+    rox_context_free(global_context);
+}
+
+END_TEST
+
+START_TEST (test_arena_context_will_reuse_memory_after_reset) {
+    RoxContext *context = rox_context_create_arena(1, 4);
+    struct tm time = {0};
+    time.tm_year = 120;
+    RoxDynamicValue values[] = {
+            dynamic_value_string_borrowed("user-12345"),
+            dynamic_value_datetime_borrowed(&time),
+            dynamic_value_double(1.5)
+    };
+    for (int round = 0; round < 2; ++round) {
+        rox_context_arena_add(context, "userId", &values[0]);
+        rox_context_arena_add(context, "created", &values[1]);
+        rox_context_arena_add(context, "score", &values[2]);
+        rox_context_arena_add(context, "score", &values[2]);
+
+        RoxDynamicValue *user_id = rox_context_get_symbol(context, symbol_intern("userId"));
+        ck_assert_str_eq("user-12345", rox_dynamic_value_get_string(user_id));
+        ck_assert_ptr_ne(values[0].data.str_value, rox_dynamic_value_get_string(user_id));
+        rox_dynamic_value_free(user_id);
+
+        RoxDynamicValue *created = rox_context_get(context, "created");
+        ck_assert_int_eq(120, rox_dynamic_value_get_datetime(created)->tm_year);
+        rox_dynamic_value_free(created);
+
+        // the first round overflowed the reserved block, the second one fits in it
+        ck_assert_int_eq(round == 0, rox_list_size(context->arena->overflow) > 0);
+        ck_assert_int_eq(3, rox_map_size(context->map));
+        rox_context_arena_reset(context);
+        ck_assert_int_eq(0, rox_map_size(context->map));
+        ck_assert_ptr_null(rox_context_get(context, "userId"));
+    }
+    rox_context_free(context);
+}
+
+END_TEST
+
 ROX_TEST_SUITE(
 // ContextImpTests
         ROX_TEST_CASE(test_context_will_return_value),
@@ -109,5 +213,8 @@ ROX_TEST_SUITE(
 // MergedContextTests
         ROX_TEST_CASE(test_with_null_local_context),
         ROX_TEST_CASE(test_with_null_global_context),
-        ROX_TEST_CASE(test_with_local_and_global_context)
+        ROX_TEST_CASE(test_with_local_and_global_context),
+        ROX_TEST_CASE(test_context_will_return_value_by_symbol),
+        ROX_TEST_CASE(test_flattened_context_will_return_value_by_symbol),
+        ROX_TEST_CASE(test_arena_context_will_reuse_memory_after_reset)
 )
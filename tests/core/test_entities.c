@@ -1,5 +1,6 @@
 #include <check.h>
 #include <core/repositories.h>
+#include <core/epoch.h>
 #include "roxtests.h"
 #include "fixtures.h"
 #include "util.h"
@@ -86,6 +87,61 @@ START_TEST (test_will_return_default_value_when_no_parser_or_condition) {
 
 END_TEST
 
+static bool check_typed_bool(RoxStringBase *variant, const char *condition) {
+    variant_set_condition(variant, condition);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    return variant_get_bool(variant, NULL, &eval_context);
+}
+
+static int check_typed_int(RoxStringBase *variant, const char *condition) {
+    variant_set_condition(variant, condition);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    return variant_get_int(variant, NULL, &eval_context);
+}
+
+static double check_typed_double(RoxStringBase *variant, const char *condition) {
+    variant_set_condition(variant, condition);
+    EvaluationContext eval_context;
+    eval_context_init(&eval_context, variant, NULL);
+    return variant_get_double(variant, NULL, &eval_context);
+}
+
+START_TEST (test_will_evaluate_typed_values_with_context_on_stack) {
+    Parser *parser = parser_create();
+
+    RoxStringBase *flag = variant_create_flag_with_default(true);
+    variant_set_for_evaluation(flag, parser, NULL, NULL);
+    ck_assert(!check_typed_bool(flag, "false"));
+    ck_assert(check_typed_bool(flag, "eq(1, 1)"));
+    ck_assert(!check_typed_bool(flag, "\"xxx\""));
+    ck_assert(check_typed_bool(flag, "undefined"));
+    ck_assert(check_typed_bool(flag, "5"));
+    ck_assert(!check_typed_bool(flag, "unknownOperator(1)"));
+
+    RoxStringBase *int_variant = variant_create_int(3, NULL);
+    variant_set_for_evaluation(int_variant, parser, NULL, NULL);
+    ck_assert_int_eq(check_typed_int(int_variant, "7"), 7);
+    ck_assert_int_eq(check_typed_int(int_variant, "\"12\""), 12);
+    ck_assert_int_eq(check_typed_int(int_variant, "1.5"), 3);
+    ck_assert_int_eq(check_typed_int(int_variant, "\"abc\""), 3);
+
+    RoxStringBase *double_variant = variant_create_double(1.5, NULL);
+    variant_set_for_evaluation(double_variant, parser, NULL, NULL);
+    ck_assert_double_eq(check_typed_double(double_variant, "2.5"), 2.5);
+    ck_assert_double_eq(check_typed_double(double_variant, "7"), 7.0);
+    ck_assert_double_eq(check_typed_double(double_variant, "\"0.25\""), 0.25);
+    ck_assert_double_eq(check_typed_double(double_variant, "true"), 1.5);
+
+    variant_free(flag);
+    variant_free(int_variant);
+    variant_free(double_variant);
+    parser_free(parser);
+}
+
+END_TEST
+
 START_TEST (test_will_expression_value_when_result_not_in_options) {
     FlagTestFixture *ctx = flag_test_fixture_create();
     RoxStringBase *variant = rox_add_string_with_options("name", "1", ROX_LIST_COPY_STR("2", "3"));
@@ -140,6 +196,35 @@ START_TEST (test_will_raise_impression) {
 
 END_TEST
 
+START_TEST (test_will_defer_impressions_until_session_end) {
+    FlagTestFixture *ctx = flag_test_fixture_create();
+    ctx->imp_context_key = "key";
+
+    RoxStringBase *variant = rox_add_string_with_options("name", "1", ROX_LIST_COPY_STR("2", "3"));
+    flag_test_fixture_set_experiments(ctx, ROX_MAP("name", "\"2\""));
+
+    RoxContext *context = rox_context_create_from_map(
+            ROX_MAP(mem_copy_str("key"), rox_dynamic_value_create_int(55)));
+
+    RoxEvalSession *session = rox_eval_session_begin(context);
+    for (int i = 0; i < 2; ++i) {
+        char *value = rox_eval_session_get_string(session, variant);
+        ck_assert_str_eq("2", value);
+        free(value);
+    }
+    flag_test_fixture_check_no_impression(ctx);
+
+    rox_eval_session_end(session);
+    flag_test_fixture_check_impression(ctx, "2");
+    ck_assert(ctx->imp_context_value);
+    ck_assert_int_eq(55, rox_dynamic_value_get_int(ctx->imp_context_value));
+
+    rox_context_free(context);
+    flag_test_fixture_free(ctx);
+}
+
+END_TEST
+
 //
 // FlagTests
 //
@@ -268,6 +353,53 @@ START_TEST (test_will_set_experiment_for_flag_and_will_remove_it) {
 
 END_TEST
 
+START_TEST (test_will_set_only_flags_of_changed_experiments) {
+    FlagRepository *flag_repo = flag_repository_create();
+    ExperimentRepository *exp_repo = experiment_repository_create();
+    Parser *parser = parser_create();
+    ImpressionInvoker *impression_invoker = impression_invoker_create();
+
+    FlagSetter *flag_setter = flag_setter_create(flag_repo, parser, exp_repo, impression_invoker);
+    flag_repository_add_flag(flag_repo, variant_create_flag(), "f1");
+    flag_repository_add_flag(flag_repo, variant_create_flag(), "f2");
+    flag_repository_add_flag(flag_repo, variant_create_flag(), "f3");
+    experiment_repository_set_experiments(exp_repo, ROX_LIST(
+            experiment_model_create("id1", "1", "con1", false, ROX_LIST_COPY_STR("f1"), ROX_EMPTY_SET, "stam"),
+            experiment_model_create("id2", "2", "con2", false, ROX_LIST_COPY_STR("f2"), ROX_EMPTY_SET, "stam"),
+            experiment_model_create("id3", "3", "con3", false, ROX_LIST_COPY_STR("f3"), ROX_EMPTY_SET, "stam")
+    ));
+    flag_setter_set_experiments(flag_setter);
+
+    RoxStringBase *f1 = flag_repository_get_flag(flag_repo, "f1");
+    RoxStringBase *f2 = flag_repository_get_flag(flag_repo, "f2");
+    RoxStringBase *f3 = flag_repository_get_flag(flag_repo, "f3");
+    ExperimentModel *f1_experiment = variant_get_experiment(f1);
+
+    int epoch_token = epoch_read_begin();
+    ConfigurationSnapshot *previous = experiment_repository_get_snapshot(exp_repo);
+    experiment_repository_set_experiments(exp_repo, ROX_LIST(
+            experiment_model_create("id1", "1", "con1", false, ROX_LIST_COPY_STR("f1"), ROX_EMPTY_SET, "stam"),
+            experiment_model_create("id2", "2", "con2b", false, ROX_LIST_COPY_STR("f2"), ROX_EMPTY_SET, "stam")
+    ));
+    flag_setter_set_changed_experiments(flag_setter, previous);
+    epoch_read_end(epoch_token);
+
+    ck_assert_ptr_eq(f1_experiment, variant_get_experiment(f1));
+    ck_assert_str_eq(variant_get_condition(f1), "con1");
+    ck_assert_str_eq(variant_get_condition(f2), "con2b");
+    ck_assert_str_eq(variant_get_experiment(f2)->id, "id2");
+    ck_assert_str_eq(variant_get_condition(f3), "");
+    ck_assert_ptr_null(variant_get_experiment(f3));
+
+    flag_setter_free(flag_setter);
+    flag_repository_free(flag_repo);
+    parser_free(parser);
+    experiment_repository_free(exp_repo);
+    impression_invoker_free(impression_invoker);
+}
+
+END_TEST
+
 START_TEST (test_will_set_flag_without_experiment_and_then_add_experiment) {
     FlagRepository *flag_repo = flag_repository_create();
     ExperimentRepository *exp_repo = experiment_repository_create();
@@ -357,10 +489,12 @@ ROX_TEST_SUITE(
         ROX_TEST_CASE(test_will_add_default_to_options_if_not_exists),
         ROX_TEST_CASE(test_will_set_name),
         ROX_TEST_CASE(test_will_return_default_value_when_no_parser_or_condition),
+        ROX_TEST_CASE(test_will_evaluate_typed_values_with_context_on_stack),
         ROX_TEST_CASE(test_will_expression_value_when_result_not_in_options),
         ROX_TEST_CASE(test_will_return_value_when_on_evaluation),
         ROX_TEST_CASE(test_will_use_context),
         ROX_TEST_CASE(test_will_raise_impression),
+        ROX_TEST_CASE(test_will_defer_impressions_until_session_end),
 // FlagTests
         ROX_TEST_CASE(test_flag_without_default_value),
         ROX_TEST_CASE(test_flag_with_default_value),
@@ -368,6 +502,7 @@ ROX_TEST_SUITE(
         ROX_TEST_CASE(test_will_set_flag_data),
         ROX_TEST_CASE(test_will_not_set_for_other_flag),
         ROX_TEST_CASE(test_will_set_experiment_for_flag_and_will_remove_it),
+        ROX_TEST_CASE(test_will_set_only_flags_of_changed_experiments),
         ROX_TEST_CASE(test_will_set_flag_without_experiment_and_then_add_experiment),
         ROX_TEST_CASE(test_will_set_data_for_added_flag)
 )
\ No newline at end of file
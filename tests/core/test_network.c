@@ -1,5 +1,7 @@
 #include <check.h>
+#include <curl/curl.h>
 #include <assert.h>
+#include <string.h>
 #include <core/consts.h>
 #include "roxtests.h"
 #include "core/network.h"
@@ -131,6 +133,77 @@ START_TEST (test_will_return_cdn_data_when_successful) {
 
 END_TEST
 
+START_TEST (test_will_return_not_modified_when_cdn_etag_matches) {
+    RequestTestContext *ctx = _request_test_context_create(
+            ROX_MAP(
+                    "app_key", ROX_COPY("123"),
+                    "api_version", ROX_COPY("4.0.0"),
+                    "distinct_id", ROX_COPY("id")
+            ), "buid");
+    ctx->request->status_to_return_to_get = 200;
+    ctx->request->data_to_return_to_get = "{\"a\": \"harti\"}";
+    ctx->request->etag_to_return_to_get = "\"v1\"";
+    ConfigurationFetcher *fetcher = _test_create_conf_fetcher(ctx);
+    ConfigurationFetchResult *result = configuration_fetcher_fetch(fetcher);
+    ck_assert_ptr_nonnull(result);
+    ck_assert(!result->not_modified);
+    ck_assert_ptr_null(ctx->request->last_get_if_none_match);
+    configuration_fetch_result_free(result);
+
+    ctx->request->status_to_return_to_get = 304;
+    ctx->request->data_to_return_to_get = NULL;
+    result = configuration_fetcher_fetch(fetcher);
+    ck_assert_ptr_nonnull(result);
+    ck_assert(result->not_modified);
+    ck_assert_ptr_null(result->parsed_data);
+    ck_assert_int_eq(CONFIGURATION_SOURCE_CDN, result->source);
+    ck_assert_str_eq("\"v1\"", ctx->request->last_get_if_none_match);
+    ck_assert_int_eq(0, ctx->request->times_post_sent);
+    ck_assert_int_eq(0, ctx->times_invoker_called);
+    configuration_fetch_result_free(result);
+
+    configuration_fetcher_reset_validators(fetcher);
+    ctx->request->status_to_return_to_get = 200;
+    ctx->request->data_to_return_to_get = "{\"a\": \"harti\"}";
+    result = configuration_fetcher_fetch(fetcher);
+    ck_assert(!result->not_modified);
+    ck_assert_ptr_null(ctx->request->last_get_if_none_match);
+    configuration_fetch_result_free(result);
+
+    configuration_fetcher_free(fetcher);
+    _request_test_context_free(ctx);
+}
+
+END_TEST
+
+START_TEST (test_will_digest_fetched_payload) {
+    RequestTestContext *ctx = _request_test_context_create(
+            ROX_MAP(
+                    "app_key", ROX_COPY("123"),
+                    "api_version", ROX_COPY("4.0.0"),
+                    "distinct_id", ROX_COPY("id")
+            ), "buid");
+    ctx->request->status_to_return_to_get = 200;
+    ctx->request->data_to_return_to_get = "{\"a\": \"harti\"}";
+    ConfigurationFetcher *fetcher = _test_create_conf_fetcher(ctx);
+    ConfigurationFetchResult *first = configuration_fetcher_fetch(fetcher);
+    ConfigurationFetchResult *same = configuration_fetcher_fetch(fetcher);
+    ctx->request->data_to_return_to_get = "{\"a\": \"harta\"}";
+    ConfigurationFetchResult *changed = configuration_fetcher_fetch(fetcher);
+    ck_assert(first->has_digest);
+    ck_assert(same->has_digest);
+    ck_assert(changed->has_digest);
+    ck_assert(memcmp(first->digest, same->digest, ROX_CONFIGURATION_DIGEST_SIZE) == 0);
+    ck_assert(memcmp(first->digest, changed->digest, ROX_CONFIGURATION_DIGEST_SIZE) != 0);
+    configuration_fetch_result_free(changed);
+    configuration_fetch_result_free(same);
+    configuration_fetch_result_free(first);
+    configuration_fetcher_free(fetcher);
+    _request_test_context_free(ctx);
+}
+
+END_TEST
+
 START_TEST (test_will_return_null_when_cdn_fails_with_exception) {
     RequestTestContext *ctx = _request_test_context_create(
             ROX_MAP(
@@ -403,9 +476,34 @@ START_TEST (test_will_return_null_when_roxy_fails_with_http_status) {
 
 END_TEST
 
+//
+// SharedCacheTests
+//
+
+START_TEST (test_will_share_cache_until_last_request_is_freed) {
+    ck_assert_ptr_eq(NULL, network_share_get());
+    Request *request = request_create(NULL);
+    Request *another = request_create(NULL);
+    void *share = network_share_get();
+    ck_assert_ptr_ne(NULL, share);
+
+    request_free(request);
+    ck_assert_ptr_eq(share, network_share_get());
+    CURL *curl = curl_easy_init();
+    ck_assert(network_share_attach(curl));
+    curl_easy_cleanup(curl);
+
+    request_free(another);
+    ck_assert_ptr_eq(NULL, network_share_get());
+}
+
+END_TEST
+
 ROX_TEST_SUITE(
 // ConfigurationFetcherRoxyTests
         ROX_TEST_CASE(test_will_return_cdn_data_when_successful),
+        ROX_TEST_CASE(test_will_return_not_modified_when_cdn_etag_matches),
+        ROX_TEST_CASE(test_will_digest_fetched_payload),
         ROX_TEST_CASE(test_will_return_null_when_cdn_fails_with_exception),
         ROX_TEST_CASE(test_will_return_null_when_cdn_succeed_with_empty_response),
         ROX_TEST_CASE(test_will_return_null_when_cdn_succeed_with_not_json_response),
@@ -417,5 +515,7 @@ ROX_TEST_SUITE(
 // ConfigurationFetcherTests
         ROX_TEST_CASE(test_will_return_data_when_successful),
         ROX_TEST_CASE(test_will_return_null_when_roxy_fails_with_exception),
-        ROX_TEST_CASE(test_will_return_null_when_roxy_fails_with_http_status)
+        ROX_TEST_CASE(test_will_return_null_when_roxy_fails_with_http_status),
+// SharedCacheTests
+        ROX_TEST_CASE(test_will_share_cache_until_last_request_is_freed)
 )
@@ -1,6 +1,8 @@
 #include <check.h>
+#include <pthread.h>
 #include "roxtests.h"
 #include "core/repositories.h"
+#include "core/epoch.h"
 #include "util.h"
 
 START_TEST (test_custom_property_repo_will_return_null_when_prop_not_found) {
@@ -104,6 +106,178 @@ START_TEST (test_experiment_repository_will_return_when_found) {
 
 END_TEST
 
+START_TEST (test_experiment_repository_will_return_first_experiment_with_flag) {
+    RoxList *exp = ROX_LIST(
+            experiment_model_create("1", "1", "1", false, ROX_LIST(ROX_COPY("a"), ROX_COPY("b")), ROX_EMPTY_SET,
+                                    "stam"),
+            experiment_model_create("2", "2", "2", false, ROX_LIST(ROX_COPY("b"), ROX_COPY("c")), ROX_EMPTY_SET,
+                                    "stam"));
+    ExperimentRepository *repo = experiment_repository_create();
+    experiment_repository_set_experiments(repo, exp);
+    ck_assert_str_eq(experiment_repository_get_experiment_by_flag(repo, "a")->id, "1");
+    ck_assert_str_eq(experiment_repository_get_experiment_by_flag(repo, "b")->id, "1");
+    ck_assert_str_eq(experiment_repository_get_experiment_by_flag(repo, "c")->id, "2");
+
+    experiment_repository_set_experiments(repo, ROX_LIST(
+            experiment_model_create("3", "3", "3", false, ROX_LIST(ROX_COPY("c")), ROX_EMPTY_SET, "stam")));
+    ck_assert_ptr_null(experiment_repository_get_experiment_by_flag(repo, "a"));
+    ck_assert_str_eq(experiment_repository_get_experiment_by_flag(repo, "c")->id, "3");
+
+    experiment_repository_set_experiments(repo, ROX_EMPTY_LIST);
+    ck_assert_ptr_null(experiment_repository_get_experiment_by_flag(repo, "c"));
+    experiment_repository_free(repo);
+}
+
+END_TEST
+
+START_TEST (test_target_group_repository_will_return_target_group_by_id) {
+    TargetGroupRepository *repo = target_group_repository_create();
+    ck_assert_ptr_null(target_group_repository_get_target_group(repo, "1"));
+    target_group_repository_set_target_groups(repo, ROX_LIST(
+            target_group_model_create("1", "true"),
+            target_group_model_create("2", "false"),
+            target_group_model_create("1", "stam")));
+    TargetGroupModel *target_group = target_group_repository_get_target_group(repo, "1");
+    ck_assert_ptr_nonnull(target_group);
+    ck_assert_str_eq(target_group->condition, "true");
+    ck_assert_str_eq(target_group_repository_get_target_group(repo, "2")->condition, "false");
+    ck_assert_ptr_null(target_group_repository_get_target_group(repo, "3"));
+
+    // the previous target groups are still alive until the end of the read section
+    int epoch_token = epoch_read_begin();
+    target_group = target_group_repository_get_target_group(repo, "1");
+    target_group_repository_set_target_groups(repo, ROX_LIST(target_group_model_create("3", "true")));
+    ck_assert_str_eq(target_group->condition, "true");
+    epoch_read_end(epoch_token);
+    ck_assert_ptr_null(target_group_repository_get_target_group(repo, "1"));
+    ck_assert_str_eq(target_group_repository_get_target_group(repo, "3")->condition, "true");
+    target_group_repository_free(repo);
+}
+
+END_TEST
+
+START_TEST (test_configuration_repository_will_swap_experiments_and_target_groups_together) {
+    ConfigurationRepository *configuration = configuration_repository_create();
+    ExperimentRepository *experiments = experiment_repository_create_with_configuration(configuration);
+    TargetGroupRepository *target_groups = target_group_repository_create_with_configuration(configuration);
+    ck_assert_int_eq(configuration_snapshot_get_version(configuration_repository_get_snapshot(configuration)), 0);
+
+    configuration_repository_set_configuration(
+            configuration,
+            ROX_LIST(experiment_model_create("1", "1", "isInTargetGroup(\"tg\")", false,
+                                            ROX_LIST(ROX_COPY("a")), ROX_EMPTY_SET, "stam")),
+            ROX_LIST(target_group_model_create("tg", "true")));
+    int epoch_token = epoch_read_begin();
+    ConfigurationSnapshot *snapshot = configuration_repository_get_snapshot(configuration);
+    ck_assert_int_eq(configuration_snapshot_get_version(snapshot), 1);
+    ck_assert_ptr_eq(experiment_repository_get_experiment_by_flag(experiments, "a"),
+                     configuration_snapshot_get_experiment_by_flag(snapshot, "a"));
+    ck_assert_ptr_eq(target_group_repository_get_target_group(target_groups, "tg"),
+                     configuration_snapshot_get_target_group(snapshot, "tg"));
+
+    // the snapshot being read is not affected by the updates
+    target_group_repository_set_target_groups(target_groups, ROX_EMPTY_LIST);
+    ck_assert_ptr_nonnull(configuration_snapshot_get_target_group(snapshot, "tg"));
+    ck_assert_ptr_null(target_group_repository_get_target_group(target_groups, "tg"));
+    ck_assert_str_eq(experiment_repository_get_experiment_by_flag(experiments, "a")->id, "1");
+    epoch_read_end(epoch_token);
+
+    ck_assert_int_eq(configuration_snapshot_get_version(configuration_repository_get_snapshot(configuration)), 2);
+    ck_assert_int_eq(rox_list_size(configuration_snapshot_get_experiments(
+            configuration_repository_get_snapshot(configuration))), 1);
+    ck_assert_int_eq(rox_list_size(configuration_snapshot_get_target_groups(
+            configuration_repository_get_snapshot(configuration))), 0);
+
+    target_group_repository_free(target_groups);
+    experiment_repository_free(experiments);
+    configuration_repository_free(configuration);
+}
+
+END_TEST
+
+START_TEST (test_configuration_repository_will_share_unchanged_models) {
+    ConfigurationRepository *configuration = configuration_repository_create();
+    ExperimentRepository *experiments = experiment_repository_create_with_configuration(configuration);
+    TargetGroupRepository *target_groups = target_group_repository_create_with_configuration(configuration);
+    configuration_repository_set_configuration(
+            configuration,
+            ROX_LIST(experiment_model_create("1", "1", "true", false,
+                                            ROX_LIST(ROX_COPY("a")), ROX_EMPTY_SET, "stam")),
+            ROX_LIST(target_group_model_create("tg", "true")));
+    ExperimentModel *experiment = experiment_repository_get_experiment_by_flag(experiments, "a");
+
+    // the experiments are not copied when only the target groups change, and the other way around
+    target_group_repository_set_target_groups(target_groups, ROX_LIST(target_group_model_create("tg", "false")));
+    epoch_synchronize();
+    ck_assert_ptr_eq(experiment, experiment_repository_get_experiment_by_flag(experiments, "a"));
+    ck_assert_str_eq(experiment->id, "1");
+    TargetGroupModel *target_group = target_group_repository_get_target_group(target_groups, "tg");
+    ck_assert_str_eq(target_group->condition, "false");
+
+    experiment_repository_set_experiments(experiments, ROX_EMPTY_LIST);
+    epoch_synchronize();
+    ck_assert_ptr_null(experiment_repository_get_experiment_by_flag(experiments, "a"));
+    ck_assert_ptr_eq(target_group, target_group_repository_get_target_group(target_groups, "tg"));
+    ck_assert_str_eq(target_group->condition, "false");
+    ck_assert_int_eq(configuration_snapshot_get_version(configuration_repository_get_snapshot(configuration)), 3);
+
+    target_group_repository_free(target_groups);
+    experiment_repository_free(experiments);
+    configuration_repository_free(configuration);
+}
+
+END_TEST
+
+typedef struct SnapshotReaderContext {
+    ConfigurationRepository *configuration;
+    bool stopped;
+    int reads;
+} SnapshotReaderContext;
+
+static void *snapshot_reader_thread(void *arg) {
+    SnapshotReaderContext *ctx = arg;
+    while (!__atomic_load_n(&ctx->stopped, __ATOMIC_SEQ_CST)) {
+        int epoch_token = epoch_read_begin();
+        ConfigurationSnapshot *snapshot = configuration_repository_get_snapshot(ctx->configuration);
+        ExperimentModel *experiment = configuration_snapshot_get_experiment_by_flag(snapshot, "a");
+        TargetGroupModel *target_group = configuration_snapshot_get_target_group(snapshot, "tg");
+        if (experiment && target_group) {
+            // both come from the same configuration
+            ck_assert_str_eq(experiment->id, target_group->condition);
+        }
+        epoch_read_end(epoch_token);
+        ++ctx->reads;
+    }
+    return NULL;
+}
+
+START_TEST (test_configuration_repository_will_be_read_while_updated) {
+    ConfigurationRepository *configuration = configuration_repository_create();
+    SnapshotReaderContext ctx = {configuration, false, 0};
+    pthread_t threads[4];
+    for (int i = 0; i < 4; ++i) {
+        pthread_create(&threads[i], NULL, &snapshot_reader_thread, &ctx);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        char *version = mem_int_to_str(i);
+        configuration_repository_set_configuration(
+                configuration,
+                ROX_LIST(experiment_model_create(version, "1", "true", false,
+                                                 ROX_LIST(ROX_COPY("a")), ROX_EMPTY_SET, "stam")),
+                ROX_LIST(target_group_model_create("tg", version)));
+        free(version);
+    }
+    __atomic_store_n(&ctx.stopped, true, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < 4; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    epoch_synchronize();
+    ck_assert_int_eq(configuration_snapshot_get_version(configuration_repository_get_snapshot(configuration)), 1000);
+    configuration_repository_free(configuration);
+}
+
+END_TEST
+
 START_TEST (test_flag_repository_will_return_null_when_flag_not_found) {
     FlagRepository *repo = flag_repository_create();
     ck_assert_ptr_null(flag_repository_get_flag(repo, "harti"));
@@ -150,6 +324,11 @@ ROX_TEST_SUITE(
         ROX_TEST_CASE(test_custom_property_repo_will_raise_prop_added_event),
         ROX_TEST_CASE(test_experiment_repository_will_return_null_when_not_found),
         ROX_TEST_CASE(test_experiment_repository_will_return_when_found),
+        ROX_TEST_CASE(test_experiment_repository_will_return_first_experiment_with_flag),
+        ROX_TEST_CASE(test_target_group_repository_will_return_target_group_by_id),
+        ROX_TEST_CASE(test_configuration_repository_will_swap_experiments_and_target_groups_together),
+        ROX_TEST_CASE(test_configuration_repository_will_share_unchanged_models),
+        ROX_TEST_CASE(test_configuration_repository_will_be_read_while_updated),
         ROX_TEST_CASE(test_flag_repository_will_return_null_when_flag_not_found),
         ROX_TEST_CASE(test_flag_repository_will_add_flag_and_set_name),
         ROX_TEST_CASE(test_flag_repository_will_raise_flag_added_event)
@@ -20,6 +20,7 @@ typedef struct ParserExtensionsTestContext {
     ImpressionInvoker *impression_invoker;
     RoxList *impressions;
     const char *property_context_key;
+    int property_generator_calls;
 } ParserExtensionsTestContext;
 
 static RoxDynamicValue *parser_extensions_custom_property_generator(void *target, RoxContext *context) {
@@ -29,6 +30,13 @@ static RoxDynamicValue *parser_extensions_custom_property_generator(void *target
     return rox_context_get(context, test_context->property_context_key);
 }
 
+static RoxDynamicValue *parser_extensions_counting_property_generator(void *target, RoxContext *context) {
+    ParserExtensionsTestContext *test_context = (ParserExtensionsTestContext *) target;
+    assert(test_context);
+    ++test_context->property_generator_calls;
+    return rox_dynamic_value_create_string_copy("test");
+}
+
 static void parser_extensions_impression_handler(
         void *target,
         RoxReportingValue *value,
@@ -789,6 +797,43 @@ START_TEST (test_dynamic_rule_return_unsupported_type) {
 
 END_TEST
 
+START_TEST (test_computed_property_and_target_group_are_evaluated_once_per_evaluation) {
+    ParserExtensionsTestContext *context = parser_extensions_test_context_create();
+    custom_property_repository_add_custom_property(
+            context->custom_property_repository,
+            custom_property_create(
+                    "CountedProperty",
+                    &ROX_CUSTOM_PROPERTY_TYPE_STRING,
+                    context, &parser_extensions_counting_property_generator));
+    target_group_repository_set_target_groups(context->target_groups_repository, ROX_LIST(
+            target_group_model_create("tg", "eq(\"test\", property(\"CountedProperty\"))")));
+
+    EvaluationContext *eval_context = eval_context_create(NULL, NULL);
+    const char *expression = "and(and(isInTargetGroup(\"tg\"), isInTargetGroup(\"tg\")), "
+                             "eq(property(\"CountedProperty\"), property(\"CountedProperty\")))";
+    EvaluationResult *result = parser_evaluate_expression(context->parser, expression, eval_context);
+    ck_assert(*result_get_boolean(result));
+    result_free(result);
+    ck_assert_int_eq(1, context->property_generator_calls);
+
+    // the next evaluation computes the values again
+    result = parser_evaluate_expression(context->parser, expression, eval_context);
+    ck_assert(*result_get_boolean(result));
+    result_free(result);
+    ck_assert_int_eq(2, context->property_generator_calls);
+
+    // without an evaluation context, nothing is memoized
+    result = parser_evaluate_expression(context->parser, expression, NULL);
+    ck_assert(*result_get_boolean(result));
+    result_free(result);
+    ck_assert_int_eq(6, context->property_generator_calls);
+
+    eval_context_free(eval_context);
+    parser_extensions_test_context_free(context);
+}
+
+END_TEST
+
 ROX_TEST_SUITE(
         ROX_TEST_CASE(test_custom_property_with_simple_value),
         ROX_TEST_CASE(test_is_in_percentage_range),
@@ -819,5 +864,6 @@ ROX_TEST_SUITE(
         ROX_TEST_CASE(test_custom_dynamic_rule),
         ROX_TEST_CASE(test_dynamic_rule_returns_null),
         ROX_TEST_CASE(test_dynamic_rule_returns_supported_type),
-        ROX_TEST_CASE(test_dynamic_rule_return_unsupported_type)
+        ROX_TEST_CASE(test_dynamic_rule_return_unsupported_type),
+        ROX_TEST_CASE(test_computed_property_and_target_group_are_evaluated_once_per_evaluation)
 )
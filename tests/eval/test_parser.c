@@ -3,6 +3,8 @@
 #include <util.h>
 #include <core/repositories.h>
 #include <time.h>
+#include <string.h>
+#include <pcre2.h>
 
 #include "roxtests.h"
 #include "eval/extensions.h"
@@ -71,10 +73,68 @@ START_TEST (test_token_type) {
 
 END_TEST
 
+// The token classification as it was done with PCRE2 before the hand-written lexer.
+static ParserTokenType regex_get_token_type_from_token(const char *token) {
+    if (str_matches(token, "^\"((\\\\.)|[^\\\\\\\\\"])*\"$", PCRE2_CASELESS)) {
+        return TokenTypeString;
+    }
+    if (str_matches(token, "^[\\-]{0,1}\\d+[\\.]\\d+|[\\-]{0,1}\\d+$", PCRE2_CASELESS)) {
+        return TokenTypeNumber;
+    }
+    if (str_matches(token, "^true|false$", PCRE2_CASELESS)) {
+        return TokenTypeBool;
+    }
+    if (str_matches(token, "undefined", PCRE2_CASELESS)) {
+        return TokenTypeUndefined;
+    }
+    return TokenTypeNotAType;
+}
+
+static void assert_token_type_matches_regex(const char *token) {
+    ParserTokenType expected = regex_get_token_type_from_token(token);
+    ck_assert_msg(expected == get_token_type_from_token(token), "token type mismatch for '%s'", token);
+}
+
+static void assert_expression_token_types_match_regex(const char *expr) {
+    static const char *delimiters = "{}[]():, \t\r\n\"";
+    char token[1024];
+    size_t length = strlen(expr);
+    ck_assert(length < sizeof(token));
+    assert_token_type_matches_regex(expr);
+    for (size_t start = 0; start < length;) {
+        size_t token_length = strcspn(expr + start, delimiters);
+        if (token_length > 0) {
+            memcpy(token, expr + start, token_length);
+            token[token_length] = '\0';
+            assert_token_type_matches_regex(token);
+        }
+        start += token_length + 1;
+    }
+}
+
+static EvaluationResult *eval_expression(Parser *parser, const char *expr) {
+    assert_expression_token_types_match_regex(expr);
+    return parser_evaluate_expression(parser, expr, NULL);
+}
+
+START_TEST (test_token_type_matches_regex) {
+    const char *tokens[] = {
+            "", "\"\"", "\"", "\"a\"b\"", "\"a\\\"\"", "\"a\\\"", "\"a\"\n", "\"a\\\n\"", "\"\n\"",
+            "0", "-", "-0", "--1", "1.", ".1", "1.2.3", "1.5abc", "-1.5x", "abc123", "abc123\n", "12\n\n", "1e5",
+            "TRUE", "True", "truex", "xtrue", "FALSE", "xfalse", "falsex", "xfalse\n", "tru", "alse",
+            "Undefined", "xUNDEFINEDx", "undefine", "null", "stam", "\xc3\xa9", "\xf0\xa9\xb8\xbd" "1"
+    };
+    for (size_t i = 0; i < sizeof(tokens) / sizeof(tokens[0]); ++i) {
+        assert_token_type_matches_regex(tokens[i]);
+    }
+}
+
+END_TEST
+
 void eval_assert_string_result(const char *expected_result, Parser *parser, const char *expr) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     char *str = result_get_string(result);
     if (expected_result) {
@@ -88,7 +148,7 @@ void eval_assert_string_result(const char *expected_result, Parser *parser, cons
 void eval_assert_boolean_result(Parser *parser, const char *expr, bool expected_result) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     bool *value = result_get_boolean(result);
     ck_assert(value);
@@ -99,7 +159,7 @@ void eval_assert_boolean_result(Parser *parser, const char *expr, bool expected_
 void eval_assert_boolean_result_null(Parser *parser, const char *expr) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     bool *value = result_get_boolean(result);
     ck_assert_ptr_null(value);
@@ -109,7 +169,7 @@ void eval_assert_boolean_result_null(Parser *parser, const char *expr) {
 void eval_assert_int_result(int expected_result, Parser *parser, const char *expr) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     int *value = result_get_int(result);
     assert(value);
@@ -120,7 +180,7 @@ void eval_assert_int_result(int expected_result, Parser *parser, const char *exp
 void eval_assert_int_result_null(Parser *parser, const char *expr) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     int *value = result_get_int(result);
     ck_assert_ptr_null(value);
@@ -130,7 +190,7 @@ void eval_assert_int_result_null(Parser *parser, const char *expr) {
 void eval_assert_double_result(double expected_result, Parser *parser, const char *expr) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     double *value = result_get_double(result);
     assert(value);
@@ -141,7 +201,7 @@ void eval_assert_double_result(double expected_result, Parser *parser, const cha
 void eval_assert_double_result_null(Parser *parser, const char *expr) {
     assert(parser);
     assert(expr);
-    EvaluationResult *result = parser_evaluate_expression(parser, expr, NULL);
+    EvaluationResult *result = eval_expression(parser, expr);
     ck_assert(result);
     double *value = result_get_double(result);
     ck_assert_ptr_null(value);
@@ -473,9 +533,132 @@ START_TEST (test_ts_to_num) {
 
 END_TEST
 
+static void parser_operator_answer(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+    rox_stack_push_int(stack, 42);
+}
+
+START_TEST (test_compiled_expressions_cache) {
+    Parser *parser = parser_create();
+    ck_assert_int_eq(0, parser_get_compiled_expressions_count(parser));
+
+    eval_assert_boolean_result(parser, "eq(\"la la\", \"la la\")", true);
+    eval_assert_boolean_result(parser, "eq(\"la la\", \"la la\")", true);
+    eval_assert_string_result("stamstam2", parser, "concat(\"stam\",\"stam2\")");
+    ck_assert_int_eq(2, parser_get_compiled_expressions_count(parser));
+
+    parser_clear_compiled_expressions(parser);
+    ck_assert_int_eq(0, parser_get_compiled_expressions_count(parser));
+    eval_assert_boolean_result(parser, "eq(\"la la\", \"la la\")", true);
+    ck_assert_int_eq(1, parser_get_compiled_expressions_count(parser));
+
+    // operators added later must be recognized by the expressions compiled before
+    eval_assert_string_result(NULL, parser, "answer");
+    parser_add_operator(parser, "answer", NULL, &parser_operator_answer);
+    ck_assert_int_eq(0, parser_get_compiled_expressions_count(parser));
+    eval_assert_int_result(42, parser, "answer");
+
+    parser_free(parser);
+}
+
+END_TEST
+
+START_TEST (test_compiled_expressions_cache_is_bounded) {
+    Parser *parser = parser_create();
+    for (int i = 0; i < ROX_PARSER_MAX_COMPILED_EXPRESSIONS + 10; ++i) {
+        char *expression = mem_str_format("eq(%d, %d)", i, i);
+        eval_assert_boolean_result(parser, expression, true);
+        free(expression);
+    }
+    ck_assert_int_eq(ROX_PARSER_MAX_COMPILED_EXPRESSIONS, parser_get_compiled_expressions_count(parser));
+
+    // the expressions over the bound are still evaluated, just not cached, including
+    // the ones returning the constants of their program
+    eval_assert_boolean_result(parser, "eq(\"over\", \"over\")", true);
+    eval_assert_string_result("over", parser, "ifThen(eq(1, 1), \"over\", \"under\")");
+    ck_assert_int_eq(ROX_PARSER_MAX_COMPILED_EXPRESSIONS, parser_get_compiled_expressions_count(parser));
+
+    parser_clear_compiled_expressions(parser);
+    eval_assert_boolean_result(parser, "eq(\"over\", \"over\")", true);
+    ck_assert_int_eq(1, parser_get_compiled_expressions_count(parser));
+
+    // the expressions of a configuration are all cached, and don't count towards the bound
+    RoxList *expressions = rox_list_create();
+    for (int i = 0; i < ROX_PARSER_MAX_COMPILED_EXPRESSIONS + 10; ++i) {
+        rox_list_add(expressions, mem_str_format("eq(%d, %d)", i, i));
+    }
+    parser_set_compiled_expressions(parser, expressions);
+    rox_list_free_cb(expressions, &free);
+    ck_assert_int_eq(ROX_PARSER_MAX_COMPILED_EXPRESSIONS + 10, parser_get_compiled_expressions_count(parser));
+    eval_assert_boolean_result(parser, "eq(\"over\", \"over\")", true);
+    ck_assert_int_eq(ROX_PARSER_MAX_COMPILED_EXPRESSIONS + 11, parser_get_compiled_expressions_count(parser));
+    parser_free(parser);
+}
+
+END_TEST
+
+static void parser_operator_sum(void *target, Parser *parser, CoreStack *stack, EvaluationContext *eval_context) {
+    StackItem *item1 = rox_stack_pop(stack);
+    StackItem *item2 = rox_stack_pop(stack);
+    rox_stack_push_int(stack, rox_stack_get_int(item1) + rox_stack_get_int(item2));
+}
+
+START_TEST (test_stack_operator_evaluation) {
+    Parser *parser = parser_create();
+    parser_add_operator(parser, "sum", NULL, &parser_operator_sum);
+
+    eval_assert_int_result(3, parser, "sum(1, 2)");
+    eval_assert_boolean_result(parser, "eq(3, sum(1, 2))", true);
+    eval_assert_boolean_result(parser, "eq(sum(1, sum(2, 3)), 6)", true);
+    eval_assert_int_result(6, parser, "ifThen(eq(\"a\", \"a\"), sum(1, sum(2, 3)), \"b\")");
+    eval_assert_string_result("b", parser, "ifThen(eq(\"a\", \"c\"), sum(1, sum(2, 3)), \"b\")");
+
+    parser_free(parser);
+}
+
+END_TEST
+
+static void parser_operator_count(void *target, Parser *parser, VmStack *stack, EvaluationContext *eval_context) {
+    int *count = (int *) target;
+    VmValue value = vm_stack_pop(stack);
+    ++*count;
+    vm_stack_push(stack, value);
+}
+
+START_TEST (test_short_circuit_evaluation) {
+    Parser *parser = parser_create();
+    int count = 0;
+    parser_add_native_operator(parser, "count", 1, &count, &parser_operator_count);
+    parser_add_operator(parser, "sum", NULL, &parser_operator_sum);
+
+    eval_assert_boolean_result(parser, "and(false, count(true))", false);
+    eval_assert_boolean_result(parser, "or(true, count(false))", true);
+    eval_assert_string_result("a", parser, "ifThen(true, \"a\", count(\"b\"))");
+    eval_assert_string_result("b", parser, "ifThen(false, count(\"a\"), \"b\")");
+    eval_assert_boolean_result(parser, "and(eq(1, 2), or(count(true), count(true)))", false);
+    ck_assert_int_eq(0, count);
+
+    eval_assert_boolean_result(parser, "and(true, count(true))", true);
+    eval_assert_boolean_result(parser, "and(count(true), \"true\")", false);
+    eval_assert_boolean_result(parser, "or(count(false), count(1))", false);
+    eval_assert_boolean_result(parser, "or(false, count(true))", true);
+    eval_assert_string_result("b", parser, "ifThen(count(\"true\"), \"a\", count(\"b\"))");
+    ck_assert_int_eq(7, count);
+
+    // operands with an unknown arity are evaluated as before
+    eval_assert_boolean_result(parser, "and(false, eq(3, sum(1, count(2))))", false);
+    eval_assert_int_result(3, parser, "ifThen(true, sum(1, count(2)), count(\"b\"))");
+    eval_assert_boolean_result(parser, "and(true, count(true), false)", true);
+    ck_assert_int_eq(11, count);
+
+    parser_free(parser);
+}
+
+END_TEST
+
 ROX_TEST_SUITE(
         ROX_TEST_CASE(test_simple_tokenization),
         ROX_TEST_CASE(test_token_type),
+        ROX_TEST_CASE(test_token_type_matches_regex),
         ROX_TEST_CASE(test_simple_expression_evaluation),
         ROX_TEST_CASE(test_numeq_expressions_evaluation),
         ROX_TEST_CASE(test_eq_expressions_evaluation),
@@ -490,5 +673,9 @@ ROX_TEST_SUITE(
         ROX_TEST_CASE(test_if_then_expression_evaluation_int_number),
         ROX_TEST_CASE(test_if_then_expression_evaluation_double_number),
         ROX_TEST_CASE(test_if_then_expression_evaluation_boolean),
-        ROX_TEST_CASE(test_in_array)
+        ROX_TEST_CASE(test_in_array),
+        ROX_TEST_CASE(test_compiled_expressions_cache),
+        ROX_TEST_CASE(test_compiled_expressions_cache_is_bounded),
+        ROX_TEST_CASE(test_stack_operator_evaluation),
+        ROX_TEST_CASE(test_short_circuit_evaluation)
 )
@@ -0,0 +1,142 @@
+#include <check.h>
+
+#include "eval/vm.h"
+#include "collections.h"
+#include "util.h"
+#include "roxtests.h"
+
+START_TEST (test_will_push_into_vm_stack_inline) {
+
+    VmStack stack;
+    vm_stack_init(&stack);
+    vm_stack_push(&stack, vm_value_int(5));
+    vm_stack_push(&stack, vm_value_double(5.5));
+    vm_stack_push(&stack, vm_value_boolean(true));
+    ck_assert_ptr_eq(stack.values, stack.inline_values);
+    ck_assert_int_eq(stack.size, 3);
+
+    VmValue value = vm_stack_pop(&stack);
+    ck_assert_int_eq(value.type, VmValueTypeBoolean);
+    ck_assert(value.data.boolean_value);
+
+    value = vm_stack_pop(&stack);
+    ck_assert(vm_value_is_numeric(&value));
+    ck_assert_double_eq(vm_value_get_number(&value), 5.5);
+
+    value = vm_stack_pop(&stack);
+    ck_assert_int_eq(value.type, VmValueTypeInt);
+    ck_assert_double_eq(vm_value_get_number(&value), 5.0);
+
+    value = vm_stack_pop(&stack);
+    ck_assert_int_eq(value.type, VmValueTypeNull);
+
+    vm_stack_release(&stack);
+}
+
+END_TEST
+
+START_TEST (test_will_grow_vm_stack) {
+
+    VmStack stack;
+    vm_stack_init(&stack);
+    for (int i = 0; i < ROX_VM_STACK_INLINE_CAPACITY * 3; ++i) {
+        vm_stack_push(&stack, vm_value_string_ptr(mem_int_to_str(i)));
+    }
+    ck_assert_ptr_ne(stack.values, stack.inline_values);
+    ck_assert_int_eq(stack.size, ROX_VM_STACK_INLINE_CAPACITY * 3);
+
+    VmValue value = vm_stack_pop(&stack);
+    ck_assert_int_eq(value.type, VmValueTypeString);
+    ck_assert_str_eq(value.data.str_value, "95");
+    vm_value_release(&value);
+
+    vm_stack_release(&stack);
+    ck_assert_ptr_eq(stack.values, stack.inline_values);
+    ck_assert_int_eq(stack.size, 0);
+}
+
+END_TEST
+
+START_TEST (test_will_borrow_vm_value) {
+
+    VmValue owned = vm_value_string_ptr(mem_copy_str("stam"));
+    VmValue borrowed = vm_value_borrow(&owned);
+    ck_assert(!borrowed.owned);
+    ck_assert_ptr_eq(borrowed.data.str_value, owned.data.str_value);
+    vm_value_release(&borrowed);
+    ck_assert_str_eq(owned.data.str_value, "stam");
+    vm_value_release(&owned);
+}
+
+END_TEST
+
+START_TEST (test_will_convert_vm_value_from_and_to_dynamic_value) {
+
+    RoxList *list = rox_list_create();
+    rox_list_add(list, rox_dynamic_value_create_int(1));
+    rox_list_add(list, rox_dynamic_value_create_string_copy("2"));
+    RoxDynamicValue *dynamic_value = rox_dynamic_value_create_list(list);
+
+    VmValue value = vm_value_from_dynamic_value(dynamic_value);
+    ck_assert_int_eq(value.type, VmValueTypeList);
+    ck_assert(!value.owned);
+    ck_assert_ptr_eq(value.data.list_value, list);
+    // the list is shared, so it outlives the original value
+    rox_dynamic_value_free(dynamic_value);
+    ck_assert_int_eq(rox_list_size(value.data.list_value), 2);
+
+    RoxDynamicValue *converted = vm_value_to_dynamic_value(&value);
+    ck_assert(rox_dynamic_value_is_list(converted));
+    ck_assert_int_eq(rox_list_size(rox_dynamic_value_get_list(converted)), 2);
+
+    vm_value_release(&value);
+    rox_dynamic_value_free(converted);
+}
+
+END_TEST
+
+START_TEST (test_vm_value_equals_dynamic_value) {
+
+    VmValue int_value = vm_value_int(1);
+    VmValue str_value = vm_value_string_ptr(mem_copy_str("1"));
+    RoxDynamicValue *dynamic_int = rox_dynamic_value_create_double(1.0);
+    RoxDynamicValue *dynamic_str = rox_dynamic_value_create_string_copy("1");
+
+    ck_assert(vm_value_equals_dynamic_value(&int_value, dynamic_int));
+    ck_assert(!vm_value_equals_dynamic_value(&int_value, dynamic_str));
+    ck_assert(vm_value_equals_dynamic_value(&str_value, dynamic_str));
+    ck_assert(!vm_value_equals_dynamic_value(&str_value, dynamic_int));
+
+    vm_value_release(&str_value);
+    rox_dynamic_value_free(dynamic_int);
+    rox_dynamic_value_free(dynamic_str);
+}
+
+END_TEST
+
+START_TEST (test_will_build_vm_program) {
+
+    VmProgram *program = vm_program_create();
+    for (int i = 0; i < 10; ++i) {
+        int constant = vm_program_add_constant(program, vm_value_string_ptr(mem_int_to_str(i)));
+        ck_assert_int_eq(constant, i);
+        ck_assert_int_eq(vm_program_emit(program, VmOpcodePushConstant, constant), i);
+    }
+    ck_assert_int_eq(vm_program_emit(program, VmOpcodeCallOperator, 3), 10);
+    ck_assert_int_eq(program->instructions_count, 11);
+    ck_assert_int_eq(program->constants_count, 10);
+    ck_assert_int_eq(program->instructions[10].opcode, VmOpcodeCallOperator);
+    ck_assert_int_eq(program->instructions[10].operand, 3);
+    ck_assert_str_eq(program->constants[9].data.str_value, "9");
+    vm_program_free(program);
+}
+
+END_TEST
+
+ROX_TEST_SUITE(
+        ROX_TEST_CASE(test_will_push_into_vm_stack_inline),
+        ROX_TEST_CASE(test_will_grow_vm_stack),
+        ROX_TEST_CASE(test_will_borrow_vm_value),
+        ROX_TEST_CASE(test_will_convert_vm_value_from_and_to_dynamic_value),
+        ROX_TEST_CASE(test_vm_value_equals_dynamic_value),
+        ROX_TEST_CASE(test_will_build_vm_program))
@@ -27,16 +27,22 @@ static HttpResponseMessage *test_request_send_get_func(void *target, Request *re
     if (ctx->last_get_params) {
         rox_map_free_with_values(ctx->last_get_params);
     }
+    if (ctx->last_get_if_none_match) {
+        free(ctx->last_get_if_none_match);
+    }
     ctx->last_get_uri = mem_copy_str(data->url);
     ctx->last_get_params = data->params ? mem_deep_copy_str_value_map(data->params) : NULL;
+    ctx->last_get_if_none_match = data->if_none_match ? mem_copy_str(data->if_none_match) : NULL;
     if (!ctx->status_to_return_to_get) {
         return NULL;
     }
-    return response_message_create(
+    HttpResponseMessage *message = response_message_create(
             ctx->status_to_return_to_get,
             ctx->data_to_return_to_get
             ? mem_copy_str(ctx->data_to_return_to_get)
             : NULL);
+    response_message_set_validators(message, ctx->etag_to_return_to_get, NULL);
+    return message;
 }
 
 static HttpResponseMessage *test_request_send_post_func(void *target, Request *request, RequestData *data) {
@@ -107,6 +113,9 @@ ROX_INTERNAL void request_test_fixture_free(RequestTestFixture *ctx) {
     if (ctx->last_get_params) {
         rox_map_free_with_values(ctx->last_get_params);
     }
+    if (ctx->last_get_if_none_match) {
+        free(ctx->last_get_if_none_match);
+    }
     if (ctx->last_post_params) {
         rox_map_free_with_values(ctx->last_post_params);
     }
@@ -177,7 +186,7 @@ ROX_INTERNAL void logging_test_fixture_check_log_message(
         LogRecord *log_record = (LogRecord *) item;
         if (log_record->level == log_level) {
             ck_assert(str_starts_with(log_record->message, message));
-            ROX_LIST_FOREACH_RETURN;
+            return;
         }
     })
     ck_assert(false); // no log record found
@@ -16,6 +16,7 @@
 typedef struct RequestTestFixture {
     int status_to_return_to_get;
     char *data_to_return_to_get;
+    char *etag_to_return_to_get;
     int status_to_return_to_post;
     char *data_to_return_to_post;
     int status_to_return_to_post_json;
@@ -23,6 +24,7 @@ typedef struct RequestTestFixture {
     int times_get_sent;
     char *last_get_uri;
     RoxMap *last_get_params;
+    char *last_get_if_none_match;
     int times_post_sent;
     char *last_post_uri;
     int times_post_json_sent;
@@ -0,0 +1,246 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roxtests.h"
+#include "util.h"
+#include "collections.h"
+
+#define ROX_TEST_KEYS_COUNT 5000
+
+static char **_test_create_keys(const char *prefix, size_t count) {
+    char **keys = calloc(count, sizeof(char *));
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = mem_str_format("%s%zu", prefix, i);
+    }
+    return keys;
+}
+
+static void _test_free_keys(char **keys, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        free(keys[i]);
+    }
+    free(keys);
+}
+
+START_TEST (test_map_will_replace_value_and_keep_key) {
+    RoxMap *map = rox_map_create();
+    char key1[] = "key";
+    char key2[] = "key";
+    void *value;
+    ck_assert(!rox_map_get(map, "key", &value));
+    ck_assert(rox_map_add(map, key1, "1"));
+    ck_assert(rox_map_add(map, key2, "2"));
+    ck_assert_int_eq(1, rox_map_size(map));
+    ck_assert(rox_map_get(map, "key", &value));
+    ck_assert_str_eq("2", value);
+    ROX_MAP_FOREACH(key, val, map, {
+        ck_assert_ptr_eq(key1, key);
+    })
+    rox_map_free(map);
+}
+
+END_TEST
+
+START_TEST (test_map_will_grow_and_find_all_keys) {
+    char **keys = _test_create_keys("key", ROX_TEST_KEYS_COUNT);
+    char **other_keys = _test_create_keys("other", ROX_TEST_KEYS_COUNT);
+    RoxMap *map = rox_map_create();
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        rox_map_add(map, keys[i], (void *) (intptr_t) i);
+    }
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT, rox_map_size(map));
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        void *value;
+        ck_assert(rox_map_get(map, keys[i], &value));
+        ck_assert_int_eq(i, (intptr_t) value);
+        ck_assert(!rox_map_contains_key(map, other_keys[i]));
+    }
+    rox_map_free(map);
+    _test_free_keys(other_keys, ROX_TEST_KEYS_COUNT);
+    _test_free_keys(keys, ROX_TEST_KEYS_COUNT);
+}
+
+END_TEST
+
+START_TEST (test_map_will_keep_other_keys_after_remove) {
+    char **keys = _test_create_keys("key", ROX_TEST_KEYS_COUNT);
+    RoxMap *map = rox_map_create();
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        rox_map_add(map, keys[i], (void *) (intptr_t) i);
+    }
+    void *value;
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; i += 2) {
+        ck_assert(rox_map_remove(map, keys[i], &value));
+        ck_assert_int_eq(i, (intptr_t) value);
+    }
+    ck_assert(!rox_map_remove(map, keys[0], &value));
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT / 2, rox_map_size(map));
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        ck_assert(rox_map_contains_key(map, keys[i]) == (i % 2 == 1));
+    }
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; i += 2) {
+        rox_map_add(map, keys[i], (void *) (intptr_t) i);
+    }
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        ck_assert(rox_map_get(map, keys[i], &value));
+        ck_assert_int_eq(i, (intptr_t) value);
+    }
+    rox_map_free(map);
+    _test_free_keys(keys, ROX_TEST_KEYS_COUNT);
+}
+
+END_TEST
+
+START_TEST (test_map_will_iterate_and_copy_all_entries) {
+    char **keys = _test_create_keys("key", ROX_TEST_KEYS_COUNT);
+    RoxMap *map = rox_map_create();
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        rox_map_add(map, keys[i], keys[i]);
+    }
+    RoxMap *copy = mem_copy_map(map);
+    rox_map_add(copy, "extra", "extra");
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT, rox_map_size(map));
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT + 1, rox_map_size(copy));
+    size_t count = 0;
+    ROX_MAP_FOREACH(key, value, map, {
+        ck_assert_ptr_eq(key, value);
+        ck_assert(rox_map_contains_key(copy, key));
+        ++count;
+    })
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT, count);
+    ck_assert(!rox_map_contains_key(map, "extra"));
+    rox_map_free(copy);
+    rox_map_free(map);
+    _test_free_keys(keys, ROX_TEST_KEYS_COUNT);
+}
+
+END_TEST
+
+START_TEST (test_map_will_remove_and_free_key_and_value) {
+    RoxMap *map = ROX_MAP(
+            ROX_COPY("a"), ROX_COPY("1"),
+            ROX_COPY("b"), ROX_COPY("2"));
+    ck_assert(rox_map_remove_key_value_cb(map, "a", &free, &free));
+    ck_assert(!rox_map_remove_key_value_cb(map, "a", &free, &free));
+    ck_assert_int_eq(1, rox_map_size(map));
+    ck_assert(rox_map_contains_key(map, "b"));
+    rox_map_free_with_keys_and_values(map);
+}
+
+END_TEST
+
+START_TEST (test_set_will_add_keys_once) {
+    char **keys = _test_create_keys("key", ROX_TEST_KEYS_COUNT);
+    RoxSet *set = rox_set_create();
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        rox_set_add(set, keys[i]);
+        rox_set_add(set, keys[i]);
+    }
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT, rox_set_size(set));
+    ck_assert(rox_set_contains(set, "key0"));
+    ck_assert(!rox_set_contains(set, "other"));
+    RoxSet *copy = mem_copy_set(set);
+    size_t count = 0;
+    ROX_SET_FOREACH(item, copy, {
+        ck_assert(rox_set_contains(set, item));
+        ++count;
+    })
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT, count);
+    rox_set_free(copy);
+    rox_set_free(set);
+    _test_free_keys(keys, ROX_TEST_KEYS_COUNT);
+}
+
+END_TEST
+
+static int _test_str_cmp(const void *e1, const void *e2) {
+    return strcmp(*(char **) e1, *(char **) e2);
+}
+
+START_TEST (test_list_will_keep_order_and_index_items) {
+    char **keys = _test_create_keys("key", ROX_TEST_KEYS_COUNT);
+    RoxList *list = rox_list_create();
+    void *item;
+    ck_assert(!rox_list_get_first(list, &item));
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        ck_assert(rox_list_add(list, keys[i]));
+    }
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT, rox_list_size(list));
+    for (size_t i = 0; i < ROX_TEST_KEYS_COUNT; ++i) {
+        ck_assert(rox_list_get_at(list, i, &item));
+        ck_assert_ptr_eq(keys[i], item);
+    }
+    ck_assert(!rox_list_get_at(list, ROX_TEST_KEYS_COUNT, &item));
+    ck_assert(rox_list_remove(list, keys[1]));
+    ck_assert(!rox_list_remove(list, keys[1]));
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT - 1, rox_list_size(list));
+    ck_assert(rox_list_get_at(list, 1, &item));
+    ck_assert_ptr_eq(keys[2], item);
+    RoxList *copy = mem_copy_list(list);
+    ck_assert(rox_list_remove_all(list));
+    ck_assert(!rox_list_remove_all(list));
+    ck_assert_int_eq(0, rox_list_size(list));
+    ck_assert_int_eq(ROX_TEST_KEYS_COUNT - 1, rox_list_size(copy));
+    rox_list_free(copy);
+    rox_list_free(list);
+    _test_free_keys(keys, ROX_TEST_KEYS_COUNT);
+}
+
+END_TEST
+
+START_TEST (test_list_will_reverse_and_sort_in_place) {
+    RoxList *list = ROX_LIST_COPY_STR("b", "d", "a", "c", "e");
+    rox_list_reverse(list);
+    RoxList *reversed = ROX_LIST_COPY_STR("e", "c", "a", "d", "b");
+    ck_assert(str_list_equals(reversed, list));
+    ck_assert(rox_list_sort(list, &_test_str_cmp));
+    RoxList *sorted = ROX_LIST_COPY_STR("a", "b", "c", "d", "e");
+    ck_assert(str_list_equals(sorted, list));
+    ck_assert(str_in_list("c", list));
+    ck_assert(!str_in_list("f", list));
+    rox_list_free_cb(sorted, &free);
+    rox_list_free_cb(reversed, &free);
+    rox_list_free_cb(list, &free);
+}
+
+END_TEST
+
+static bool _test_list_contains(RoxList *list, const char *str) {
+    ROX_LIST_FOREACH(item, list, {
+        if (str_equals(item, str)) {
+            return true;
+        }
+    })
+    return false;
+}
+
+START_TEST (test_foreach_will_allow_early_exit) {
+    RoxList *list = ROX_LIST_COPY_STR("a", "b", "c");
+    ck_assert(_test_list_contains(list, "a"));
+    ck_assert(!_test_list_contains(list, "d"));
+    RoxMap *map = ROX_MAP("a", "1", "b", "2");
+    size_t count = 0;
+    ROX_MAP_FOREACH(key, value, map, {
+        ++count;
+        break;
+    })
+    ck_assert_int_eq(1, count);
+    rox_map_free(map);
+    rox_list_free_cb(list, &free);
+}
+
+END_TEST
+
+ROX_TEST_SUITE(
+        ROX_TEST_CASE(test_map_will_replace_value_and_keep_key),
+        ROX_TEST_CASE(test_map_will_grow_and_find_all_keys),
+        ROX_TEST_CASE(test_map_will_keep_other_keys_after_remove),
+        ROX_TEST_CASE(test_map_will_iterate_and_copy_all_entries),
+        ROX_TEST_CASE(test_map_will_remove_and_free_key_and_value),
+        ROX_TEST_CASE(test_set_will_add_keys_once),
+        ROX_TEST_CASE(test_list_will_keep_order_and_index_items),
+        ROX_TEST_CASE(test_list_will_reverse_and_sort_in_place),
+        ROX_TEST_CASE(test_foreach_will_allow_early_exit)
+)
@@ -1,5 +1,10 @@
 #include <assert.h>
 #include <check.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include "roxtests.h"
 #include "fixtures.h"
 #include "core.h"
@@ -18,7 +23,10 @@ typedef struct CoreTestContext {
     RequestTestFixture *request;
 } CoreTestContext;
 
-static CoreTestContext *core_test_context_create(const char *api_key, const char *roxy_url) {
+static CoreTestContext *core_test_context_create_with_request(
+        const char *api_key,
+        const char *roxy_url,
+        RequestConfig *request_config) {
     CoreTestContext *ctx = calloc(1, sizeof(CoreTestContext));
     ctx->sdk_settings = sdk_settings_create(api_key, "test");
     ctx->rox_options = rox_options_create();
@@ -31,10 +39,14 @@ static CoreTestContext *core_test_context_create(const char *api_key, const char
     ctx->request->status_to_return_to_get = 200;
     ctx->request->status_to_return_to_post = 200;
     ctx->request->status_to_return_to_post_json = 200;
-    ctx->core = rox_core_create(&ctx->request->config);
+    ctx->core = rox_core_create(request_config ? request_config : &ctx->request->config);
     return ctx;
 }
 
+static CoreTestContext *core_test_context_create(const char *api_key, const char *roxy_url) {
+    return core_test_context_create_with_request(api_key, roxy_url, NULL);
+}
+
 static void core_test_context_free(CoreTestContext *ctx) {
     assert(ctx);
     rox_core_free(ctx->core);
@@ -102,9 +114,65 @@ START_TEST (test_will_check_core_setup_when_no_options) {
 
 END_TEST
 
+START_TEST (test_will_be_ready_after_setup) {
+    CoreTestContext *ctx = core_test_context_create("doesn't matter", "http://localhost");
+    RoxStateCode status = rox_core_setup(ctx->core, ctx->sdk_settings, ctx->device_properties, ctx->rox_options);
+    ck_assert_int_eq(RoxInitialized, status);
+    ck_assert_int_eq(1, ctx->request->times_get_sent);
+    ck_assert(rox_core_wait_until_ready(ctx->core, 0));
+    core_test_context_free(ctx);
+}
+
+END_TEST
+
+START_TEST (test_will_fetch_in_background_when_setup_is_async) {
+    CoreTestContext *ctx = core_test_context_create("doesn't matter", "http://localhost");
+    rox_options_set_async_setup(ctx->rox_options, true);
+    RoxStateCode status = rox_core_setup(ctx->core, ctx->sdk_settings, ctx->device_properties, ctx->rox_options);
+    ck_assert_int_eq(RoxInitialized, status);
+    ck_assert(rox_core_wait_until_ready(ctx->core, 5000));
+    ck_assert_int_eq(1, ctx->request->times_get_sent);
+    core_test_context_free(ctx);
+}
+
+END_TEST
+
+START_TEST (test_will_stop_initial_fetch_on_shutdown) {
+    // accepts the connection but never responds
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    ck_assert_int_eq(0, bind(server, (struct sockaddr *) &address, address_len));
+    ck_assert_int_eq(0, listen(server, 1));
+    ck_assert_int_eq(0, getsockname(server, (struct sockaddr *) &address, &address_len));
+    char *roxy_url = mem_str_format("http://127.0.0.1:%d", ntohs(address.sin_port));
+
+    RequestConfig request_config = DEFAULT_REQUEST_CONFIG_INITIALIZER;
+    request_config.request_timeout = 20;
+    CoreTestContext *ctx = core_test_context_create_with_request("doesn't matter", roxy_url, &request_config);
+    rox_options_set_async_setup(ctx->rox_options, true);
+    RoxStateCode status = rox_core_setup(ctx->core, ctx->sdk_settings, ctx->device_properties, ctx->rox_options);
+    ck_assert_int_eq(RoxInitialized, status);
+    ck_assert(!rox_core_wait_until_ready(ctx->core, 200));
+
+    double start = current_time_millis();
+    core_test_context_free(ctx);
+    ck_assert_double_lt(current_time_millis() - start, 3000);
+
+    free(roxy_url);
+    close(server);
+}
+
+END_TEST
+
 ROX_TEST_SUITE(
         ROX_TEST_CASE(test_will_check_empty_api_key),
         ROX_TEST_CASE(test_will_check_invalid_api_key),
         ROX_TEST_CASE(test_will_check_core_setup_when_options_with_roxy),
-        ROX_TEST_CASE(test_will_check_core_setup_when_no_options)
+        ROX_TEST_CASE(test_will_check_core_setup_when_no_options),
+        ROX_TEST_CASE(test_will_be_ready_after_setup),
+        ROX_TEST_CASE(test_will_fetch_in_background_when_setup_is_async),
+        ROX_TEST_CASE(test_will_stop_initial_fetch_on_shutdown)
 )
@@ -515,3 +515,23 @@ TEST_CASE ("testing_variant_dependency_with_context", "[server]") {
 
     delete ctx;
 }
+
+TEST_CASE ("testing_context_builder_reset", "[server]") {
+    Rox::ContextBuilder builder;
+    Rox::Context *context = builder
+            .Reserve(2, 16)
+            .AddStringValue("plan", "free")
+            .AddIntValue("seats", 1)
+            .Build();
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(builder
+                        .Reset(context)
+                        .AddIntValue("seats", i)
+                        .Build() == context);
+        RoxDynamicValue *seats = rox_context_get(context, "seats");
+        REQUIRE(rox_dynamic_value_get_int(seats) == i);
+        REQUIRE(rox_context_get(context, "plan") == nullptr);
+        rox_dynamic_value_free(seats);
+    }
+    rox_context_free(context);
+}
@@ -65,6 +65,57 @@ START_TEST (test_matches_bool_pattern) {
 
 END_TEST
 
+START_TEST (test_matches_cached_pattern) {
+    str_matches_clear_cache();
+    RegexCacheStats stats;
+    ck_assert(str_matches("user@rollout.io", "@rollout\\.io$", 0));
+    ck_assert(!str_matches("user@example.com", "@rollout\\.io$", 0));
+    ck_assert(str_matches("USER@ROLLOUT.IO", "@rollout\\.io$", PCRE2_CASELESS));
+    ck_assert(!str_matches("USER@ROLLOUT.IO", "@rollout\\.io$", 0));
+    str_matches_get_cache_stats(&stats);
+    ck_assert_int_eq(stats.misses, 2);
+    ck_assert_int_eq(stats.hits, 2);
+    ck_assert_int_eq(stats.size, 2);
+
+    // invalid patterns are cached as well and never match
+    ck_assert(!str_matches("(", "(", 0));
+    ck_assert(!str_matches("(", "(", 0));
+    str_matches_get_cache_stats(&stats);
+    ck_assert_int_eq(stats.misses, 3);
+    ck_assert_int_eq(stats.hits, 3);
+
+    str_matches_clear_cache();
+    str_matches_get_cache_stats(&stats);
+    ck_assert_int_eq(stats.size, 0);
+    ck_assert_int_eq(stats.hits, 0);
+    ck_assert_int_eq(stats.misses, 0);
+}
+
+END_TEST
+
+START_TEST (test_matches_evicts_least_recently_used_pattern) {
+    size_t capacity;
+    RegexCacheStats stats;
+    str_matches_get_cache_stats(&stats);
+    capacity = stats.capacity;
+    str_matches_clear_cache();
+    str_matches_set_cache_capacity(2);
+    ck_assert(str_matches("a", "a", 0));
+    ck_assert(str_matches("b", "b", 0));
+    ck_assert(str_matches("a", "a", 0));
+    ck_assert(str_matches("c", "c", 0)); // evicts "b"
+    ck_assert(str_matches("a", "a", 0));
+    ck_assert(str_matches("b", "b", 0));
+    str_matches_get_cache_stats(&stats);
+    ck_assert_int_eq(stats.size, 2);
+    ck_assert_int_eq(stats.hits, 2);
+    ck_assert_int_eq(stats.misses, 4);
+    str_matches_set_cache_capacity(capacity);
+    str_matches_clear_cache();
+}
+
+END_TEST
+
 START_TEST (test_index_of_empty_string) {
     ck_assert(str_index_of("", 'a') < 0);
 }
@@ -367,6 +418,8 @@ ROX_TEST_SUITE(
         ROX_TEST_CASE(test_matches_strings_pattern),
         ROX_TEST_CASE(test_matches_numeric_pattern),
         ROX_TEST_CASE(test_matches_bool_pattern),
+        ROX_TEST_CASE(test_matches_cached_pattern),
+        ROX_TEST_CASE(test_matches_evicts_least_recently_used_pattern),
 
 // str_index_of
         ROX_TEST_CASE(test_index_of_empty_string),
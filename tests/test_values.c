@@ -0,0 +1,138 @@
+#include <check.h>
+#include <stdlib.h>
+
+#include "roxtests.h"
+#include "util.h"
+#include "collections.h"
+#include "values.h"
+#include "rox/context.h"
+
+START_TEST (test_dynamic_value_will_keep_scalars_inline) {
+    RoxDynamicValue *int_value = rox_dynamic_value_create_int(7);
+    ck_assert(rox_dynamic_value_is_int(int_value));
+    ck_assert(!rox_dynamic_value_is_double(int_value));
+    ck_assert_int_eq(7, rox_dynamic_value_get_int(int_value));
+
+    RoxDynamicValue *int_ptr_value = rox_dynamic_value_create_int_ptr(mem_copy_int(7));
+    ck_assert_int_eq(7, rox_dynamic_value_get_int(int_ptr_value));
+    ck_assert(rox_dynamic_value_equals(int_value, int_ptr_value));
+
+    RoxDynamicValue *double_value = rox_dynamic_value_create_double_ptr(mem_copy_double(7.0));
+    ck_assert(rox_dynamic_value_is_double(double_value));
+    ck_assert(rox_dynamic_value_equals(int_value, double_value));
+
+    RoxDynamicValue *string_value = rox_dynamic_value_create_string_copy("7");
+    ck_assert(!rox_dynamic_value_equals(int_value, string_value));
+
+    rox_dynamic_value_free(string_value);
+    rox_dynamic_value_free(double_value);
+    rox_dynamic_value_free(int_ptr_value);
+    rox_dynamic_value_free(int_value);
+}
+
+END_TEST
+
+START_TEST (test_dynamic_value_will_share_constants) {
+    RoxDynamicValue *true_value = rox_dynamic_value_create_boolean(true);
+    RoxDynamicValue *false_value = rox_dynamic_value_create_boolean(false);
+    ck_assert(rox_dynamic_value_is_boolean(true_value));
+    ck_assert(rox_dynamic_value_get_boolean(true_value));
+    ck_assert(!rox_dynamic_value_get_boolean(false_value));
+    ck_assert(!rox_dynamic_value_equals(true_value, false_value));
+    ck_assert(rox_dynamic_value_equals(true_value, rox_dynamic_value_create_boolean(true)));
+
+    RoxDynamicValue *null_value = rox_dynamic_value_create_null();
+    RoxDynamicValue *undefined_value = rox_dynamic_value_create_undefined();
+    ck_assert(rox_dynamic_value_is_null(null_value));
+    ck_assert(rox_dynamic_value_is_undefined(undefined_value));
+    ck_assert(!rox_dynamic_value_equals(null_value, undefined_value));
+
+    // freeing a shared constant leaves it intact for the other users
+    rox_dynamic_value_free(true_value);
+    rox_dynamic_value_free(rox_dynamic_value_create_copy(null_value));
+    ck_assert(rox_dynamic_value_get_boolean(rox_dynamic_value_create_boolean(true)));
+    ck_assert(rox_dynamic_value_is_null(rox_dynamic_value_create_null()));
+    rox_dynamic_value_free(false_value);
+    rox_dynamic_value_free(null_value);
+    rox_dynamic_value_free(undefined_value);
+}
+
+END_TEST
+
+START_TEST (test_dynamic_value_will_deep_copy_containers) {
+    struct tm time = {0};
+    time.tm_year = 120;
+    RoxDynamicValue *list = rox_dynamic_value_create_list(ROX_LIST(
+            rox_dynamic_value_create_int(1),
+            rox_dynamic_value_create_string_copy("two"),
+            rox_dynamic_value_create_datetime_copy(&time)));
+    RoxDynamicValue *map = rox_dynamic_value_create_map(ROX_MAP(
+            ROX_COPY("list"), list));
+    RoxDynamicValue *copy = rox_dynamic_value_create_copy(map);
+    rox_dynamic_value_free(map);
+
+    ck_assert(rox_dynamic_value_is_map(copy));
+    void *item;
+    ck_assert(rox_map_get(rox_dynamic_value_get_map(copy), "list", &item));
+    RoxList *items = rox_dynamic_value_get_list(item);
+    ck_assert_int_eq(3, rox_list_size(items));
+    ck_assert(rox_list_get_at(items, 1, &item));
+    ck_assert_str_eq("two", rox_dynamic_value_get_string(item));
+    ck_assert(rox_list_get_at(items, 2, &item));
+    ck_assert_int_eq(120, rox_dynamic_value_get_datetime(item)->tm_year);
+    rox_dynamic_value_free(copy);
+}
+
+END_TEST
+
+START_TEST (test_dynamic_value_will_live_in_caller_storage) {
+    RoxDynamicValue values[3];
+    values[0] = dynamic_value_int(3);
+    values[1] = dynamic_value_string_ptr(mem_copy_str("owned"));
+    const char *borrowed = "borrowed";
+    values[2] = dynamic_value_string_borrowed(borrowed);
+    ck_assert_int_eq(3, rox_dynamic_value_get_int(&values[0]));
+    ck_assert_str_eq("owned", rox_dynamic_value_get_string(&values[1]));
+    ck_assert_ptr_eq(borrowed, rox_dynamic_value_get_string(&values[2]));
+
+    RoxDynamicValue *copy = rox_dynamic_value_create_copy(&values[2]);
+    ck_assert(rox_dynamic_value_equals(copy, &values[2]));
+    rox_dynamic_value_free(copy);
+
+    for (int i = 0; i < 3; ++i) {
+        dynamic_value_release(&values[i]);
+        ck_assert(rox_dynamic_value_is_undefined(&values[i]));
+    }
+}
+
+END_TEST
+
+START_TEST (test_dynamic_value_will_be_shared_by_context_lookups) {
+    RoxContext *context = rox_context_create_from_map(ROX_MAP(
+            ROX_COPY("segments"), rox_dynamic_value_create_list(ROX_LIST(
+                    rox_dynamic_value_create_string_copy("a"),
+                    rox_dynamic_value_create_string_copy("b")))));
+    RoxDynamicValue *value = rox_context_get(context, "segments");
+    RoxDynamicValue *another = rox_context_get(context, "segments");
+    ck_assert_ptr_eq(value, another);
+    rox_dynamic_value_free(another);
+    rox_context_free(context);
+
+    // still referenced
+    ck_assert_int_eq(2, rox_list_size(rox_dynamic_value_get_list(value)));
+    RoxDynamicValue *copy = rox_dynamic_value_create_copy(value);
+    ck_assert_ptr_ne(value, copy);
+    ck_assert_ptr_ne(rox_dynamic_value_get_list(value), rox_dynamic_value_get_list(copy));
+    rox_dynamic_value_free(value);
+    rox_dynamic_value_free(copy);
+}
+
+END_TEST
+
+ROX_TEST_SUITE(
+        ROX_TEST_CASE(test_dynamic_value_will_keep_scalars_inline),
+        ROX_TEST_CASE(test_dynamic_value_will_share_constants),
+        ROX_TEST_CASE(test_dynamic_value_will_deep_copy_containers),
+        ROX_TEST_CASE(test_dynamic_value_will_live_in_caller_storage),
+        ROX_TEST_CASE(test_dynamic_value_will_be_shared_by_context_lookups)
+)